@@ -0,0 +1,133 @@
+#include <Logger.h>
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+// Values of a typical trading record.
+constexpr int64_t kQuantity = 1500;
+constexpr double kPrice = 101.25;
+constexpr uint32_t kOrderId = 4000123456u;
+
+void BM_FormatStringStream(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		std::stringstream ss;
+		ss << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice << " ok " << true;
+		benchmark::DoNotOptimize(ss.str());
+	}
+}
+BENCHMARK(BM_FormatStringStream);
+
+void BM_FormatBufferStream(benchmark::State& state)
+{
+	LogBuffer buffer;
+	for (auto _ : state)
+	{
+		buffer.Truncate(0);
+		buffer.Stream() << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice << " ok " << true;
+		benchmark::DoNotOptimize(buffer.Data());
+	}
+}
+BENCHMARK(BM_FormatBufferStream);
+
+void BM_FormatLogValue(benchmark::State& state)
+{
+	LogBuffer buffer;
+	for (auto _ : state)
+	{
+		buffer.Truncate(0);
+		LogValue<std::string_view>::Append(buffer, "order ");
+		LogValue<uint32_t>::Append(buffer, kOrderId);
+		LogValue<std::string_view>::Append(buffer, " qty ");
+		LogValue<int64_t>::Append(buffer, kQuantity);
+		LogValue<std::string_view>::Append(buffer, " px ");
+		LogValue<double>::Append(buffer, kPrice);
+		LogValue<std::string_view>::Append(buffer, " ok ");
+		LogValue<bool>::Append(buffer, true);
+		benchmark::DoNotOptimize(buffer.Data());
+	}
+}
+BENCHMARK(BM_FormatLogValue);
+
+template <typename T>
+void BM_FormatValueStream(benchmark::State& state, const T value)
+{
+	LogBuffer buffer;
+	for (auto _ : state)
+	{
+		buffer.Truncate(0);
+		buffer.Stream() << value;
+		benchmark::DoNotOptimize(buffer.Data());
+	}
+}
+
+template <typename T>
+void BM_FormatValueFast(benchmark::State& state, const T value)
+{
+	LogBuffer buffer;
+	for (auto _ : state)
+	{
+		buffer.Truncate(0);
+		LogValue<T>::Append(buffer, value);
+		benchmark::DoNotOptimize(buffer.Data());
+	}
+}
+
+BENCHMARK_CAPTURE(BM_FormatValueStream, Int, -123456789);
+BENCHMARK_CAPTURE(BM_FormatValueFast, Int, -123456789);
+BENCHMARK_CAPTURE(BM_FormatValueStream, Double, 3.14159265358979);
+BENCHMARK_CAPTURE(BM_FormatValueFast, Double, 3.14159265358979);
+BENCHMARK_CAPTURE(BM_FormatValueStream, Pointer, static_cast<const void*>(&kPrice));
+BENCHMARK_CAPTURE(BM_FormatValueFast, Pointer, static_cast<const void*>(&kPrice));
+
+// The whole statement: prefix, values and the write to a discarding stream.
+class NullBuffer : public std::streambuf
+{
+protected:
+	std::streamsize xsputn(const char*, const std::streamsize count) override
+	{
+		return count;
+	}
+	int_type overflow(const int_type ch) override
+	{
+		return traits_type::not_eof(ch);
+	}
+};
+
+void BM_LogStatement(benchmark::State& state)
+{
+	NullBuffer null_buffer;
+	std::ostream null_stream(&null_buffer);
+	SetLogStream(null_stream);
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice << " ok " << true;
+	}
+	SetLogStream(std::cout);
+}
+BENCHMARK(BM_LogStatement);
+
+// The same values as typed fields; the text line carries them as " key=value".
+void BM_LogStructured(benchmark::State& state)
+{
+	NullBuffer null_buffer;
+	std::ostream null_stream(&null_buffer);
+	SetLogStream(null_stream);
+	for (auto _ : state)
+	{
+		LOG_INFO.kv("order", kOrderId).kv("qty", kQuantity).kv("px", kPrice).kv("ok", true) << "fill";
+	}
+	SetLogStream(std::cout);
+}
+BENCHMARK(BM_LogStructured);
+
+} // namespace
+
+} // namespace SimpleLog
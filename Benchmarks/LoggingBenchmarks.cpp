@@ -0,0 +1,342 @@
+#include <LogSink.h>
+#include <Logger.h>
+#include <LoggerStats.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr int64_t kQuantity = 1500;
+constexpr double kPrice = 101.25;
+constexpr uint32_t kOrderId = 4000123456u;
+
+class NullSink : public LogSink
+{
+public:
+	void Write(const LogRecord&, const std::string_view text) override
+	{
+		benchmark::DoNotOptimize(text.data());
+	}
+};
+
+// Routes every record to a NullSink while alive: the registered sinks are muted and
+// get their masks back afterwards.
+class NullSinkScope
+{
+public:
+	NullSinkScope()
+		: sinks_(GetLogSinks())
+		, null_sink_(std::make_shared<NullSink>())
+	{
+		for (const auto& sink : sinks_)
+		{
+			message_types_.push_back(sink->GetMessageTypes());
+			sink->SetMessageTypes(0);
+		}
+		AddLogSink(null_sink_);
+	}
+
+	~NullSinkScope()
+	{
+		RemoveLogSink(null_sink_);
+		for (size_t i = 0; i < sinks_.size(); ++i)
+		{
+			sinks_[i]->SetMessageTypes(message_types_[i]);
+		}
+	}
+
+private:
+	const std::vector<std::shared_ptr<LogSink>> sinks_;
+	std::vector<uint32_t> message_types_;
+	const std::shared_ptr<NullSink> null_sink_;
+};
+
+// Restores the global filters changed by a benchmark.
+class LogSettingsScope
+{
+public:
+	~LogSettingsScope()
+	{
+		SetLogType(log_type_);
+		SetLogMessageTypes(message_types_);
+		SetLogInfos(log_infos_);
+		SetSuppressedCountingEnabled(count_suppressed_);
+	}
+
+private:
+	const LogType log_type_ = GetLogType();
+	const uint32_t message_types_ = GetLogMessageTypes();
+	const uint32_t log_infos_ = GetLogInfos();
+	const bool count_suppressed_ = IsSuppressedCountingEnabled();
+};
+
+// Per-call latencies of one thread, reported as percentile counters in nanoseconds
+// (averaged over the threads of a multi-threaded run). Each call costs one extra
+// clock read, which is part of every sample; the newest kMaxSamples are kept.
+class LatencySamples
+{
+public:
+	LatencySamples()
+		: samples_(kMaxSamples)
+	{}
+
+	void Start()
+	{
+		last_ = Clock::now();
+	}
+
+	void Record()
+	{
+		const auto now = Clock::now();
+		samples_[count_++ & (kMaxSamples - 1)] = (now - last_).count();
+		last_ = now;
+	}
+
+	void Report(benchmark::State& state)
+	{
+		const auto size = std::min(count_, kMaxSamples);
+		if (size == 0)
+		{
+			return;
+		}
+		samples_.resize(size);
+		std::sort(samples_.begin(), samples_.end());
+		const auto percentile = [this, size](const double fraction)
+		{
+			const auto index = std::min(size - 1, static_cast<size_t>(fraction * static_cast<double>(size)));
+			return benchmark::Counter(static_cast<double>(samples_[index]), benchmark::Counter::kAvgThreads);
+		};
+		state.counters["p50_ns"] = percentile(0.5);
+		state.counters["p90_ns"] = percentile(0.9);
+		state.counters["p99_ns"] = percentile(0.99);
+		state.counters["p999_ns"] = percentile(0.999);
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+	static constexpr size_t kMaxSamples = 1 << 20;
+
+	std::vector<int64_t> samples_;
+	size_t count_ = 0;
+	Clock::time_point last_;
+};
+
+// The floor of the runtime filter: a filtered-out statement is a load and a test of
+// the config word.
+void BM_LogDisabled(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	SetLogMessageTypes(GetLogMessageTypes() & ~static_cast<uint32_t>(LogMessageType::Info));
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+	}
+}
+BENCHMARK(BM_LogDisabled);
+
+void BM_LogDisabledDebug(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	SetLogType(LogType::Release);
+	for (auto _ : state)
+	{
+		DEBUG_LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+	}
+}
+BENCHMARK(BM_LogDisabledDebug);
+
+// The opt-in suppressed counter adds a per-thread increment to each filtered-out
+// statement.
+void BM_LogDisabledCounted(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	SetSuppressedCountingEnabled(true);
+	SetLogMessageTypes(GetLogMessageTypes() & ~static_cast<uint32_t>(LogMessageType::Info));
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+	}
+}
+BENCHMARK(BM_LogDisabledCounted);
+
+void BM_LogDisabledDebugCounted(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	SetSuppressedCountingEnabled(true);
+	SetLogType(LogType::Release);
+	for (auto _ : state)
+	{
+		DEBUG_LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+	}
+}
+BENCHMARK(BM_LogDisabledDebugCounted);
+
+// A filtered-out statement while vmodule overrides exist for other files: it also
+// compares its cached decision with the generation of the rules.
+void BM_LogDisabledWithVModule(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	SetLogVModule("net/*=info");
+	SetLogMessageTypes(GetLogMessageTypes() & ~static_cast<uint32_t>(LogMessageType::Info));
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+	}
+	SetLogVModule("");
+}
+BENCHMARK(BM_LogDisabledWithVModule);
+
+void BM_LogEnabled(benchmark::State& state)
+{
+	NullSinkScope sinks;
+	LatencySamples latencies;
+	latencies.Start();
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+		latencies.Record();
+	}
+	latencies.Report(state);
+}
+BENCHMARK(BM_LogEnabled);
+
+std::string GetLogInfosLabel(const uint32_t log_infos)
+{
+	std::string label;
+	const auto add = [&label, log_infos](const LogInfos info, const char* const name)
+	{
+		if ((log_infos & static_cast<uint32_t>(info)) != 0)
+		{
+			label += label.empty() ? name : std::string("|") + name;
+		}
+	};
+	add(LogInfos::ThreadId, "ThreadId");
+	add(LogInfos::TimeStamp, "TimeStamp");
+	add(LogInfos::FileNameWithLine, "FileNameWithLine");
+	return label.empty() ? "None" : label;
+}
+
+// Every LogInfos combination: range(0) is the mask.
+void BM_LogInfos(benchmark::State& state)
+{
+	LogSettingsScope settings;
+	NullSinkScope sinks;
+	const auto log_infos = static_cast<uint32_t>(state.range(0));
+	SetLogInfos(log_infos);
+	LatencySamples latencies;
+	latencies.Start();
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+		latencies.Record();
+	}
+	latencies.Report(state);
+	state.SetLabel(GetLogInfosLabel(log_infos));
+}
+BENCHMARK(BM_LogInfos)->DenseRange(0, 7);
+
+bool CheckReturn(const bool condition)
+{
+	CHECK_RETURN(condition, false);
+	return true;
+}
+
+bool CheckFlog(const bool condition)
+{
+	CHECK_FLOG_RETURN(condition, "order check failed", false);
+	return true;
+}
+
+bool CheckElog(const bool condition)
+{
+	CHECK_ELOG_RETURN(condition, "order check failed", false);
+	return true;
+}
+
+bool CheckWlog(const bool condition)
+{
+	CHECK_WLOG_RETURN(condition, "order check failed", false);
+	return true;
+}
+
+bool CheckIlog(const bool condition)
+{
+	CHECK_ILOG_RETURN(condition, "order check failed", false);
+	return true;
+}
+
+bool CheckDelog(const bool condition)
+{
+	CHECK_DELOG_RETURN(condition, "order check failed", false);
+	return true;
+}
+
+// range(0) is 1 on the failing path.
+template <bool (*Check)(bool)>
+void BM_Check(benchmark::State& state)
+{
+	NullSinkScope sinks;
+	const auto fail = state.range(0) != 0;
+	auto condition = !fail;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(condition);
+		benchmark::DoNotOptimize(Check(condition));
+	}
+}
+BENCHMARK_TEMPLATE(BM_Check, CheckReturn)->ArgName("fail")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Check, CheckFlog)->ArgName("fail")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Check, CheckElog)->ArgName("fail")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Check, CheckWlog)->ArgName("fail")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Check, CheckIlog)->ArgName("fail")->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Check, CheckDelog)->ArgName("fail")->Arg(0)->Arg(1);
+
+// Throughput of concurrent LOG_INFO statements; range(0) is 1 with the asynchronous
+// backend running.
+void BM_LogThroughput(benchmark::State& state)
+{
+	const auto async = state.range(0) != 0;
+	std::optional<NullSinkScope> sinks;
+	if (state.thread_index() == 0)
+	{
+		sinks.emplace();
+		if (async)
+		{
+			StartAsyncLogging();
+		}
+	}
+
+	LatencySamples latencies;
+	latencies.Start();
+	for (auto _ : state)
+	{
+		LOG_INFO << "order " << kOrderId << " qty " << kQuantity << " px " << kPrice;
+		latencies.Record();
+	}
+
+	if (state.thread_index() == 0 && async)
+	{
+		StopAsyncLogging();
+	}
+	latencies.Report(state);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogThroughput)
+	->ArgName("async")->Arg(0)->Arg(1)
+	->ThreadRange(1, static_cast<int>(std::max(2u, std::thread::hardware_concurrency())))
+	->UseRealTime();
+
+} // namespace
+
+} // namespace SimpleLog
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+struct BatchedFileOptions
+{
+	// A commit is started as soon as one of the limits is reached.
+	size_t flush_bytes = 1 << 20;
+	size_t flush_records = 4096;
+	std::chrono::milliseconds max_latency{50};
+	// fdatasync after every n-th commit; 0 never syncs.
+	size_t sync_every_commits = 0;
+};
+
+// Log sink that collects finished records from every thread and writes them to a file
+// in group commits: one writev per batch, issued by a committer thread when a flush
+// trigger fires. flush() (and so every FatalError record) commits on the calling
+// thread before returning.
+//
+// Usable with SetLogStream/SetELogStream. Each write() is one record: writes from
+// several threads never interleave.
+class BatchedFileStream : public std::ostream
+{
+public:
+	// Appends to path. On failure the stream is created in the bad state.
+	explicit BatchedFileStream(const std::string& path, const BatchedFileOptions& options = BatchedFileOptions());
+	~BatchedFileStream() override;
+
+	BatchedFileStream(const BatchedFileStream&) = delete;
+	BatchedFileStream& operator=(const BatchedFileStream&) = delete;
+
+	bool IsOpen() const;
+	// Number of writev batches and fdatasync calls issued so far.
+	size_t GetCommitCount() const;
+	size_t GetSyncCount() const;
+	// Commits pending records and closes the file.
+	void Close();
+
+private:
+	class Buffer : public std::streambuf
+	{
+	public:
+		Buffer(const std::string& path, const BatchedFileOptions& options);
+		~Buffer() override;
+
+		bool IsOpen() const;
+		size_t GetCommitCount() const;
+		size_t GetSyncCount() const;
+		void Close();
+
+	protected:
+		std::streamsize xsputn(const char* data, std::streamsize size) override;
+		int_type overflow(int_type ch) override;
+		int sync() override;
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<char[]> data;
+			size_t capacity;
+			size_t size;
+		};
+
+		bool EnterWriter();
+		void LeaveWriter();
+		void Append(const char* data, const size_t size);
+		bool Commit();
+		bool WriteBlocks(std::vector<Block>& blocks);
+		void Run();
+
+		int fd_ = -1;
+		const BatchedFileOptions options_;
+		std::atomic<bool> closed_{false};
+		// Writers between EnterWriter and LeaveWriter; Close commits and closes the file
+		// once they left.
+		std::atomic<uint32_t> writers_{0};
+
+		// Records of the open batch, guarded by mutex_.
+		std::mutex mutex_;
+		std::condition_variable commit_cv_;
+		std::vector<Block> batch_;
+		std::vector<Block> free_blocks_;
+		size_t batch_bytes_ = 0;
+		size_t batch_records_ = 0;
+		std::chrono::steady_clock::time_point batch_started_;
+		bool stop_ = false;
+
+		// Serializes the writers so batches reach the file in order.
+		std::mutex commit_mutex_;
+		std::atomic<size_t> commits_{0};
+		std::atomic<size_t> syncs_{0};
+		std::thread committer_;
+	};
+
+	Buffer buffer_;
+};
+
+} // namespace SimpleLog
@@ -0,0 +1,110 @@
+#pragma once
+#include "LogSink.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SimpleLog
+{
+
+// Time-indexed log file. Records are stored in binary form in blocks of a fixed size
+// (a record too large for one block gets a block of several). Every block starts with
+// a header holding the time range of its records, the mask of their message types,
+// a mask of their thread numbers and a Bloom filter of their file:line sites, and a
+// clean close appends an index of the headers, so a query reads one footer and then
+// only the blocks that can match. Files of a crashed process have no index; readers
+// walk the headers instead, a seek per block.
+struct BlockLogHeader
+{
+	uint32_t magic = 0;
+	// Bytes of the block, header included: a multiple of the block size.
+	uint32_t size = 0;
+	// Bytes of records following the header.
+	uint32_t payload_size = 0;
+	uint32_t record_count = 0;
+	int64_t min_timestamp_ns = 0;
+	int64_t max_timestamp_ns = 0;
+	uint32_t message_types = 0;
+	uint32_t reserved = 0;
+	// Bit (thread number - 1) % 64 of every thread with a record in the block.
+	uint64_t thread_mask = 0;
+	uint64_t site_filter[4] = {};
+	// File offset of the block; only meaningful in the index.
+	uint64_t offset = 0;
+};
+
+// Writes records into a block file; formatters do not apply. Records are appended to
+// an existing file after its last complete block. Flush() writes the block being
+// filled, which later flushes rewrite in place.
+class BlockFileSink : public LogSink
+{
+public:
+	static constexpr size_t kDefaultBlockSize = 64 << 10;
+
+	// On failure the sink is created closed and drops every record.
+	explicit BlockFileSink(
+		const std::string& path,
+		const uint32_t message_types = kAllLogMessageTypes,
+		const size_t block_size = kDefaultBlockSize);
+	~BlockFileSink() override;
+
+	bool IsOpen() const;
+	void Write(const LogRecord& record, std::string_view text) override;
+	void Flush() override;
+	// Writes the last block and the index, then closes the file.
+	void Close();
+
+private:
+	void WriteBlock();
+	void StartBlock();
+
+	mutable std::mutex mutex_;
+	int fd_ = -1;
+	const size_t block_size_;
+	// Offset of the block being filled, and how much of it is already in the file.
+	uint64_t block_offset_ = 0;
+	size_t written_size_ = 0;
+	BlockLogHeader header_;
+	std::vector<char> block_;
+	std::vector<BlockLogHeader> index_;
+};
+
+struct BlockLogQuery
+{
+	// Inclusive range of record timestamps, in nanoseconds since the epoch.
+	int64_t begin_ns = std::numeric_limits<int64_t>::min();
+	int64_t end_ns = std::numeric_limits<int64_t>::max();
+	uint32_t message_types = kAllLogMessageTypes;
+	// File name of the call site, without directories; empty matches every file.
+	std::string file;
+	// Line of the call site; 0 matches every line.
+	int line = 0;
+	// Thread number (GetThreadNumber()); 0 matches every thread.
+	uint32_t thread = 0;
+};
+
+struct BlockLogQueryStats
+{
+	size_t blocks = 0;
+	// Blocks whose header matched the query and whose records were read.
+	size_t blocks_read = 0;
+	size_t records = 0;
+	// Whether the file's index was used instead of walking the block headers.
+	bool indexed = false;
+};
+
+// Calls visit with every matching record, in file order. The record's message holds
+// the structured fields rendered as by LogInfosFormatter; its text is empty. Returns
+// false when the file cannot be read.
+bool QueryBlockLog(
+	const std::string& path,
+	const BlockLogQuery& query,
+	const std::function<void(const LogRecord&)>& visit,
+	BlockLogQueryStats* const stats = nullptr);
+
+} // namespace SimpleLog
@@ -0,0 +1,259 @@
+#pragma once
+#include "Logger.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace SimpleLog
+{
+
+// Deferred logging: every call site owns a constant DeferredSite descriptor (its
+// CallSite, format and argument types) and a call only copies the raw argument bytes
+// into a per-thread buffer. The text is produced later by the asynchronous backend
+// (see StartAsyncLogging); without a running backend the record is formatted on the
+// calling thread. Each "{}" in the format is replaced by the next argument.
+
+enum class DeferredArgType : uint8_t
+{
+	Int,
+	UInt,
+	Float,
+	Double,
+	Bool,
+	Char,
+	String,
+	Pointer,
+};
+
+struct DeferredSite
+{
+	const CallSite* call_site;
+	const char* format;
+	const DeferredArgType* arg_types;
+	size_t arg_count;
+};
+
+template <typename T, typename Enable = void>
+struct DeferredArg;
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> &&
+	!std::is_same_v<T, char> && !std::is_same_v<T, signed char>>>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Int;
+	static size_t Size(T) { return sizeof(int64_t); }
+	static char* Encode(char* out, const T value)
+	{
+		const int64_t raw = value;
+		std::memcpy(out, &raw, sizeof(raw));
+		return out + sizeof(raw);
+	}
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> &&
+	!std::is_same_v<T, bool> && !std::is_same_v<T, char> && !std::is_same_v<T, unsigned char>>>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::UInt;
+	static size_t Size(T) { return sizeof(uint64_t); }
+	static char* Encode(char* out, const T value)
+	{
+		const uint64_t raw = value;
+		std::memcpy(out, &raw, sizeof(raw));
+		return out + sizeof(raw);
+	}
+};
+
+template <>
+struct DeferredArg<float>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Float;
+	static size_t Size(float) { return sizeof(float); }
+	static char* Encode(char* out, const float value)
+	{
+		std::memcpy(out, &value, sizeof(value));
+		return out + sizeof(value);
+	}
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_floating_point_v<T> && !std::is_same_v<T, float>>>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Double;
+	static size_t Size(T) { return sizeof(double); }
+	static char* Encode(char* out, const T value)
+	{
+		const double raw = static_cast<double>(value);
+		std::memcpy(out, &raw, sizeof(raw));
+		return out + sizeof(raw);
+	}
+};
+
+template <>
+struct DeferredArg<bool>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Bool;
+	static size_t Size(bool) { return 1; }
+	static char* Encode(char* out, const bool value)
+	{
+		*out = value ? 1 : 0;
+		return out + 1;
+	}
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_same_v<T, char> ||
+	std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>>>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Char;
+	static size_t Size(T) { return 1; }
+	static char* Encode(char* out, const T value)
+	{
+		*out = static_cast<char>(value);
+		return out + 1;
+	}
+};
+
+template <typename T>
+struct DeferredArg<T, std::enable_if_t<std::is_enum_v<T>>>
+{
+	using Underlying = DeferredArg<std::underlying_type_t<T>>;
+	static constexpr DeferredArgType kType = Underlying::kType;
+	static size_t Size(const T value) { return Underlying::Size(static_cast<std::underlying_type_t<T>>(value)); }
+	static char* Encode(char* out, const T value)
+	{
+		return Underlying::Encode(out, static_cast<std::underlying_type_t<T>>(value));
+	}
+};
+
+struct DeferredStringArg
+{
+	static constexpr DeferredArgType kType = DeferredArgType::String;
+	static size_t Size(const std::string_view value) { return sizeof(uint32_t) + value.size(); }
+	static char* Encode(char* out, const std::string_view value)
+	{
+		const auto size = static_cast<uint32_t>(value.size());
+		std::memcpy(out, &size, sizeof(size));
+		std::memcpy(out + sizeof(size), value.data(), value.size());
+		return out + sizeof(size) + value.size();
+	}
+};
+
+struct DeferredCStringArg : DeferredStringArg
+{
+	static size_t Size(const char* const value) { return DeferredStringArg::Size(ToLogString(value)); }
+	static char* Encode(char* out, const char* const value)
+	{
+		return DeferredStringArg::Encode(out, ToLogString(value));
+	}
+};
+
+template <>
+struct DeferredArg<const char*> : DeferredCStringArg {};
+template <>
+struct DeferredArg<char*> : DeferredCStringArg {};
+template <>
+struct DeferredArg<std::string> : DeferredStringArg {};
+template <>
+struct DeferredArg<std::string_view> : DeferredStringArg {};
+
+template <typename T>
+struct DeferredArg<T*, std::enable_if_t<!std::is_same_v<std::remove_cv_t<T>, char>>>
+{
+	static constexpr DeferredArgType kType = DeferredArgType::Pointer;
+	static size_t Size(const T*) { return sizeof(uintptr_t); }
+	static char* Encode(char* out, const T* const value)
+	{
+		const auto raw = reinterpret_cast<uintptr_t>(value);
+		std::memcpy(out, &raw, sizeof(raw));
+		return out + sizeof(raw);
+	}
+};
+
+template <typename... Args>
+struct DeferredArgTypes
+{
+	static constexpr DeferredArgType kTypes[sizeof...(Args) + 1] = {
+		DeferredArg<std::decay_t<Args>>::kType..., DeferredArgType::Int};
+	static constexpr size_t kCount = sizeof...(Args);
+};
+
+// Only used inside decltype() by the LOG_*_FMT macros.
+template <size_t N, typename... Args>
+DeferredArgTypes<Args...> DeduceDeferredArgTypes(const char (&format)[N], const Args&... args);
+
+// Reserves payload_size bytes for a record of the site; CommitDeferredRecord publishes it
+// (or, for RecordOnly, only hands it to the flight recorder).
+char* BeginDeferredRecord(const DeferredSite& site, const size_t payload_size, const LogDisposition disposition);
+void CommitDeferredRecord();
+
+template <size_t N, typename... Args>
+void LogDeferred(const DeferredSite& site, const LogDisposition disposition, const char (&)[N], const Args&... args)
+{
+	const size_t payload_size = (size_t{0} + ... + DeferredArg<std::decay_t<Args>>::Size(args));
+	auto* out = BeginDeferredRecord(site, payload_size, disposition);
+	((out = DeferredArg<std::decay_t<Args>>::Encode(out, args)), ...);
+	static_cast<void>(out);
+	CommitDeferredRecord();
+}
+
+// Renders a record captured by a deferred call site (prefix, formatted message and
+// trailing newline) into buffer. Usable offline on a dump of raw records; thread_tag
+// is the bracketed thread text of the producer (see GetThreadNumber/SetThreadName),
+// context its logging context (LogContext.h).
+void FormatDeferredRecord(
+	LogBuffer& buffer,
+	const DeferredSite& site,
+	const char* payload,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context = std::string_view());
+
+} // namespace SimpleLog
+
+#define PRIVATE_DEFERRED_FORMAT(format, ...) format
+
+#define PRIVATE_LOG_DEFERRED(m, type_filter, ...) \
+	do \
+	{ \
+		if constexpr (SimpleLog::GetLogLevel(m) >= SIMPLE_LOG_MIN_LEVEL) \
+		if (PRIVATE_CALL_SITE(private_call_site, m); true) \
+		if (const auto private_disposition = SimpleLog::GetLogDisposition(private_call_site, type_filter); \
+			private_disposition != SimpleLog::LogDisposition::Skip) \
+		{ \
+			using PrivateArgTypes = decltype(SimpleLog::DeduceDeferredArgTypes(__VA_ARGS__)); \
+			static constexpr SimpleLog::DeferredSite private_site{ \
+				&private_call_site, PRIVATE_DEFERRED_FORMAT(__VA_ARGS__, unused), \
+				PrivateArgTypes::kTypes, PrivateArgTypes::kCount}; \
+			SimpleLog::LogDeferred(private_site, private_disposition, __VA_ARGS__); \
+		} \
+	} while (false)
+
+#define LOG_DEFERRED_PRIVATE(m, ...) \
+	PRIVATE_LOG_DEFERRED(m, PRIVATE_LOG_TYPE_FILTER(m), __VA_ARGS__)
+
+#define LOG_FATAL_ERROR_FMT(...) \
+	LOG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::FatalError, __VA_ARGS__)
+#define LOG_ERROR_FMT(...) \
+	LOG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Error, __VA_ARGS__)
+#define LOG_WARNING_FMT(...) \
+	LOG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Warning, __VA_ARGS__)
+#define LOG_INFO_FMT(...) \
+	LOG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Info, __VA_ARGS__)
+
+#define LOG_DEBUG_DEFERRED_PRIVATE(m, ...) \
+	do \
+	{ \
+		if constexpr (SIMPLE_LOG_STRIP_DEBUG == 0) \
+		PRIVATE_LOG_DEFERRED(m, PRIVATE_DEBUG_LOG_TYPE_FILTER(m), __VA_ARGS__); \
+	} while (false)
+
+#define DEBUG_LOG_ERROR_FMT(...) \
+	LOG_DEBUG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Error, __VA_ARGS__)
+#define DEBUG_LOG_WARNING_FMT(...) \
+	LOG_DEBUG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Warning, __VA_ARGS__)
+#define DEBUG_LOG_INFO_FMT(...) \
+	LOG_DEBUG_DEFERRED_PRIVATE(SimpleLog::LogMessageType::Info, __VA_ARGS__)
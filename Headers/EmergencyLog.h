@@ -0,0 +1,46 @@
+#pragma once
+#include "Logger.h"
+
+#include <chrono>
+#include <string_view>
+
+namespace SimpleLog
+{
+
+// Emergency path for the lines a dying process must not lose. Everything on it is
+// async-signal-safe: no allocation, lock, stdio or iostream; lines are formatted by
+// hand into fixed buffers and written with write(2) to descriptors opened beforehand
+// (a crash file, STDERR_FILENO, ...), which stay owned by the caller.
+//
+// Once descriptors are added, every FatalError record (LOG_FATAL_ERROR, CHECK_FLOG_*,
+// LOG_FATAL_ERROR_FMT, ...) is also written to them as rendered, before its thread
+// flushes the asynchronous queue and the sinks: the line is out even if the process
+// hangs or dies during the flush. A descriptor that also backs a sink receives the
+// record twice.
+
+// At most 4 descriptors; returns false when they are all taken.
+bool AddEmergencyLogFd(const int fd);
+void RemoveEmergencyLogFds();
+
+// Writes "[type][time][tid N][file:line]$ message\n" to the emergency descriptors, or
+// to STDERR_FILENO when none were added, with the parts enabled by GetLogInfos(). For
+// signal handlers and code that cannot use the LOG_* statements; file_name may be null.
+// Messages are cut to about 1 KiB.
+void WriteEmergencyLog(
+	const LogMessageType message_type,
+	const char* const file_name,
+	const int line,
+	const std::string_view message);
+
+// Installs a handler for SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT. It writes
+// "Fatal signal N (NAME)" with the faulting address through WriteEmergencyLog, waits
+// up to flush_timeout for the asynchronous backend to write and flush every record
+// queued before the crash (without asynchronous logging, records are already in their
+// streams, and whatever those buffer is lost), dumps the flight recorder to the
+// emergency descriptors (see DumpFlightRecorderFromSignal), then restores the previous
+// handlers and raises the signal again. The handler runs on an alternate stack of the installing
+// thread, so that a stack overflow there can still be reported.
+void InstallCrashHandler(const std::chrono::milliseconds flush_timeout = std::chrono::milliseconds(500));
+void UninstallCrashHandler();
+
+} // namespace SimpleLog
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+
+namespace SimpleLog
+{
+
+// Flight recorder: while enabled, every thread keeps its last messages in a private
+// ring of bytes_per_thread bytes, the oldest being overwritten first. Messages filtered
+// out by SetLogMessageTypes, and DEBUG_LOG_* messages in Release LogType, are recorded
+// too, without being written to any sink. Text messages are copied as rendered;
+// deferred (LOG_*_FMT) records keep their raw arguments and are only formatted when
+// dumped.
+//
+// Every FatalError record (LOG_FATAL_ERROR, CHECK_FLOG_*, ...) dumps the recorder once
+// its sinks are flushed: the rings of all running threads are merged by timestamp and
+// written to dump_stream between "[flight recorder: N records]" and
+// "[flight recorder end]" lines, then emptied.
+//
+// Enabling again resizes and empties the rings; DisableFlightRecorder empties them.
+//
+// The recorder is off until EnableFlightRecorder is called, not always on. Recording a
+// statement that no sink takes means rendering its text or packing its LOG_*_FMT
+// arguments. Left on by default, that cost would land on every suppressed and
+// DEBUG_LOG_* statement, which otherwise costs a relaxed load of the config word (see
+// GetLogDisposition). A process that wants the crash context enables it at startup.
+void EnableFlightRecorder(const size_t bytes_per_thread = 64 << 10, std::ostream& dump_stream = std::cerr);
+void DisableFlightRecorder();
+bool IsFlightRecorderEnabled();
+
+// Writes and empties the rings as on a FatalError record; returns the record count.
+size_t DumpFlightRecorder();
+
+// Async-signal-safe dump for crash handlers: writes the same lines with write(2) to fd,
+// without allocating, taking the registry lock or emptying the rings. A ring whose
+// thread holds it (e.g. the one that crashed while recording) is skipped and counted
+// in the header line; rings of threads beyond the first 256 are not reached. Returns
+// the record count.
+size_t DumpFlightRecorderFromSignal(const int fd);
+
+} // namespace SimpleLog
@@ -0,0 +1,86 @@
+#pragma once
+#include "Logger.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace SimpleLog
+{
+
+// Per-thread logging context (mapped diagnostic context): key=value pairs pushed by
+// ScopedContext and attached to every record the thread logs while they are in scope.
+// The pairs are rendered once, as logfmt, when pushed; each record copies the rendered
+// text. The line layout shows it after the thread tag as "[req=42 user=bob]" whatever
+// the LogInfos; the logfmt formatter writes the pairs before msg, the JSON formatter a
+// "ctx" string. Deferred (LOG_*_FMT) records keep the context of the statement, not
+// of the thread formatting them.
+
+// Copy of a thread's context, to carry it to another thread or across a coroutine
+// suspension (see CaptureLogContext).
+class LogContext
+{
+public:
+	LogContext() = default;
+
+	// "req=42 user=bob"; empty without context.
+	std::string_view Get() const
+	{
+		return text_;
+	}
+
+private:
+	friend LogContext CaptureLogContext();
+	friend class ScopedContext;
+
+	std::string text_;
+};
+
+LogContext CaptureLogContext();
+
+// The context of the calling thread, as LogContext::Get().
+std::string_view GetLogContext();
+
+// Pushes one pair, or installs a captured context in place of the thread's own, until
+// destroyed. Scopes nest and must be destroyed in reverse order on the thread that
+// created them:
+//
+//     SimpleLog::ScopedContext request("req", id);
+//     pool.Post([context = SimpleLog::CaptureLogContext()]
+//     {
+//         SimpleLog::ScopedContext restore(context);
+//         LOG_INFO << "Step";  // [req=42]
+//     });
+//
+// Values follow Logger::kv: numbers and bools as such, text quoted when needed, other
+// types through their LogValue or ostream operator<<.
+class ScopedContext
+{
+public:
+	template <typename T>
+	ScopedContext(const LogKey key, const T& value);
+	explicit ScopedContext(const LogContext& context);
+	~ScopedContext();
+
+	ScopedContext(const ScopedContext&) = delete;
+	ScopedContext& operator=(const ScopedContext&) = delete;
+
+private:
+	// Appends the " key=value" pair to the thread's context; returns the size it had
+	// before.
+	static size_t Push(const std::string_view pair);
+
+	// Context size to truncate back to, or npos to restore previous_.
+	size_t previous_size_ = std::string::npos;
+	std::string previous_;
+};
+
+template <typename T>
+ScopedContext::ScopedContext(const LogKey key, const T& value)
+{
+	LogBuffer pair;
+	AppendLogfmtField(pair, key, value);
+	previous_size_ = Push(std::string_view(pair.Data(), pair.Size()));
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,211 @@
+#pragma once
+#include "BatchedFileStream.h"
+#include "Logger.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SimpleLog
+{
+
+constexpr uint32_t kAllLogMessageTypes =
+	static_cast<uint32_t>(LogMessageType::Error) |
+	static_cast<uint32_t>(LogMessageType::Warning) |
+	static_cast<uint32_t>(LogMessageType::Info) |
+	static_cast<uint32_t>(LogMessageType::FatalError);
+
+constexpr uint32_t kAllLogInfos =
+	static_cast<uint32_t>(LogInfos::ThreadId) |
+	static_cast<uint32_t>(LogInfos::TimeStamp) |
+	static_cast<uint32_t>(LogInfos::FileNameWithLine);
+
+// One finished message as handed to the sinks. The views are valid only during the
+// LogSink::Write call.
+struct LogRecord
+{
+	LogMessageType message_type;
+	int64_t timestamp_ns;
+	// "[number]" or "[number:name]" of the producing thread.
+	std::string_view thread_tag;
+	std::string_view file_name;
+	int line;
+	// The text after "$ ", without the newline.
+	std::string_view message;
+	// The whole line in the global format (GetLogInfos()), newline included; fields
+	// follow the message as " key=value".
+	std::string_view text;
+	// Structured fields (Logger::kv) in the order they were added, as logfmt pairs that
+	// each start with a space: " user=42 name=\"bob smith\"". Unquoted values are
+	// numbers or bools; text that could be read as one is quoted.
+	std::string_view fields;
+	// Context of the producing thread as logfmt pairs, "req=42 user=bob" (see
+	// LogContext.h); empty without context.
+	std::string_view context;
+};
+
+class LogFormatter
+{
+public:
+	virtual ~LogFormatter() = default;
+	// Appends the complete line of record, newline included, to out.
+	virtual void Format(const LogRecord& record, LogBuffer& out) const = 0;
+};
+
+// The library's line format with a fixed LogInfos mask instead of GetLogInfos().
+class LogInfosFormatter : public LogFormatter
+{
+public:
+	explicit LogInfosFormatter(const uint32_t log_infos);
+	void Format(const LogRecord& record, LogBuffer& out) const override;
+
+private:
+	const uint32_t log_infos_;
+};
+
+// One JSON object per line:
+// {"level":"info","ts":<ns since epoch>,"thread":"3:name","file":"a.cpp","line":7,"ctx":"req=42","msg":"...",<fields>}
+// log_infos selects ts, thread and file/line; ctx is only written with a context. Numeric fields stay JSON numbers
+// (non-finite doubles become null); fields keep their logfmt key (see LogfmtFormatter).
+class JsonFormatter : public LogFormatter
+{
+public:
+	explicit JsonFormatter(const uint32_t log_infos = kAllLogInfos);
+	void Format(const LogRecord& record, LogBuffer& out) const override;
+
+private:
+	const uint32_t log_infos_;
+};
+
+// One logfmt line: level=info ts=<ns> thread=3:name file=a.cpp line=7 <context> msg="..." <fields>.
+// Values are quoted only when they contain spaces, '=', quotes or control characters;
+// key characters that logfmt cannot carry are replaced by '_'.
+class LogfmtFormatter : public LogFormatter
+{
+public:
+	explicit LogfmtFormatter(const uint32_t log_infos = kAllLogInfos);
+	void Format(const LogRecord& record, LogBuffer& out) const override;
+
+private:
+	const uint32_t log_infos_;
+};
+
+// Destination of records. Write() may be called from several threads at once (only
+// from the backend thread in asynchronous mode) and must not add or remove sinks.
+class LogSink
+{
+public:
+	explicit LogSink(
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr);
+	virtual ~LogSink() = default;
+
+	LogSink(const LogSink&) = delete;
+	LogSink& operator=(const LogSink&) = delete;
+
+	uint32_t GetMessageTypes() const;
+	void SetMessageTypes(const uint32_t message_types);
+	// Null when the sink takes LogRecord::text as is.
+	const LogFormatter* GetFormatter() const;
+
+	// text is the record rendered by the sink's formatter.
+	virtual void Write(const LogRecord& record, std::string_view text) = 0;
+	virtual void Flush();
+
+	// Records and bytes handed to Write by the logger, and the time spent in Write
+	// while logger timing is enabled (LoggerStats.h).
+	uint64_t GetWrittenRecords() const;
+	uint64_t GetWrittenBytes() const;
+	uint64_t GetWriteTime() const;
+
+private:
+	friend void DispatchLogRecord(const LogRecord& record);
+
+	void WriteCounted(const LogRecord& record, const std::string_view text);
+	void WriteFormatted(const LogRecord& record, LogBuffer& buffer);
+
+	// Written by every logging thread: kept off the line of the read-mostly members.
+	struct alignas(64) WriteCounters
+	{
+		std::atomic<uint64_t> records{0};
+		std::atomic<uint64_t> bytes{0};
+		std::atomic<uint64_t> write_ns{0};
+	};
+
+	std::atomic<uint32_t> message_types_;
+	const std::shared_ptr<const LogFormatter> formatter_;
+	WriteCounters counters_;
+};
+
+// Writes to a stream the caller keeps alive until the sink is removed.
+class StreamSink : public LogSink
+{
+public:
+	explicit StreamSink(
+		std::ostream& stream,
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr);
+
+	std::ostream& GetStream() const;
+	void Write(const LogRecord& record, std::string_view text) override;
+	void Flush() override;
+
+private:
+	std::ostream& stream_;
+};
+
+// Appends to a file through a group-commit BatchedFileStream.
+class FileSink : public LogSink
+{
+public:
+	explicit FileSink(
+		const std::string& path,
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr,
+		const BatchedFileOptions& options = BatchedFileOptions());
+
+	bool IsOpen() const;
+	void Write(const LogRecord& record, std::string_view text) override;
+	void Flush() override;
+
+private:
+	BatchedFileStream stream_;
+};
+
+// Keeps the last capacity lines in memory.
+class MemorySink : public LogSink
+{
+public:
+	explicit MemorySink(
+		const size_t capacity,
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr);
+
+	std::vector<std::string> GetLines() const;
+	void Clear();
+	void Write(const LogRecord& record, std::string_view text) override;
+
+private:
+	const size_t capacity_;
+	mutable std::mutex mutex_;
+	std::deque<std::string> lines_;
+};
+
+// Sink registry. Every record of the LOG_* macros goes to each registered sink whose
+// mask has its type. Logging threads read the sink list without locking; changes
+// publish a new list and return once no thread can still be writing to a removed
+// sink, so the sink (or its stream) may be destroyed right after.
+//
+// The registry starts with two StreamSinks: GetLogStream() for Info and Warning and
+// GetELogStream() for Error and FatalError. SetLogStream/SetELogStream replace them.
+void AddLogSink(std::shared_ptr<LogSink> sink);
+void RemoveLogSink(const std::shared_ptr<LogSink>& sink);
+std::vector<std::shared_ptr<LogSink>> GetLogSinks();
+void FlushLogSinks();
+
+} // namespace SimpleLog
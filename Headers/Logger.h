@@ -1,11 +1,49 @@
 #pragma once
 #include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 #include <shared_mutex>
 #include <sstream>
 
+// Compile-time severity floor. Statements below it (and every DEBUG_LOG_* statement
+// when SIMPLE_LOG_STRIP_DEBUG is non-zero) are discarded by the compiler: no branch,
+// no call and no argument code is emitted. CHECK_* macros still evaluate and act on
+// their condition, only the logging part is dropped. Set through the CMake cache
+// variables of the same names.
+#define SIMPLE_LOG_LEVEL_INFO 0
+#define SIMPLE_LOG_LEVEL_WARNING 1
+#define SIMPLE_LOG_LEVEL_ERROR 2
+#define SIMPLE_LOG_LEVEL_FATAL_ERROR 3
+#define SIMPLE_LOG_LEVEL_NONE 4
+
+#ifndef SIMPLE_LOG_MIN_LEVEL
+#define SIMPLE_LOG_MIN_LEVEL SIMPLE_LOG_LEVEL_INFO
+#endif
+
+#ifndef SIMPLE_LOG_STRIP_DEBUG
+#define SIMPLE_LOG_STRIP_DEBUG 0
+#endif
+
+// SIMPLE_LOG_COLD marks the out-of-line functions entered by emitting statements and
+// failed CHECK_* macros: they are laid out in .text.unlikely, away from the code around
+// the statement, and the branch reaching them is predicted not taken.
+#if defined(__GNUC__)
+#define SIMPLE_LOG_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define SIMPLE_LOG_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#define SIMPLE_LOG_COLD __attribute__((cold, noinline))
+#else
+#define SIMPLE_LOG_LIKELY(condition) (condition)
+#define SIMPLE_LOG_UNLIKELY(condition) (condition)
+#define SIMPLE_LOG_COLD
+#endif
+
 namespace SimpleLog
 {
 
@@ -30,6 +68,706 @@ enum class LogType : uint32_t
 	Release = 2,
 };
 
+enum class TimeStampFormat : uint32_t
+{
+	Default = 0, // (GMT)16-10-2026(12:00:00)
+	Iso8601 = 1, // 2026-10-16T12:00:00Z
+	EpochNanoseconds = 2, // 1760616000000000000
+};
+
+// Number of fractional second digits appended by the Default and Iso8601 formats.
+enum class TimeStampPrecision : uint32_t
+{
+	Seconds = 0,
+	Milliseconds = 3,
+	Microseconds = 6,
+	Nanoseconds = 9,
+};
+
+// Severity order used by SIMPLE_LOG_MIN_LEVEL.
+constexpr uint32_t GetLogLevel(const LogMessageType message_type)
+{
+	switch (message_type)
+	{
+	case LogMessageType::Warning:
+		return SIMPLE_LOG_LEVEL_WARNING;
+	case LogMessageType::Error:
+		return SIMPLE_LOG_LEVEL_ERROR;
+	case LogMessageType::FatalError:
+		return SIMPLE_LOG_LEVEL_FATAL_ERROR;
+	case LogMessageType::Info:
+	default:
+		return SIMPLE_LOG_LEVEL_INFO;
+	}
+}
+
+// Dense index of a message type: Error 0, Warning 1, Info 2, FatalError 3.
+constexpr size_t GetLogMessageTypeIndex(const LogMessageType message_type)
+{
+	switch (message_type)
+	{
+	case LogMessageType::Error:
+		return 0;
+	case LogMessageType::Warning:
+		return 1;
+	case LogMessageType::Info:
+		return 2;
+	case LogMessageType::FatalError:
+	default:
+		return 3;
+	}
+}
+
+constexpr size_t GetFileNameOffset(const char* const path, const size_t size)
+{
+	size_t offset = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (path[i] == '/' || path[i] == '\\')
+		{
+			offset = i + 1;
+		}
+	}
+	return offset;
+}
+
+// The filters of every LOG_* and DEBUG_LOG_* statement, packed into one word alone on
+// its cache line so that checking a statement is a relaxed load and a bit test:
+// bits 0-3 hold the enabled message types, bits 4-7 the message types enabled for
+// DEBUG_LOG_* (none under LogType::Release), bit 8 is set under LogType::Debug, bit 9
+// while the flight recorder is enabled, bit 10 while suppressed statements are counted
+// and bits 11-12 while SetLogVModule() overrides exist, so that every statement, or
+// every DEBUG_LOG_* one under LogType::Debug, asks its call site. Only the setters
+// write it; the macros read it through detail::log_config.
+struct alignas(64) LogConfig
+{
+	static constexpr uint32_t kMessageTypes = 0xF;
+	static constexpr uint32_t kDebugTypesShift = 4;
+	static constexpr uint32_t kDebug = 0x100;
+	static constexpr uint32_t kFlightRecorder = 0x200;
+	static constexpr uint32_t kCountSuppressed = 0x400;
+	static constexpr uint32_t kVModule = 0x800;
+	static constexpr uint32_t kDebugVModule = 0x1000;
+	static constexpr uint32_t kOverrides = kVModule | kDebugVModule;
+
+	std::atomic<uint32_t> word;
+	// Generation of the call site rules, bumped by SetCallSiteEnabled() and
+	// SetLogVModule(); a site resolved in an older one resolves again. Never 0.
+	std::atomic<uint32_t> generation;
+};
+
+// Not part of the API: state the inline statement checks read.
+namespace detail
+{
+
+extern LogConfig log_config;
+
+} // namespace detail
+
+// Constant-initialised record owned by every LOG_* statement. It carries the
+// pre-rendered "path/file.cpp:line]" text (the prefix prints it from the basename on)
+// and the site's decision under the SetCallSiteEnabled() and SetLogVModule() rules,
+// resolved on its first evaluation and again after each change of the rules.
+class CallSite
+{
+public:
+	template <size_t N>
+	constexpr CallSite(
+		const char (&file_line)[N],
+		const size_t file_size,
+		const int line,
+		const LogMessageType message_type)
+		: file_line_(file_line)
+		, file_line_size_(N - 1)
+		, file_size_(file_size)
+		, file_name_offset_(GetFileNameOffset(file_line, file_size))
+		, line_(line)
+		, message_type_(message_type)
+	{}
+
+	CallSite(const CallSite&) = delete;
+	CallSite& operator=(const CallSite&) = delete;
+
+	// Whether the statement logs, given whether the global filters (message types and
+	// LogType) enable its type: a vmodule override replaces them.
+	bool IsEnabled(const bool type_enabled)
+	{
+		const auto decision = GetDecision();
+		return decision == kForced || (decision == kFollowFilters && type_enabled);
+	}
+
+	// Whether SetCallSiteEnabled() leaves the statement on, whatever its type.
+	bool IsSwitchedOn() { return GetDecision() != kSwitchedOff; }
+
+	// Full path as given by __FILE__.
+	std::string_view GetFile() const { return std::string_view(file_line_, file_size_); }
+	std::string_view GetFileName() const { return GetFile().substr(file_name_offset_); }
+	// "file.cpp:line]"
+	std::string_view GetFileNameWithLine() const
+	{
+		return std::string_view(file_line_ + file_name_offset_, file_line_size_ - file_name_offset_);
+	}
+	int GetLine() const { return line_; }
+	LogMessageType GetMessageType() const { return message_type_; }
+
+private:
+	friend class CallSiteRegistry;
+
+	// state_ holds the decision in its low bits and the generation of the rules it was
+	// resolved in above them; 0 is never a current generation.
+	static constexpr uint32_t kDecisionBits = 3;
+	static constexpr uint32_t kFollowFilters = 1;
+	static constexpr uint32_t kSwitchedOff = 2;
+	// A vmodule pattern enables, or filters out, the site's type.
+	static constexpr uint32_t kForced = 3;
+	static constexpr uint32_t kFiltered = 4;
+
+	uint32_t GetDecision()
+	{
+		const auto state = state_.load(std::memory_order_relaxed);
+		if (SIMPLE_LOG_LIKELY((state >> kDecisionBits) == detail::log_config.generation.load(std::memory_order_relaxed)))
+		{
+			return state & ((1u << kDecisionBits) - 1);
+		}
+		return Resolve();
+	}
+
+	// Out of line: decides under the current rules and caches the decision.
+	uint32_t Resolve();
+
+	const char* const file_line_;
+	const size_t file_line_size_;
+	const size_t file_size_;
+	const size_t file_name_offset_;
+	const int line_;
+	const LogMessageType message_type_;
+	std::atomic<uint32_t> state_{0};
+};
+
+// Switches matching LOG_* statements on or off at runtime. file_name is compared with
+// the full __FILE__ path or its trailing path components; line <= 0 selects every
+// statement of the file. The rule also applies to statements not reached yet. A
+// switched-off statement stays off whatever SetLogVModule() says.
+void SetCallSiteEnabled(const char* file_name, const int line, const bool enabled);
+
+// Per-module overrides of SetLogMessageTypes(), as comma-separated "pattern=level"
+// entries such as "net/*=info,db/pool.cpp=warning". A pattern is a glob ('*' matches
+// any run of characters, '/' included, and '?' one character) matched against the
+// __FILE__ path or its trailing path components; level is the least severe type
+// enabled in the matching files: info, warning, error, fatal or off. The last
+// matching entry wins, and files without one follow the global filters. DEBUG_LOG_*
+// statements are overridden only under LogType::Debug. Replaces the previous
+// overrides ("" clears them); a malformed spec returns false and changes nothing.
+bool SetLogVModule(const std::string_view spec);
+std::string GetLogVModule();
+
+namespace detail
+{
+
+// Counters of the calling thread's statements dropped before formatting, indexed by
+// GetLogMessageTypeIndex(); null until the thread's first one (see LoggerStats.h).
+inline thread_local std::atomic<uint64_t>* thread_suppressed_counts = nullptr;
+
+} // namespace detail
+
+// Out of line: sets up the counters of the thread, then counts.
+void CountFirstSuppressed(const LogMessageType message_type);
+
+// Counts a statement dropped before formatting. Only the owning thread writes its
+// counters, so a relaxed load and store replace the locked increment.
+inline void IncrementSuppressed(const LogMessageType message_type)
+{
+	if (auto* const counts = detail::thread_suppressed_counts; SIMPLE_LOG_LIKELY(counts != nullptr))
+	{
+		auto& count = counts[GetLogMessageTypeIndex(message_type)];
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+	CountFirstSuppressed(message_type);
+}
+
+// Same, while enabled by SetSuppressedCountingEnabled() (see LoggerStats.h).
+inline void CountSuppressed(const LogMessageType message_type)
+{
+	if ((detail::log_config.word.load(std::memory_order_relaxed) & LogConfig::kCountSuppressed) != 0)
+	{
+		IncrementSuppressed(message_type);
+	}
+}
+
+// Per-site limiters of the LOG_*_EVERY_N/FIRST_N/EVERY_T/SAMPLED macros. Check()
+// returns kRateLimited for a suppressed call, otherwise the number of calls suppressed
+// since the previous emitted one. Every counter is a lock-free atomic of the site.
+constexpr uint64_t kRateLimited = UINT64_MAX;
+
+class EveryNLimiter
+{
+public:
+	uint64_t Check(const uint64_t n)
+	{
+		const auto count = count_.fetch_add(1, std::memory_order_relaxed);
+		if (n <= 1)
+		{
+			return 0;
+		}
+		if (count % n != 0)
+		{
+			return kRateLimited;
+		}
+		return count == 0 ? 0 : n - 1;
+	}
+
+private:
+	std::atomic<uint64_t> count_{0};
+};
+
+class FirstNLimiter
+{
+public:
+	uint64_t Check(const uint64_t n)
+	{
+		// Past the limit the site only reads the counter.
+		if (count_.load(std::memory_order_relaxed) >= n)
+		{
+			return kRateLimited;
+		}
+		return count_.fetch_add(1, std::memory_order_relaxed) < n ? 0 : kRateLimited;
+	}
+
+private:
+	std::atomic<uint64_t> count_{0};
+};
+
+class EveryTLimiter
+{
+public:
+	uint64_t Check(const double interval_seconds)
+	{
+		const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		auto next = next_ns_.load(std::memory_order_relaxed);
+		if (now >= next &&
+			next_ns_.compare_exchange_strong(next, now + static_cast<int64_t>(interval_seconds * 1e9), std::memory_order_relaxed))
+		{
+			return suppressed_.exchange(0, std::memory_order_relaxed);
+		}
+		suppressed_.fetch_add(1, std::memory_order_relaxed);
+		return kRateLimited;
+	}
+
+private:
+	std::atomic<int64_t> next_ns_{INT64_MIN};
+	std::atomic<uint64_t> suppressed_{0};
+};
+
+// xorshift64* generator private to the calling thread.
+inline uint64_t NextSampleRandom()
+{
+	thread_local uint64_t state = 0;
+	if (state == 0)
+	{
+		state = reinterpret_cast<uintptr_t>(&state) | 1;
+	}
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545F4914F6CDD1DULL;
+}
+
+class SampledLimiter
+{
+public:
+	uint64_t Check(const double probability)
+	{
+		if (probability < 1.0 && static_cast<double>(NextSampleRandom() >> 11) >= probability * 9007199254740992.0)
+		{
+			suppressed_.fetch_add(1, std::memory_order_relaxed);
+			return kRateLimited;
+		}
+		return suppressed_.exchange(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> suppressed_{0};
+};
+
+template <typename Limiter>
+class RateLimitedCallSite : public CallSite, public Limiter
+{
+public:
+	template <size_t N>
+	constexpr RateLimitedCallSite(
+		const char (&file_line)[N],
+		const size_t file_size,
+		const int line,
+		const LogMessageType message_type)
+		: CallSite(file_line, file_size, line, message_type)
+	{}
+
+	template <typename Argument>
+	uint64_t Check(const Argument argument)
+	{
+		const auto suppressed = Limiter::Check(argument);
+		if (suppressed == kRateLimited)
+		{
+			CountSuppressed(GetMessageType());
+		}
+		return suppressed;
+	}
+};
+
+// Growable character arena reused by every message of a thread. Loggers nest on it
+// like a stack: each one owns the bytes appended after its construction, so only
+// warming up the arena ever touches the heap. Types without a dedicated overload
+// are formatted through an std::ostream bound to the same arena.
+class LogBuffer : private std::streambuf
+{
+public:
+	LogBuffer();
+	LogBuffer(const LogBuffer&) = delete;
+	LogBuffer& operator=(const LogBuffer&) = delete;
+
+	void Append(const char* data, const size_t size);
+	void Append(const char c);
+
+	const char* Data() const;
+	// For in-place edits of the bytes a logger owns.
+	char* Data();
+	size_t Size() const;
+	void Truncate(const size_t size);
+
+	std::ostream& Stream();
+	// Restores the default formatting state after manipulators of a previous message.
+	void ResetStream();
+	// True while no manipulator changed the stream state set by ResetStream().
+	bool HasDefaultFormat() const;
+
+private:
+	int_type overflow(int_type ch) override;
+	std::streamsize xsputn(const char* data, std::streamsize count) override;
+	void Grow(const size_t min_capacity);
+
+	std::unique_ptr<char[]> data_;
+	size_t size_ = 0;
+	size_t capacity_ = 0;
+	std::ostream stream_;
+};
+
+LogBuffer& GetThreadLogBuffer();
+
+void AppendFloatingPoint(LogBuffer& buffer, const float value);
+void AppendFloatingPoint(LogBuffer& buffer, const double value);
+void AppendPointer(LogBuffer& buffer, const void* value);
+
+// A null C string prints as "(null)" rather than reaching strlen.
+inline std::string_view ToLogString(const char* const value)
+{
+	return value != nullptr ? std::string_view(value) : std::string_view("(null)");
+}
+
+template <typename T>
+void AppendInteger(LogBuffer& buffer, const T value)
+{
+	char digits[24];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+	buffer.Append(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+// Only converts to E itself, so the probe below finds user operators taking E but not
+// the standard ones an unscoped enum would reach through integral conversion.
+template <typename E>
+struct EnumExactMatch
+{
+	template <typename U, typename = std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, E>>>
+	operator U&() const;
+};
+
+template <typename E, typename Enable = void>
+struct HasEnumStreamOperator : std::false_type {};
+
+template <typename E>
+struct HasEnumStreamOperator<E, std::void_t<decltype(
+	operator<<(std::declval<std::ostream&>(), EnumExactMatch<E>()))>> : std::true_type {};
+
+template <typename T>
+constexpr bool kIsLogCharacter =
+	std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>;
+
+// Writes a value of a message. Built-in types are formatted straight into the buffer
+// (floating point as the shortest round-trip text); other types, and every value
+// after a manipulator changed the stream format, use the ostream operator<<.
+template <typename T, typename Enable = void>
+struct LogValue
+{
+	static void Append(LogBuffer& buffer, const T& value)
+	{
+		buffer.Stream() << value;
+	}
+};
+
+template <typename T>
+struct LogValue<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !kIsLogCharacter<T>>>
+{
+	static void Append(LogBuffer& buffer, const T value)
+	{
+		if (buffer.HasDefaultFormat())
+		{
+			AppendInteger(buffer, value);
+		}
+		else
+		{
+			buffer.Stream() << value;
+		}
+	}
+};
+
+template <typename T>
+struct LogValue<T, std::enable_if_t<std::is_same_v<T, float> || std::is_same_v<T, double>>>
+{
+	static void Append(LogBuffer& buffer, const T value)
+	{
+		if (buffer.HasDefaultFormat())
+		{
+			AppendFloatingPoint(buffer, value);
+		}
+		else
+		{
+			buffer.Stream() << value;
+		}
+	}
+};
+
+template <>
+struct LogValue<bool>
+{
+	static void Append(LogBuffer& buffer, const bool value)
+	{
+		if (buffer.HasDefaultFormat())
+		{
+			buffer.Append(value ? '1' : '0');
+		}
+		else
+		{
+			buffer.Stream() << value;
+		}
+	}
+};
+
+template <typename T>
+struct LogValue<T, std::enable_if_t<kIsLogCharacter<T>>>
+{
+	static void Append(LogBuffer& buffer, const T value)
+	{
+		if (buffer.HasDefaultFormat())
+		{
+			buffer.Append(static_cast<char>(value));
+		}
+		else
+		{
+			buffer.Stream() << value;
+		}
+	}
+};
+
+template <>
+struct LogValue<char*>
+{
+	static void Append(LogBuffer& buffer, const char* const value)
+	{
+		const auto text = ToLogString(value);
+		buffer.Append(text.data(), text.size());
+	}
+};
+
+template <>
+struct LogValue<std::string_view>
+{
+	static void Append(LogBuffer& buffer, const std::string_view value)
+	{
+		buffer.Append(value.data(), value.size());
+	}
+};
+
+template <typename T>
+struct LogValue<T*, std::enable_if_t<!kIsLogCharacter<std::remove_cv_t<T>> && !std::is_function_v<T>>>
+{
+	static void Append(LogBuffer& buffer, const T* const value)
+	{
+		if (buffer.HasDefaultFormat())
+		{
+			AppendPointer(buffer, value);
+		}
+		else
+		{
+			buffer.Stream() << static_cast<const void*>(value);
+		}
+	}
+};
+
+template <typename T>
+struct LogValue<T, std::enable_if_t<std::is_enum_v<T> && !HasEnumStreamOperator<T>::value>>
+{
+	static void Append(LogBuffer& buffer, const T value)
+	{
+		// Promoted like the ostream inserter does, so char-based enums print as numbers.
+		const auto number = +static_cast<std::underlying_type_t<T>>(value);
+		LogValue<std::decay_t<decltype(number)>>::Append(buffer, number);
+	}
+};
+
+// Key characters every encoder writes verbatim.
+constexpr bool IsPlainKeyCharacter(const char c)
+{
+	return c > ' ' && c < '\x7f' && c != '"' && c != '\\' && c != '=';
+}
+
+// Key of a structured field (see Logger::kv). Whether it needs quoting or escaping is
+// decided once when the key is built: at compile time for literals and constexpr keys.
+class LogKey
+{
+public:
+	LogKey() = default;
+
+	template <size_t N>
+	constexpr LogKey(const char (&key)[N])
+		: LogKey(std::string_view(key))
+	{}
+
+	constexpr explicit LogKey(const std::string_view key)
+		: key_(key)
+		, plain_(IsPlainKey(key))
+	{}
+
+	constexpr std::string_view Get() const
+	{
+		return key_;
+	}
+
+	// True when the key is written as is by every encoder.
+	constexpr bool IsPlain() const
+	{
+		return plain_;
+	}
+
+private:
+	static constexpr bool IsPlainKey(const std::string_view key)
+	{
+		if (key.empty())
+		{
+			return false;
+		}
+		for (const auto c : key)
+		{
+			if (!IsPlainKeyCharacter(c))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::string_view key_;
+	bool plain_ = false;
+};
+
+// Logfmt encoding of structured fields, shared by Logger::kv and ScopedContext
+// (LogEncoders.cpp). A key that is not plain has the characters logfmt cannot carry
+// replaced by '_'.
+void AppendOddLogfmtKey(LogBuffer& out, const std::string_view key);
+// Appends text as a logfmt value: quoted and escaped as a JSON string when it holds
+// spaces, '=', quotes or control characters, or could be read as a number or bool.
+void AppendLogfmtText(LogBuffer& out, const std::string_view text);
+// Same for a value already rendered at the end of out, from begin on.
+void QuoteLogfmtText(LogBuffer& out, const size_t begin);
+
+// Appends " key=value": numbers and bools as such, text through AppendLogfmtText,
+// other types rendered by their LogValue first.
+template <typename T>
+void AppendLogfmtField(LogBuffer& out, const LogKey key, const T& value)
+{
+	out.Append(' ');
+	if (key.IsPlain())
+	{
+		out.Append(key.Get().data(), key.Get().size());
+	}
+	else
+	{
+		AppendOddLogfmtKey(out, key.Get());
+	}
+	out.Append('=');
+	if constexpr (std::is_same_v<T, bool>)
+	{
+		if (value)
+		{
+			out.Append("true", 4);
+		}
+		else
+		{
+			out.Append("false", 5);
+		}
+	}
+	else if constexpr (std::is_integral_v<T> && !kIsLogCharacter<T>)
+	{
+		AppendInteger(out, value);
+	}
+	else if constexpr (std::is_floating_point_v<T>)
+	{
+		AppendFloatingPoint(out, static_cast<double>(value));
+	}
+	else if constexpr (std::is_enum_v<T> && !HasEnumStreamOperator<T>::value)
+	{
+		AppendInteger(out, +static_cast<std::underlying_type_t<T>>(value));
+	}
+	else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+	{
+		AppendLogfmtText(out, std::string_view(value));
+	}
+	else
+	{
+		const auto begin = out.Size();
+		LogValue<T>::Append(out, value);
+		QuoteLogfmtText(out, begin);
+	}
+}
+
+// What a LOG_* statement does with its message: RecordOnly messages are filtered out
+// (by type, or Release LogType for DEBUG_LOG_*) but still kept by the flight recorder
+// (see FlightRecorder.h).
+enum class LogDisposition : uint8_t
+{
+	Skip = 0,
+	Emit,
+	RecordOnly,
+};
+
+// Out of line, while the flight recorder is enabled: counts the statement as
+// suppressed and decides whether the recorder still wants it.
+LogDisposition GetSuppressedLogDisposition(CallSite& site);
+
+// type_filter is the statement's bits of the config word (GetLogTypeFilter): zero
+// when its type is filtered out and no vmodule override exists. Filtered-out
+// statements are the common case on hot paths: they cost two loads and tests of the
+// config word, plus the per-thread suppressed counter once counting is enabled, and
+// the emitting branch is laid out of line.
+inline LogDisposition GetLogDisposition(CallSite& site, const uint32_t type_filter)
+{
+	if (SIMPLE_LOG_UNLIKELY(type_filter != 0) &&
+		SIMPLE_LOG_LIKELY(site.IsEnabled((type_filter & ~LogConfig::kOverrides) != 0)))
+	{
+		return LogDisposition::Emit;
+	}
+	const auto config = detail::log_config.word.load(std::memory_order_relaxed);
+	if (SIMPLE_LOG_UNLIKELY((config & LogConfig::kFlightRecorder) != 0))
+	{
+		return GetSuppressedLogDisposition(site);
+	}
+	if ((config & LogConfig::kCountSuppressed) != 0)
+	{
+		IncrementSuppressed(site.GetMessageType());
+	}
+	return LogDisposition::Skip;
+}
+
 class Logger
 {
 public:
@@ -38,60 +776,364 @@ public:
 		const LogMessageType message_type,
 		const char* file_name,
 		const int line);
+	Logger(std::ostream& out_str, const CallSite& site);
+	// Writes to the registered sinks (see LogSink.h) instead of a single stream. Cold:
+	// the message formatting and the destructor of a LOG_* statement, with its unwinding
+	// code, are moved out of the function around it.
+	SIMPLE_LOG_COLD explicit Logger(const CallSite& site, const LogDisposition disposition = LogDisposition::Emit);
 
 	template <typename T>
 	Logger& operator<<(const T& value);
+	Logger& operator<<(const char* value);
+	Logger& operator<<(const std::string& value);
+	// Notes how many calls of a rate-limited site were dropped before this one.
+	Logger& Suppressed(const uint64_t count);
+	// Adds a typed field: LOG_INFO.kv("user", id).kv("latency_us", t) << "Login".
+	// The field is encoded once, as " key=value" after the message, which is how the
+	// text format shows it; sinks may re-encode fields as JSON or logfmt (see
+	// LogSink.h).
+	template <typename T>
+	Logger& kv(const LogKey key, const T& value);
 	~Logger();
 private:
-	std::stringstream ss_;
-	std::ostream& out_str_;
+	Logger(std::ostream* out_str, const CallSite& site, const LogDisposition disposition);
+
+	void MoveFieldsToEnd();
+
+	LogBuffer& buffer_;
+	const size_t begin_;
+	size_t message_begin_;
+	// Null for records going to the sink registry.
+	std::ostream* const stream_;
+	const LogMessageType message_type_;
+	const int64_t timestamp_ns_;
+	const std::string_view file_name_;
+	const int line_;
+	const LogDisposition disposition_;
+	// Start of the message formatting, while timing is enabled (see LoggerStats.h).
+	int64_t format_begin_ns_ = 0;
+	// The " key=value" fields are written to buffer_ as they come and kept together in
+	// [fields_begin_, fields_end_); message text appended after them is moved in front
+	// by the next kv() or the destructor.
+	size_t fields_begin_ = 0;
+	size_t fields_end_ = 0;
 };
 
+inline Logger& Logger::Suppressed(const uint64_t count)
+{
+	if (count != 0)
+	{
+		*this << "[suppressed " << count << "] ";
+	}
+	return *this;
+}
+
+inline void LogBuffer::Append(const char* const data, const size_t size)
+{
+	// An empty string_view may have a null data(), and an unused buffer has no storage.
+	if (size == 0)
+	{
+		return;
+	}
+	if (size_ + size > capacity_)
+	{
+		Grow(size_ + size);
+	}
+	std::memcpy(data_.get() + size_, data, size);
+	size_ += size;
+}
+
+inline void LogBuffer::Append(const char c)
+{
+	if (size_ == capacity_)
+	{
+		Grow(size_ + 1);
+	}
+	data_[size_++] = c;
+}
+
+inline const char* LogBuffer::Data() const
+{
+	return data_.get();
+}
+
+inline char* LogBuffer::Data()
+{
+	return data_.get();
+}
+
+inline size_t LogBuffer::Size() const
+{
+	return size_;
+}
+
+inline void LogBuffer::Truncate(const size_t size)
+{
+	size_ = size;
+}
+
+inline std::ostream& LogBuffer::Stream()
+{
+	return stream_;
+}
+
+inline bool LogBuffer::HasDefaultFormat() const
+{
+	return stream_.flags() == (std::ios_base::dec | std::ios_base::skipws) &&
+		stream_.width() == 0 &&
+		stream_.precision() == 6;
+}
+
 template <typename T>
 Logger& Logger::operator<<(const T& value)
 {
-	ss_ << value;
+	LogValue<T>::Append(buffer_, value);
 	return *this;
 }
 
-LogType GetLogType();
+inline Logger& Logger::operator<<(const char* const value)
+{
+	const auto text = ToLogString(value);
+	buffer_.Append(text.data(), text.size());
+	return *this;
+}
+
+inline Logger& Logger::operator<<(const std::string& value)
+{
+	buffer_.Append(value.data(), value.size());
+	return *this;
+}
+
+template <typename T>
+Logger& Logger::kv(const LogKey key, const T& value)
+{
+	if (fields_end_ != buffer_.Size())
+	{
+		MoveFieldsToEnd();
+	}
+	AppendLogfmtField(buffer_, key, value);
+	fields_end_ = buffer_.Size();
+	return *this;
+}
+
+// The config bits deciding a LOG_* or DEBUG_LOG_* statement of message_type (see
+// GetLogDisposition).
+inline uint32_t GetLogTypeFilter(const LogMessageType message_type)
+{
+	return detail::log_config.word.load(std::memory_order_relaxed) &
+		(static_cast<uint32_t>(message_type) | LogConfig::kVModule);
+}
+
+inline uint32_t GetDebugLogTypeFilter(const LogMessageType message_type)
+{
+	return detail::log_config.word.load(std::memory_order_relaxed) &
+		((static_cast<uint32_t>(message_type) << LogConfig::kDebugTypesShift) | LogConfig::kDebugVModule);
+}
+
+inline LogType GetLogType()
+{
+	return (detail::log_config.word.load(std::memory_order_relaxed) & LogConfig::kDebug) != 0 ? LogType::Debug : LogType::Release;
+}
 void SetLogType(const LogType log_type);
 
-uint32_t GetLogMessageTypes();
+inline uint32_t GetLogMessageTypes()
+{
+	return detail::log_config.word.load(std::memory_order_relaxed) & LogConfig::kMessageTypes;
+}
 void SetLogMessageTypes(const uint32_t log_message_types);
 
 uint32_t GetLogInfos();
 void SetLogInfos(const uint32_t log_infos);
 
+TimeStampFormat GetTimeStampFormat();
+void SetTimeStampFormat(const TimeStampFormat format);
+
+TimeStampPrecision GetTimeStampPrecision();
+void SetTimeStampPrecision(const TimeStampPrecision precision);
+
+// Streams of the two default sinks of the registry (see LogSink.h): GetLogStream()
+// receives Info and Warning records, GetELogStream() Error and FatalError ones. The
+// setters return once no thread writes to the previous stream anymore.
 std::ostream& GetLogStream();
 void SetLogStream(std::ostream& stream);
 
 std::ostream& GetELogStream();
 void SetELogStream(std::ostream& stream);
 
+// Small dense number of the calling thread (1, 2, ...), assigned when it first logs.
+// LogInfos::ThreadId prints it as "[3]", or "[3:name]" once the thread is named.
+uint32_t GetThreadNumber();
+// Names longer than 47 characters are cut.
+void SetThreadName(const std::string_view name);
+std::string GetThreadName();
+
+// Asynchronous mode: finished records are queued into a bounded lock-free ring and
+// written to their streams by a dedicated backend thread. When the ring is full a
+// producer follows the overflow policy of its record's type. Streams passed to
+// SetLogStream/SetELogStream must stay alive until FlushAsyncLogging() or
+// StopAsyncLogging() returns.
+void StartAsyncLogging(const size_t queue_size = 8192);
+// Drains every queued record, flushes the streams and joins the backend thread.
+// Called automatically at static destruction.
+void StopAsyncLogging();
+// Blocks until every record queued before the call has been written and flushed.
+void FlushAsyncLogging();
+bool IsAsyncLogging();
+
+// What a record does when the asynchronous queue, or the ring of deferred records of
+// its thread, is full.
+enum class LogOverflowPolicy : uint8_t
+{
+	// Wait for space. Past the block timeout the calling thread writes the record
+	// itself, so it is never lost.
+	Block,
+	// Discard the record.
+	DropNewest,
+	// Discard the oldest queued record to make room.
+	DropOldest,
+	// Park the record on the heap, without bound; the backend writes it after the
+	// records already in the queue.
+	OverflowToHeap,
+};
+
+// Per message type; Block without timeout by default. FatalError records never wait in
+// the queue: the caller flushes it and writes the record itself, whatever the policy.
+// Dropped records are counted in LoggerStats, and the backend reports them with a
+// warning "N messages dropped (...)" at most once a second and when it stops.
+void SetLogOverflowPolicy(
+	const LogMessageType message_type,
+	const LogOverflowPolicy policy,
+	const std::chrono::nanoseconds block_timeout = std::chrono::nanoseconds::max());
+LogOverflowPolicy GetLogOverflowPolicy(const LogMessageType message_type);
+
+// Throw the exception of a failed CHECK_THROW / CHECK_CUSTOM_THROW. The message and the
+// exception are built at the check, so __func__ and the caller's names keep their
+// meaning there; only the throw is out of line.
+[[noreturn]] SIMPLE_LOG_COLD void ThrowRuntimeError(const char* message);
+[[noreturn]] SIMPLE_LOG_COLD void ThrowRuntimeError(const std::string& message);
+
+template <typename Exception>
+[[noreturn]] SIMPLE_LOG_COLD void ThrowException(const Exception& exc)
+{
+	throw exc;
+}
+
 } //namespace SimpleLog
 
-#define LOG_MESSAGE_PRIVATE(ss, m) \
-	if ((static_cast<uint32_t>(m) & SimpleLog::GetLogMessageTypes()) != 0) SimpleLog::Logger(ss, m, __FILE__, __LINE__)
+#define PRIVATE_STRINGIZE_IMPL(value) #value
+#define PRIVATE_STRINGIZE(value) PRIVATE_STRINGIZE_IMPL(value)
+
+#define PRIVATE_CALL_SITE(name, m) \
+	static SimpleLog::CallSite name(__FILE__ ":" PRIVATE_STRINGIZE(__LINE__) "]", sizeof(__FILE__) - 1, __LINE__, m)
+
+#define PRIVATE_LOG_TYPE_FILTER(m) \
+	SimpleLog::GetLogTypeFilter(m)
+#define PRIVATE_DEBUG_LOG_TYPE_FILTER(m) \
+	SimpleLog::GetDebugLogTypeFilter(m)
+
+#define PRIVATE_LOG_MESSAGE(m, type_filter) \
+	if constexpr (SimpleLog::GetLogLevel(m) >= SIMPLE_LOG_MIN_LEVEL) \
+		if (PRIVATE_CALL_SITE(private_site, m); true) \
+			if (const auto private_disposition = SimpleLog::GetLogDisposition(private_site, type_filter); \
+				private_disposition != SimpleLog::LogDisposition::Skip) \
+				SimpleLog::Logger(private_site, private_disposition)
+
+#define LOG_MESSAGE_PRIVATE(m) \
+	PRIVATE_LOG_MESSAGE(m, PRIVATE_LOG_TYPE_FILTER(m))
 
 #define LOG_FATAL_ERROR \
-	LOG_MESSAGE_PRIVATE(SimpleLog::GetELogStream(), SimpleLog::LogMessageType::FatalError)
+	LOG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::FatalError)
 #define LOG_ERROR \
-	LOG_MESSAGE_PRIVATE(SimpleLog::GetELogStream(), SimpleLog::LogMessageType::Error)
+	LOG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Error)
 #define LOG_WARNING \
-	LOG_MESSAGE_PRIVATE(SimpleLog::GetLogStream(), SimpleLog::LogMessageType::Warning)
+	LOG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Warning)
 #define LOG_INFO \
-	LOG_MESSAGE_PRIVATE(SimpleLog::GetLogStream(), SimpleLog::LogMessageType::Info)
+	LOG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Info)
 
-#define LOG_DEBUG_MESSAGE_PRIVATE(ss, m) \
-	if (SimpleLog::LogType::Debug == SimpleLog::GetLogType()) LOG_MESSAGE_PRIVATE(ss, m)
+#define LOG_DEBUG_MESSAGE_PRIVATE(m) \
+	if constexpr (SIMPLE_LOG_STRIP_DEBUG == 0) \
+		PRIVATE_LOG_MESSAGE(m, PRIVATE_DEBUG_LOG_TYPE_FILTER(m))
 
 #define DEBUG_LOG_ERROR \
-	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::GetELogStream(), SimpleLog::LogMessageType::Error)
+	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Error)
 #define DEBUG_LOG_WARNING \
-	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::GetLogStream(), SimpleLog::LogMessageType::Warning)
+	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Warning)
 #define DEBUG_LOG_INFO \
-	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::GetLogStream(), SimpleLog::LogMessageType::Info)
+	LOG_DEBUG_MESSAGE_PRIVATE(SimpleLog::LogMessageType::Info)
+
+// Rate-limited and sampled statements: suppressed calls skip message formatting and
+// the next emitted line starts with "[suppressed N] ".
+//   *_EVERY_N(n)    - every n-th call of the site;
+//   *_FIRST_N(n)    - only the first n calls;
+//   *_EVERY_T(sec)  - at most once per sec seconds;
+//   *_SAMPLED(p)    - each call with probability p.
+#define PRIVATE_LOG_LIMITED(m, type_filter, limiter, argument) \
+	if constexpr (SimpleLog::GetLogLevel(m) >= SIMPLE_LOG_MIN_LEVEL) \
+		if (static SimpleLog::RateLimitedCallSite<limiter> private_site( \
+				__FILE__ ":" PRIVATE_STRINGIZE(__LINE__) "]", sizeof(__FILE__) - 1, __LINE__, m); \
+			SimpleLog::GetLogDisposition(private_site, type_filter) == SimpleLog::LogDisposition::Emit) \
+			if (const auto private_suppressed = private_site.Check(argument); \
+				private_suppressed != SimpleLog::kRateLimited) \
+				SimpleLog::Logger(private_site).Suppressed(private_suppressed)
+
+#define LOG_LIMITED_PRIVATE(m, limiter, argument) \
+	PRIVATE_LOG_LIMITED(m, PRIVATE_LOG_TYPE_FILTER(m), limiter, argument)
+
+#define LOG_DEBUG_LIMITED_PRIVATE(m, limiter, argument) \
+	if constexpr (SIMPLE_LOG_STRIP_DEBUG == 0) \
+		PRIVATE_LOG_LIMITED(m, PRIVATE_DEBUG_LOG_TYPE_FILTER(m), limiter, argument)
+
+#define LOG_ERROR_EVERY_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::EveryNLimiter, n)
+#define LOG_WARNING_EVERY_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::EveryNLimiter, n)
+#define LOG_INFO_EVERY_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::EveryNLimiter, n)
+#define DEBUG_LOG_ERROR_EVERY_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::EveryNLimiter, n)
+#define DEBUG_LOG_WARNING_EVERY_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::EveryNLimiter, n)
+#define DEBUG_LOG_INFO_EVERY_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::EveryNLimiter, n)
+
+#define LOG_ERROR_FIRST_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::FirstNLimiter, n)
+#define LOG_WARNING_FIRST_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::FirstNLimiter, n)
+#define LOG_INFO_FIRST_N(n) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::FirstNLimiter, n)
+#define DEBUG_LOG_ERROR_FIRST_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::FirstNLimiter, n)
+#define DEBUG_LOG_WARNING_FIRST_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::FirstNLimiter, n)
+#define DEBUG_LOG_INFO_FIRST_N(n) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::FirstNLimiter, n)
+
+#define LOG_ERROR_EVERY_T(seconds) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::EveryTLimiter, seconds)
+#define LOG_WARNING_EVERY_T(seconds) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::EveryTLimiter, seconds)
+#define LOG_INFO_EVERY_T(seconds) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::EveryTLimiter, seconds)
+#define DEBUG_LOG_ERROR_EVERY_T(seconds) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::EveryTLimiter, seconds)
+#define DEBUG_LOG_WARNING_EVERY_T(seconds) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::EveryTLimiter, seconds)
+#define DEBUG_LOG_INFO_EVERY_T(seconds) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::EveryTLimiter, seconds)
+
+#define LOG_ERROR_SAMPLED(probability) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::SampledLimiter, probability)
+#define LOG_WARNING_SAMPLED(probability) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::SampledLimiter, probability)
+#define LOG_INFO_SAMPLED(probability) \
+	LOG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::SampledLimiter, probability)
+#define DEBUG_LOG_ERROR_SAMPLED(probability) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Error, SimpleLog::SampledLimiter, probability)
+#define DEBUG_LOG_WARNING_SAMPLED(probability) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Warning, SimpleLog::SampledLimiter, probability)
+#define DEBUG_LOG_INFO_SAMPLED(probability) \
+	LOG_DEBUG_LIMITED_PRIVATE(SimpleLog::LogMessageType::Info, SimpleLog::SampledLimiter, probability)
 
 #define PRIVATE_EMPTY_BLOCK do {} while(false)
 #define PRIVATE_IF_CONDITION(condition) if (!(condition))
@@ -103,10 +1145,14 @@ void SetELogStream(std::ostream& stream);
 #define CHECK_BREAK(condition) \
 	PRIVATE_IF_CONDITION(condition) break
 #define CHECK_THROW(condition, message) \
-	PRIVATE_IF_CONDITION(condition) throw std::runtime_error(message)
+	PRIVATE_IF_CONDITION(condition) SimpleLog::ThrowRuntimeError(message)
 #define CHECK_CUSTOM_THROW(condition, exc) \
-	PRIVATE_IF_CONDITION(condition) throw exc
+	PRIVATE_IF_CONDITION(condition) SimpleLog::ThrowException(exc)
 
+// The message of a failed CHECK_* macro is written in the caller's scope. The statement
+// enters the cold Logger constructor, so its formatting and destructor move to the
+// function's .text.unlikely part; below SIMPLE_LOG_MIN_LEVEL nothing is left but the
+// action.
 #define PRIVATE_CHECK(condition, out_stream, message, action) \
 	PRIVATE_IF_CONDITION(condition) { out_stream << message; action; } PRIVATE_EMPTY_BLOCK
 
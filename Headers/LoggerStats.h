@@ -0,0 +1,84 @@
+#pragma once
+#include "LogSink.h"
+#include "Logger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SimpleLog
+{
+
+// Runtime metrics of the library. Every thread counts into its own cache-line padded
+// block with plain relaxed stores; GetLoggerStats() sums the blocks of live threads
+// and the totals left by exited ones, so a snapshot taken while threads log is only
+// approximately consistent across counters.
+
+struct LogMessageTypeStats
+{
+	// Records handed to the sinks (or to an explicit stream).
+	uint64_t emitted = 0;
+	// Statements filtered out by type, LogType, SetCallSiteEnabled or a rate limiter;
+	// only counted while SetSuppressedCountingEnabled(true).
+	uint64_t suppressed = 0;
+	// Records discarded by a DropNewest or DropOldest overflow policy.
+	uint64_t dropped = 0;
+};
+
+struct LogSinkStats
+{
+	std::shared_ptr<LogSink> sink;
+	uint64_t records = 0;
+	uint64_t bytes = 0;
+	// Time spent in LogSink::Write; only counted while timing is enabled.
+	uint64_t write_ns = 0;
+};
+
+struct LogQueueStats
+{
+	// Records waiting for the asynchronous backend, and the queue size; both 0 while
+	// asynchronous logging is stopped.
+	size_t depth = 0;
+	size_t capacity = 0;
+	// Records parked on the heap by the OverflowToHeap policy.
+	size_t overflow = 0;
+	// Times a producer found the queue full.
+	uint64_t full_waits = 0;
+};
+
+struct LoggerStats
+{
+	// Indexed by GetLogMessageTypeIndex().
+	LogMessageTypeStats message_types[4];
+	// Text bytes of the emitted records, prefix and newline included.
+	uint64_t bytes = 0;
+	// Time spent rendering prefixes (PrintInfos) and formatting messages; only
+	// counted while timing is enabled.
+	uint64_t infos_ns = 0;
+	uint64_t format_ns = 0;
+	LogQueueStats queue;
+	// The registered sinks with their counters since construction.
+	std::vector<LogSinkStats> sinks;
+
+	const LogMessageTypeStats& Get(const LogMessageType message_type) const
+	{
+		return message_types[GetLogMessageTypeIndex(message_type)];
+	}
+};
+
+LoggerStats GetLoggerStats();
+// Zeroes the message, byte and time counters; sink counters are kept.
+void ResetLoggerStats();
+
+// Timing reads the clock a few more times per record; off by default.
+bool IsLoggerTimingEnabled();
+void SetLoggerTimingEnabled(const bool enabled);
+
+// Counting suppressed statements adds a per-thread increment to every filtered-out
+// statement (about 1.3 ns); off by default, when a filtered-out LOG_* only loads and
+// tests the config word, and the suppressed counters stay 0.
+bool IsSuppressedCountingEnabled();
+void SetSuppressedCountingEnabled(const bool enabled);
+
+} // namespace SimpleLog
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace SimpleLog
+{
+
+// Log sink that appends records straight into a memory-mapped file. A record write
+// claims its range with one fetch_add on the shared cursor and copies the bytes into
+// the mapping; the file is extended and mapped in chunks of chunk_size bytes. Data
+// reaches the page cache as soon as it is copied, so it survives a crash of the
+// process; a clean close trims the unused pre-sized tail.
+//
+// Usable with SetLogStream/SetELogStream. Each write() is one record: writes from
+// several threads never interleave.
+class MappedFileStream : public std::ostream
+{
+public:
+	static constexpr size_t kDefaultChunkSize = 16 << 20;
+
+	// Appends to path after dropping an incomplete tail left by a crash. On failure
+	// the stream is created in the bad state.
+	explicit MappedFileStream(const std::string& path, const size_t chunk_size = kDefaultChunkSize);
+	~MappedFileStream() override;
+
+	MappedFileStream(const MappedFileStream&) = delete;
+	MappedFileStream& operator=(const MappedFileStream&) = delete;
+
+	bool IsOpen() const;
+	// Bytes of records written so far, including the ones found in the file on open.
+	size_t Size() const;
+	// Waits for the writes in progress, then unmaps the file and truncates it to the
+	// written size. Later writes fail.
+	void Close();
+
+private:
+	class Buffer : public std::streambuf
+	{
+	public:
+		Buffer(const std::string& path, const size_t chunk_size);
+		~Buffer() override;
+
+		bool IsOpen() const;
+		size_t Size() const;
+		void Close();
+
+	protected:
+		std::streamsize xsputn(const char* data, std::streamsize size) override;
+		int_type overflow(int_type ch) override;
+		int sync() override;
+
+	private:
+		// Counts the caller as a writer unless the buffer is closed.
+		bool EnterWriter();
+		void LeaveWriter();
+		char* GetChunk(const size_t index);
+		char* MapChunk(const size_t index);
+
+		int fd_ = -1;
+		std::atomic<bool> closed_{false};
+		// Writers between EnterWriter and LeaveWriter; Close unmaps once they left.
+		std::atomic<uint32_t> writers_{0};
+		const size_t chunk_size_;
+		std::unique_ptr<std::atomic<char*>[]> chunks_;
+		std::atomic<size_t> cursor_{0};
+		std::mutex map_mutex_;
+	};
+
+	Buffer buffer_;
+};
+
+// Offset just past the last complete record ('\n'-terminated line) in data.
+size_t FindMappedLogEnd(const char* data, const size_t size);
+
+// Reads a file written by MappedFileStream, possibly after a crash, and appends its
+// complete records to out. Records that were being copied when the process died
+// (torn or never-written ranges, seen as NUL bytes) are skipped. Returns the number
+// of recovered records, or 0 when the file cannot be read.
+size_t RecoverMappedLog(const std::string& path, std::string& out);
+
+} // namespace SimpleLog
@@ -0,0 +1,110 @@
+#pragma once
+#include "LogSink.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SimpleLog
+{
+
+// Host-level logging for many processes. Every process writes its records into its own
+// POSIX shared memory ring, "<prefix>.<pid>"; a collector (simplelog-collector) maps
+// the rings of all processes, drains them and writes one merged file. The rings
+// outlive their process: records of a process that crashed stay in shared memory
+// until the collector has written them, then the collector unlinks the ring. Rings
+// are found by listing /dev/shm, so the collector is Linux-only, and are only
+// accessible to their owner.
+
+struct SharedRingHeader;
+
+// Writes rendered records (formatted by the sink's formatter, if any) into the ring of
+// the calling process. Threads reserve space with a compare-and-swap on the shared
+// head and copy their record in: no lock and no system call. A record that does not
+// fit, because the collector is behind or absent or the record is larger than half
+// the ring, is dropped and counted.
+class SharedMemorySink : public LogSink
+{
+public:
+	static constexpr size_t kDefaultCapacity = 4 << 20;
+
+	// capacity is rounded up to a power of two. On failure the sink is created closed
+	// and drops every record.
+	explicit SharedMemorySink(
+		const std::string& prefix = "/simplelog",
+		const size_t capacity = kDefaultCapacity,
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr);
+	// Unmaps the ring and marks it closed; the collector unlinks it once drained.
+	~SharedMemorySink() override;
+
+	bool IsOpen() const;
+	// "<prefix>.<pid>"
+	const std::string& GetName() const;
+	uint64_t GetDroppedRecords() const;
+
+	void Write(const LogRecord& record, std::string_view text) override;
+
+private:
+	std::string name_;
+	SharedRingHeader* header_ = nullptr;
+	char* data_ = nullptr;
+	size_t mapped_size_ = 0;
+};
+
+struct SharedLogRecord
+{
+	int64_t timestamp_ns;
+	int32_t pid;
+	// The rendered record, newline included.
+	std::string_view text;
+};
+
+struct SharedLogCollectorStats
+{
+	// Rings currently mapped.
+	size_t rings = 0;
+	// Records the producers of the rings seen so far dropped.
+	uint64_t dropped = 0;
+	// Records lost in the rings of crashed processes: written only in part.
+	uint64_t lost = 0;
+};
+
+// Reader side of SharedMemorySink rings. Not thread-safe.
+class SharedLogCollector
+{
+public:
+	explicit SharedLogCollector(const std::string& prefix = "/simplelog");
+	~SharedLogCollector();
+
+	SharedLogCollector(const SharedLogCollector&) = delete;
+	SharedLogCollector& operator=(const SharedLogCollector&) = delete;
+
+	// Maps the rings created since the last call and calls visit with every record
+	// they committed, in ring order per process; the text is only valid during the
+	// call. Rings of processes that closed their sink or exited are unlinked once
+	// drained. Returns the number of records.
+	size_t Poll(const std::function<void(const SharedLogRecord&)>& visit);
+
+	SharedLogCollectorStats GetStats() const;
+
+private:
+	struct Ring;
+
+	void MapNewRings();
+	// With exited set, steps over records their crashed writer never committed.
+	size_t Drain(Ring& ring, const bool exited, const std::function<void(const SharedLogRecord&)>& visit);
+
+	const std::string prefix_;
+	std::vector<std::unique_ptr<Ring>> rings_;
+	// Counts of the rings already unlinked, and records lost.
+	uint64_t dropped_ = 0;
+	uint64_t lost_ = 0;
+};
+
+} // namespace SimpleLog
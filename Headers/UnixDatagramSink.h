@@ -0,0 +1,111 @@
+#pragma once
+#include "LogSink.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SimpleLog
+{
+
+struct UnixDatagramOptions
+{
+	// Largest datagram sent; 0 takes a quarter of the socket's send buffer, at most
+	// 64 KiB. Longer records are cut to it.
+	size_t max_datagram_size = 0;
+	// Full datagrams waiting before a sendmmsg is issued without waiting for Flush().
+	size_t batch_datagrams = 32;
+	// Without asynchronous logging: records queued before the writing thread sends
+	// them, or fewer once the first of them waited sync_batch_interval. With no backend
+	// thread, the last records of a burst then wait for the next record or Flush().
+	size_t sync_batch_records = 1;
+	std::chrono::microseconds sync_batch_interval = std::chrono::milliseconds(1);
+	// Bytes kept while the receiver is not reading (EAGAIN); past them the record's
+	// LogOverflowPolicy applies.
+	size_t max_pending_bytes = 1 << 20;
+	// Longest wait of a Block record for the receiver.
+	std::chrono::milliseconds max_block_time = std::chrono::milliseconds(50);
+};
+
+// Sends records to a local agent listening on a Unix datagram socket at path. Records
+// (formatted by the sink's formatter, if any, newline included) are packed into
+// datagrams, which are sent in bursts by one sendmmsg: when batch_datagrams are full
+// and on Flush(), which the asynchronous backend calls whenever its queue runs empty.
+// Without asynchronous logging the thread writing a record sends the queue every
+// sync_batch_records records (see UnixDatagramOptions).
+//
+// A receiver that does not keep up makes the socket return EAGAIN: datagrams stay
+// queued in the sink up to max_pending_bytes. Past that, Block waits for the receiver,
+// without holding the sink, until the record's block timeout or max_block_time,
+// whichever comes first, and then discards the record; DropNewest discards the
+// record; DropOldest discards the oldest queued datagram; OverflowToHeap queues
+// without bound. Discarded records count as dropped in LoggerStats. Datagrams the
+// agent cannot take, because it is not running or the datagram is too large, are
+// discarded the same way; the socket reconnects when the agent comes back.
+class UnixDatagramSink : public LogSink
+{
+public:
+	explicit UnixDatagramSink(
+		const std::string& path,
+		const uint32_t message_types = kAllLogMessageTypes,
+		std::shared_ptr<const LogFormatter> formatter = nullptr,
+		const UnixDatagramOptions& options = UnixDatagramOptions());
+	~UnixDatagramSink() override;
+
+	// False when no socket could be created.
+	bool IsOpen() const;
+	size_t GetMaxDatagramSize() const;
+	uint64_t GetSentDatagrams() const;
+	uint64_t GetSendCalls() const;
+	uint64_t GetDroppedRecords() const;
+
+	void Write(const LogRecord& record, std::string_view text) override;
+	// Sends every queued datagram the receiver accepts without waiting.
+	void Flush() override;
+
+private:
+	struct Datagram
+	{
+		std::string data;
+		// Records per GetLogMessageTypeIndex(), to count them when discarded.
+		uint32_t records[4] = {};
+	};
+
+	// Sends queued datagrams, the last one too with all set, until the socket would
+	// block; returns false if it did.
+	bool Send(const bool all);
+	bool Connect();
+	// Counts the records of datagram as dropped.
+	void Discard(const Datagram& datagram);
+	void DropFront();
+	// Applies the policy of message_type to a record that finds the queue full;
+	// returns false when the record is discarded. A blocking record releases lock
+	// while it waits.
+	bool MakeRoom(std::unique_lock<std::mutex>& lock, const LogMessageType message_type, const size_t size);
+
+	const std::string path_;
+	const UnixDatagramOptions options_;
+	int fd_ = -1;
+	bool connected_ = false;
+	size_t max_datagram_size_ = 0;
+
+	mutable std::mutex mutex_;
+	std::deque<Datagram> pending_;
+	size_t pending_bytes_ = 0;
+	// Records queued since the last send of a thread without asynchronous logging,
+	// and when the first of them was.
+	size_t unsent_records_ = 0;
+	std::chrono::steady_clock::time_point first_unsent_;
+	// Strings of sent datagrams, reused by the next ones.
+	std::vector<std::string> spare_;
+	uint64_t sent_datagrams_ = 0;
+	uint64_t send_calls_ = 0;
+	uint64_t dropped_records_ = 0;
+};
+
+} // namespace SimpleLog
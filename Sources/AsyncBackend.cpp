@@ -0,0 +1,626 @@
+#include "AsyncBackend.h"
+#include "LoggerPrivate.h"
+#include "MpscRing.h"
+#include "../Headers/Logger.h"
+#include "../Headers/LoggerStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+// A LogRecord with its text, thread tag, file name, context and fields copied into one
+// string.
+struct AsyncRecord
+{
+	void Assign(std::ostream* const target, const LogRecord& record)
+	{
+		stream = target;
+		message_type = record.message_type;
+		timestamp_ns = record.timestamp_ns;
+		line = record.line;
+		text_size = record.text.size();
+		message_offset = static_cast<size_t>(record.message.data() - record.text.data());
+		message_size = record.message.size();
+		tag_size = record.thread_tag.size();
+		data.assign(record.text.data(), record.text.size());
+		data.append(record.thread_tag.data(), record.thread_tag.size());
+		data.append(record.file_name.data(), record.file_name.size());
+		data.append(record.context.data(), record.context.size());
+
+		data.append(record.fields.data(), record.fields.size());
+
+		file_name_size = record.file_name.size();
+		context_size = record.context.size();
+		fields_size = record.fields.size();
+	}
+
+	LogRecord View() const
+	{
+		const std::string_view all(data);
+		return LogRecord{
+			message_type,
+			timestamp_ns,
+			all.substr(text_size, tag_size),
+			all.substr(text_size + tag_size, file_name_size),
+			line,
+			all.substr(message_offset, message_size),
+			all.substr(0, text_size),
+			all.substr(text_size + tag_size + file_name_size + context_size, fields_size),
+			all.substr(text_size + tag_size + file_name_size, context_size)};
+	}
+
+	std::ostream* stream = nullptr;
+	LogMessageType message_type = LogMessageType::Info;
+	int64_t timestamp_ns = 0;
+	int line = 0;
+	size_t text_size = 0;
+	size_t message_offset = 0;
+	size_t message_size = 0;
+	size_t tag_size = 0;
+	size_t file_name_size = 0;
+	size_t context_size = 0;
+	size_t fields_size = 0;
+	std::string data;
+};
+
+constexpr auto kIdleWait = std::chrono::milliseconds(1);
+constexpr auto kDropReportInterval = std::chrono::seconds(1);
+constexpr auto kNoTimeout = std::chrono::nanoseconds::max().count();
+constexpr int64_t kNanosecondsPerSecond = 1000000000;
+constexpr long kSignalFlushPollNs = 1000000;
+
+std::atomic<LogOverflowPolicy> overflow_policies_[4] = {
+	LogOverflowPolicy::Block, LogOverflowPolicy::Block, LogOverflowPolicy::Block, LogOverflowPolicy::Block};
+std::atomic<int64_t> block_timeouts_ns_[4] = {kNoTimeout, kNoTimeout, kNoTimeout, kNoTimeout};
+
+// Set on the backend thread, which writes its own records (the drop reports, or
+// whatever a sink logs) synchronously instead of waiting on its own queue.
+thread_local bool on_backend_thread_ = false;
+
+class AsyncBackend
+{
+public:
+	~AsyncBackend()
+	{
+		Stop();
+	}
+
+	void Start(const size_t queue_size)
+	{
+		std::lock_guard<std::mutex> control_lock(control_mutex_);
+		if (thread_.joinable())
+		{
+			return;
+		}
+
+		ring_ = std::make_unique<MpscRing<AsyncRecord>>(queue_size);
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex_);
+			stop_requested_ = false;
+		}
+		thread_ = std::thread([this]() { Run(); });
+		accepting_.store(true);
+	}
+
+	void Stop()
+	{
+		std::lock_guard<std::mutex> control_lock(control_mutex_);
+		if (!thread_.joinable())
+		{
+			return;
+		}
+
+		accepting_.store(false);
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex_);
+			stop_requested_ = true;
+		}
+		wake_cv_.notify_one();
+		thread_.join();
+		ring_.reset();
+
+		// Deferred records committed while the backend was exiting. A producer that
+		// commits after this drain sees accepting_ cleared and writes its record itself:
+		// the store of accepting_ above, the drain's loads of the published heads and
+		// the producer's store and load are all sequentially consistent.
+		sinks_dirty_ |= DrainDeferredRecords(format_buffer_) != 0;
+		FlushStreams();
+	}
+
+	void Flush()
+	{
+		if (on_backend_thread_)
+		{
+			return;
+		}
+		// Registered like a producer: the backend does not exit while a flush it has to
+		// complete is pending.
+		producers_.fetch_add(1);
+		if (!accepting_.load())
+		{
+			producers_.fetch_sub(1);
+			return;
+		}
+
+		const auto target = pushed_.load();
+		{
+			std::unique_lock<std::mutex> lock(wake_mutex_);
+			const auto generation = ++flush_generation_;
+			++flush_waiters_;
+			wake_cv_.notify_one();
+			flushed_cv_.wait(lock, [this, target, generation]()
+			{
+				return flushed_.load() >= target && completed_generation_ >= generation;
+			});
+			--flush_waiters_;
+		}
+		producers_.fetch_sub(1);
+	}
+
+	bool FlushFromSignal(const int64_t timeout_ns)
+	{
+		if (!accepting_.load() || on_backend_thread_)
+		{
+			return false;
+		}
+
+		// The pass running now may have drained before the records of the caller: the
+		// one after it has not.
+		const auto passes = flush_passes_.load();
+		const auto target = pushed_.load();
+		signal_flush_waiters_.fetch_add(1);
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		const auto deadline_ns = now.tv_sec * kNanosecondsPerSecond + now.tv_nsec + timeout_ns;
+		auto flushed = false;
+		for (;;)
+		{
+			if (flushed_.load() >= target && flush_passes_.load() >= passes + 2)
+			{
+				flushed = true;
+				break;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (now.tv_sec * kNanosecondsPerSecond + now.tv_nsec >= deadline_ns)
+			{
+				break;
+			}
+			// The backend wakes up every kIdleWait by itself.
+			const timespec pause = {0, kSignalFlushPollNs};
+			nanosleep(&pause, nullptr);
+		}
+		signal_flush_waiters_.fetch_sub(1);
+		return flushed;
+	}
+
+	bool IsRunning() const
+	{
+		return accepting_.load();
+	}
+
+	LogQueueStats GetStats()
+	{
+		LogQueueStats stats;
+		stats.full_waits = full_waits_.load(std::memory_order_relaxed);
+		std::lock_guard<std::mutex> control_lock(control_mutex_);
+		if (ring_ != nullptr)
+		{
+			stats.depth = ring_->ApproximateSize();
+			stats.capacity = ring_->Capacity();
+		}
+		stats.overflow = overflow_size_.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	bool Push(std::ostream* const stream, const LogRecord& record)
+	{
+		if (on_backend_thread_)
+		{
+			return false;
+		}
+		producers_.fetch_add(1);
+		if (!accepting_.load())
+		{
+			producers_.fetch_sub(1);
+			return false;
+		}
+
+		const auto queued = Enqueue(stream, record);
+		producers_.fetch_sub(1);
+		return queued;
+	}
+
+	void CountDrop(const LogMessageType message_type)
+	{
+		dropped_[GetLogMessageTypeIndex(message_type)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	bool Enqueue(std::ostream* const stream, const LogRecord& record)
+	{
+		const auto fill = [stream, &record](AsyncRecord& slot)
+		{
+			slot.Assign(stream, record);
+		};
+		const auto policy = GetLogOverflowPolicy(record.message_type);
+		// Once records spill to the heap, later ones follow them there to keep their order.
+		if (policy == LogOverflowPolicy::OverflowToHeap && overflow_size_.load(std::memory_order_relaxed) != 0)
+		{
+			PushOverflow(stream, record);
+			return true;
+		}
+		if (ring_->TryPush(fill))
+		{
+			pushed_.fetch_add(1);
+			return true;
+		}
+
+		// The backend fell behind.
+		full_waits_.fetch_add(1, std::memory_order_relaxed);
+		wake_cv_.notify_one();
+		switch (policy)
+		{
+		case LogOverflowPolicy::DropNewest:
+			ReportDroppedRecord(record.message_type);
+			return true;
+		case LogOverflowPolicy::OverflowToHeap:
+			PushOverflow(stream, record);
+			return true;
+		case LogOverflowPolicy::DropOldest:
+			while (!ring_->TryPush(fill))
+			{
+				DropOldest();
+			}
+			pushed_.fetch_add(1);
+			return true;
+		case LogOverflowPolicy::Block:
+			break;
+		}
+
+		const auto deadline = GetBlockDeadline(record.message_type);
+		do
+		{
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				return false;
+			}
+			wake_cv_.notify_one();
+			std::this_thread::yield();
+		}
+		while (!ring_->TryPush(fill));
+		pushed_.fetch_add(1);
+		return true;
+	}
+
+	void PushOverflow(std::ostream* const stream, const LogRecord& record)
+	{
+		{
+			std::lock_guard<std::mutex> lock(overflow_mutex_);
+			overflow_.emplace_back().Assign(stream, record);
+			overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+		}
+		pushed_.fetch_add(1);
+	}
+
+	// Pops the oldest record on behalf of the consumer; the backend holds the lock only
+	// while it swaps a record out of its slot.
+	void DropOldest()
+	{
+		std::lock_guard<std::mutex> lock(pop_mutex_);
+		auto message_type = LogMessageType::Info;
+		const auto discard = [&message_type](AsyncRecord& slot)
+		{
+			message_type = slot.message_type;
+		};
+		if (ring_->TryPop(discard))
+		{
+			discarded_.fetch_add(1);
+			ReportDroppedRecord(message_type);
+		}
+	}
+
+	void Run()
+	{
+		on_backend_thread_ = true;
+		last_drop_report_ = std::chrono::steady_clock::now();
+		for (;;)
+		{
+			uint64_t generation = 0;
+			{
+				std::lock_guard<std::mutex> lock(wake_mutex_);
+				generation = flush_generation_;
+			}
+			// Every deferred record committed before the generation was requested is
+			// written by this pass.
+			const auto drained = Drain();
+			if (std::chrono::steady_clock::now() - last_drop_report_ >= kDropReportInterval)
+			{
+				ReportDrops();
+			}
+
+			std::unique_lock<std::mutex> lock(wake_mutex_);
+			if (drained == 0 || flush_waiters_ != 0 || signal_flush_waiters_.load() != 0)
+			{
+				lock.unlock();
+				FlushStreams();
+				lock.lock();
+				completed_generation_ = generation;
+				flushed_cv_.notify_all();
+			}
+			if (drained != 0)
+			{
+				continue;
+			}
+			if (stop_requested_ && producers_.load() == 0)
+			{
+				lock.unlock();
+				if (Drain() != 0)
+				{
+					continue;
+				}
+				ReportDrops();
+				FlushStreams();
+				lock.lock();
+				completed_generation_ = flush_generation_;
+				flushed_cv_.notify_all();
+				return;
+			}
+			wake_cv_.wait_for(lock, kIdleWait);
+		}
+	}
+
+	void Write(AsyncRecord& record)
+	{
+		CountEmitted(record.message_type, record.text_size);
+		if (record.stream == nullptr)
+		{
+			DispatchLogRecord(record.View());
+			sinks_dirty_ = true;
+		}
+		else
+		{
+			record.stream->write(record.data.data(), static_cast<std::streamsize>(record.text_size));
+			if (std::find(dirty_streams_.cbegin(), dirty_streams_.cend(), record.stream) == dirty_streams_.cend())
+			{
+				dirty_streams_.push_back(record.stream);
+			}
+		}
+		record.data.clear();
+	}
+
+	size_t Drain()
+	{
+		size_t drained = 0;
+		// The record is swapped out of its slot, so the slot is free while the sinks
+		// write and a dropping producer never waits for them.
+		const auto take = [this](AsyncRecord& slot)
+		{
+			std::swap(slot, current_);
+		};
+		// Bounded batches keep Flush() callers from waiting behind a busy producer.
+		const auto batch = ring_->Capacity();
+		for (; drained < batch; ++drained)
+		{
+			{
+				std::lock_guard<std::mutex> pop_lock(pop_mutex_);
+				if (!ring_->TryPop(take))
+				{
+					break;
+				}
+			}
+			Write(current_);
+		}
+		// Records spill to the heap only once the ring is full: they are written when
+		// the ring has been emptied, or after a further batch, which cannot hold anything
+		// queued before them.
+		const auto overflow = overflow_size_.load(std::memory_order_relaxed) != 0;
+		const auto ring_emptied = drained < batch;
+		if (overflow && !ring_emptied && !overflow_pending_)
+		{
+			overflow_pending_ = true;
+		}
+		else if (overflow)
+		{
+			overflow_pending_ = false;
+			{
+				std::lock_guard<std::mutex> lock(overflow_mutex_);
+				overflow_batch_.swap(overflow_);
+				overflow_size_.store(0, std::memory_order_relaxed);
+			}
+			for (auto& record : overflow_batch_)
+			{
+				Write(record);
+			}
+			drained += overflow_batch_.size();
+			overflow_batch_.clear();
+		}
+		written_ += drained;
+		const auto deferred = DrainDeferredRecords(format_buffer_);
+		sinks_dirty_ |= deferred != 0;
+		return drained + deferred;
+	}
+
+	void FlushStreams()
+	{
+		for (auto* stream : dirty_streams_)
+		{
+			stream->flush();
+		}
+		dirty_streams_.clear();
+		if (sinks_dirty_)
+		{
+			FlushLogSinks();
+			sinks_dirty_ = false;
+		}
+		flushed_.store(written_ + discarded_.load());
+		flush_passes_.fetch_add(1);
+	}
+
+	// Written by the backend itself, so the report never waits on the queue.
+	void ReportDrops()
+	{
+		last_drop_report_ = std::chrono::steady_clock::now();
+		uint64_t dropped[4];
+		uint64_t total = 0;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			dropped[i] = dropped_[i].exchange(0, std::memory_order_relaxed);
+			total += dropped[i];
+		}
+		if (total == 0 || (GetLogMessageTypes() & static_cast<uint32_t>(LogMessageType::Warning)) == 0)
+		{
+			return;
+		}
+
+		sinks_dirty_ = true;
+		PRIVATE_CALL_SITE(site, LogMessageType::Warning);
+		Logger logger(site);
+		logger << total << " messages dropped (";
+		const char* separator = "";
+		const auto add = [&logger, &separator, &dropped](const LogMessageType message_type, const char* const name)
+		{
+			if (const auto count = dropped[GetLogMessageTypeIndex(message_type)]; count != 0)
+			{
+				logger << separator << name << ' ' << count;
+				separator = ", ";
+			}
+		};
+		add(LogMessageType::Info, "info");
+		add(LogMessageType::Warning, "warning");
+		add(LogMessageType::Error, "error");
+		add(LogMessageType::FatalError, "fatal");
+		logger << ')';
+	}
+
+	std::mutex control_mutex_;
+	std::thread thread_;
+	std::unique_ptr<MpscRing<AsyncRecord>> ring_;
+
+	std::atomic<bool> accepting_{false};
+	std::atomic<uint32_t> producers_{0};
+	std::atomic<uint64_t> pushed_{0};
+	std::atomic<uint64_t> flushed_{0};
+	// Flushes of the streams and sinks so far, and callers of FlushFromSignal waiting
+	// for the next ones.
+	std::atomic<uint64_t> flush_passes_{0};
+	std::atomic<uint32_t> signal_flush_waiters_{0};
+	std::atomic<uint64_t> full_waits_{0};
+	// Records a DropOldest producer popped: they count as written for Flush().
+	std::atomic<uint64_t> discarded_{0};
+	std::atomic<uint64_t> dropped_[4] = {};
+
+	// Serializes poppers: the backend, and producers dropping the oldest record.
+	std::mutex pop_mutex_;
+	std::mutex overflow_mutex_;
+	std::deque<AsyncRecord> overflow_;
+	std::atomic<size_t> overflow_size_{0};
+
+	// Owned by the backend thread.
+	uint64_t written_ = 0;
+	AsyncRecord current_;
+	bool overflow_pending_ = false;
+	std::deque<AsyncRecord> overflow_batch_;
+	std::chrono::steady_clock::time_point last_drop_report_;
+	std::vector<std::ostream*> dirty_streams_;
+	bool sinks_dirty_ = false;
+	LogBuffer format_buffer_;
+
+	std::mutex wake_mutex_;
+	std::condition_variable wake_cv_;
+	std::condition_variable flushed_cv_;
+	bool stop_requested_ = false;
+	uint32_t flush_waiters_ = 0;
+	uint64_t flush_generation_ = 0;
+	uint64_t completed_generation_ = 0;
+};
+
+AsyncBackend& GetAsyncBackend()
+{
+	static AsyncBackend backend;
+	return backend;
+}
+
+} // namespace
+
+bool PushAsyncRecord(std::ostream* const stream, const LogRecord& record)
+{
+	auto& backend = GetAsyncBackend();
+	return backend.IsRunning() && backend.Push(stream, record);
+}
+
+bool FlushAsyncLoggingFromSignal(const int64_t timeout_ns)
+{
+	return GetAsyncBackend().FlushFromSignal(timeout_ns);
+}
+
+LogQueueStats GetAsyncQueueStats()
+{
+	return GetAsyncBackend().GetStats();
+}
+
+std::chrono::steady_clock::time_point GetBlockDeadline(const LogMessageType message_type)
+{
+	const auto timeout_ns = block_timeouts_ns_[GetLogMessageTypeIndex(message_type)].load(std::memory_order_relaxed);
+	const auto now = std::chrono::steady_clock::now();
+	if (timeout_ns >= (std::chrono::steady_clock::time_point::max() - now).count())
+	{
+		return std::chrono::steady_clock::time_point::max();
+	}
+	return now + std::chrono::nanoseconds(timeout_ns);
+}
+
+void ReportDroppedRecord(const LogMessageType message_type)
+{
+	CountDropped(message_type);
+	GetAsyncBackend().CountDrop(message_type);
+}
+
+void SetLogOverflowPolicy(
+	const LogMessageType message_type,
+	const LogOverflowPolicy policy,
+	const std::chrono::nanoseconds block_timeout)
+{
+	const auto index = GetLogMessageTypeIndex(message_type);
+	block_timeouts_ns_[index].store(std::max<int64_t>(block_timeout.count(), 0), std::memory_order_relaxed);
+	overflow_policies_[index].store(policy, std::memory_order_relaxed);
+}
+
+LogOverflowPolicy GetLogOverflowPolicy(const LogMessageType message_type)
+{
+	return overflow_policies_[GetLogMessageTypeIndex(message_type)].load(std::memory_order_relaxed);
+}
+
+void StartAsyncLogging(const size_t queue_size)
+{
+	GetAsyncBackend().Start(queue_size);
+}
+
+void StopAsyncLogging()
+{
+	GetAsyncBackend().Stop();
+}
+
+void FlushAsyncLogging()
+{
+	GetAsyncBackend().Flush();
+}
+
+bool IsAsyncLogging()
+{
+	return GetAsyncBackend().IsRunning();
+}
+
+} // namespace SimpleLog
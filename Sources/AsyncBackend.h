@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace SimpleLog
+{
+
+class LogBuffer;
+struct LogQueueStats;
+struct LogRecord;
+enum class LogMessageType : uint32_t;
+enum class LogOverflowPolicy : uint8_t;
+
+// Hands a finished record over to the backend thread, which writes it to stream or,
+// when stream is null, to the registered sinks. A full queue applies the overflow
+// policy of the record's type. Returns false when the caller has to write the record
+// itself: asynchronous logging is not running, the caller is the backend thread, or
+// a blocking record timed out.
+bool PushAsyncRecord(std::ostream* stream, const LogRecord& record);
+
+// Point in time a blocking record of message_type gives up waiting for space.
+std::chrono::steady_clock::time_point GetBlockDeadline(const LogMessageType message_type);
+
+// Counts a record discarded by an overflow policy, for the stats and the backend's
+// next "messages dropped" report.
+void ReportDroppedRecord(const LogMessageType message_type);
+
+// Async-signal-safe FlushAsyncLogging for the crash handler: asks the backend, without
+// notifying it, to write and flush every record queued so far, deferred ones included,
+// and polls until it did or timeout_ns passed. Returns false on timeout, and at once
+// when asynchronous logging is not running or the caller is the backend thread.
+bool FlushAsyncLoggingFromSignal(const int64_t timeout_ns);
+
+// Occupancy of the queue for GetLoggerStats().
+LogQueueStats GetAsyncQueueStats();
+
+// Formats every committed record of deferred call sites and writes it to the sinks
+// (DeferredLog.cpp); buffer is scratch space.
+size_t DrainDeferredRecords(LogBuffer& buffer);
+
+} // namespace SimpleLog
@@ -0,0 +1,305 @@
+#include "../Headers/BatchedFileStream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kBlockSize = 64 << 10;
+
+// Producers stop handing the work to the committer and commit themselves once the
+// open batch grows this many times past flush_bytes.
+constexpr size_t kBackpressureFactor = 8;
+
+} // namespace
+
+BatchedFileStream::Buffer::Buffer(const std::string& path, const BatchedFileOptions& options)
+	: options_(options)
+{
+	fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	closed_.store(fd_ < 0);
+	if (fd_ >= 0)
+	{
+		committer_ = std::thread(&Buffer::Run, this);
+	}
+}
+
+BatchedFileStream::Buffer::~Buffer()
+{
+	Close();
+}
+
+bool BatchedFileStream::Buffer::IsOpen() const
+{
+	return !closed_.load();
+}
+
+size_t BatchedFileStream::Buffer::GetCommitCount() const
+{
+	return commits_.load();
+}
+
+size_t BatchedFileStream::Buffer::GetSyncCount() const
+{
+	return syncs_.load();
+}
+
+void BatchedFileStream::Buffer::Close()
+{
+	if (closed_.exchange(true))
+	{
+		return;
+	}
+	// A writer may still be appending a record, or committing from the backpressure
+	// branch: its record goes into the last commit.
+	while (writers_.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	commit_cv_.notify_one();
+	committer_.join();
+	Commit();
+	if (options_.sync_every_commits != 0)
+	{
+		fdatasync(fd_);
+	}
+	close(fd_);
+	fd_ = -1;
+}
+
+bool BatchedFileStream::Buffer::EnterWriter()
+{
+	writers_.fetch_add(1);
+	if (closed_.load())
+	{
+		LeaveWriter();
+		return false;
+	}
+	return true;
+}
+
+void BatchedFileStream::Buffer::LeaveWriter()
+{
+	writers_.fetch_sub(1, std::memory_order_release);
+}
+
+std::streamsize BatchedFileStream::Buffer::xsputn(const char* const data, const std::streamsize size)
+{
+	if (size <= 0 || !EnterWriter())
+	{
+		return 0;
+	}
+	Append(data, static_cast<size_t>(size));
+	LeaveWriter();
+	return size;
+}
+
+BatchedFileStream::Buffer::int_type BatchedFileStream::Buffer::overflow(const int_type ch)
+{
+	if (traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		return traits_type::not_eof(ch);
+	}
+	const auto value = traits_type::to_char_type(ch);
+	return xsputn(&value, 1) == 1 ? ch : traits_type::eof();
+}
+
+int BatchedFileStream::Buffer::sync()
+{
+	if (!EnterWriter())
+	{
+		return -1;
+	}
+	const auto committed = Commit();
+	LeaveWriter();
+	return committed ? 0 : -1;
+}
+
+void BatchedFileStream::Buffer::Append(const char* const data, const size_t size)
+{
+	bool commit_now = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (batch_.empty() || batch_.back().capacity - batch_.back().size < size)
+		{
+			if (!free_blocks_.empty() && size <= kBlockSize)
+			{
+				batch_.push_back(std::move(free_blocks_.back()));
+				free_blocks_.pop_back();
+			}
+			else
+			{
+				const auto capacity = std::max(kBlockSize, size);
+				batch_.push_back(Block{std::unique_ptr<char[]>(new char[capacity]), capacity, 0});
+			}
+		}
+		auto& block = batch_.back();
+		std::memcpy(block.data.get() + block.size, data, size);
+		block.size += size;
+
+		if (batch_records_++ == 0)
+		{
+			batch_started_ = std::chrono::steady_clock::now();
+			commit_cv_.notify_one();
+		}
+		batch_bytes_ += size;
+		if (batch_bytes_ >= options_.flush_bytes || batch_records_ >= options_.flush_records)
+		{
+			commit_cv_.notify_one();
+		}
+		commit_now = batch_bytes_ >= options_.flush_bytes * kBackpressureFactor;
+	}
+	if (commit_now)
+	{
+		Commit();
+	}
+}
+
+bool BatchedFileStream::Buffer::Commit()
+{
+	std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+	std::vector<Block> blocks;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (batch_records_ == 0)
+		{
+			return true;
+		}
+		blocks.swap(batch_);
+		batch_.reserve(blocks.size());
+		batch_bytes_ = 0;
+		batch_records_ = 0;
+	}
+
+	const auto written = WriteBlocks(blocks);
+	const auto commits = ++commits_;
+	if (options_.sync_every_commits != 0 && commits % options_.sync_every_commits == 0)
+	{
+		fdatasync(fd_);
+		++syncs_;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto& block : blocks)
+	{
+		if (block.capacity == kBlockSize)
+		{
+			block.size = 0;
+			free_blocks_.push_back(std::move(block));
+		}
+	}
+	return written;
+}
+
+bool BatchedFileStream::Buffer::WriteBlocks(std::vector<Block>& blocks)
+{
+	std::vector<iovec> iov;
+	iov.reserve(blocks.size());
+	for (const auto& block : blocks)
+	{
+		iov.push_back(iovec{block.data.get(), block.size});
+	}
+
+	size_t first = 0;
+	while (first < iov.size())
+	{
+		const auto count = std::min(iov.size() - first, static_cast<size_t>(IOV_MAX));
+		auto written = writev(fd_, iov.data() + first, static_cast<int>(count));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		// Skips what a short write already consumed.
+		while (first < iov.size() && static_cast<size_t>(written) >= iov[first].iov_len)
+		{
+			written -= static_cast<ssize_t>(iov[first].iov_len);
+			++first;
+		}
+		if (first < iov.size())
+		{
+			iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+			iov[first].iov_len -= static_cast<size_t>(written);
+		}
+	}
+	return true;
+}
+
+void BatchedFileStream::Buffer::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!stop_)
+	{
+		if (batch_records_ == 0)
+		{
+			commit_cv_.wait(lock);
+			continue;
+		}
+		const auto deadline = batch_started_ + options_.max_latency;
+		if (batch_bytes_ < options_.flush_bytes &&
+			batch_records_ < options_.flush_records &&
+			std::chrono::steady_clock::now() < deadline)
+		{
+			commit_cv_.wait_until(lock, deadline);
+			continue;
+		}
+		lock.unlock();
+		Commit();
+		lock.lock();
+	}
+}
+
+BatchedFileStream::BatchedFileStream(const std::string& path, const BatchedFileOptions& options)
+	: std::ostream(nullptr)
+	, buffer_(path, options)
+{
+	rdbuf(&buffer_);
+	if (!buffer_.IsOpen())
+	{
+		setstate(std::ios_base::badbit);
+	}
+}
+
+BatchedFileStream::~BatchedFileStream()
+{
+	buffer_.Close();
+}
+
+bool BatchedFileStream::IsOpen() const
+{
+	return buffer_.IsOpen();
+}
+
+size_t BatchedFileStream::GetCommitCount() const
+{
+	return buffer_.GetCommitCount();
+}
+
+size_t BatchedFileStream::GetSyncCount() const
+{
+	return buffer_.GetSyncCount();
+}
+
+void BatchedFileStream::Close()
+{
+	buffer_.Close();
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,443 @@
+#include "../Headers/BlockLogFile.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr uint32_t kBlockMagic = 0x42474c53; // "SLGB"
+constexpr uint32_t kIndexMagic = 0x49474c53; // "SLGI"
+
+// Follows the index at the end of a cleanly closed file.
+struct BlockLogTrailer
+{
+	uint64_t index_offset;
+	uint32_t block_count;
+	uint32_t magic;
+};
+
+// Fixed part of a record in a block, followed by the file name, thread tag, context
+// and message bytes. Stored unaligned.
+struct BlockLogEntry
+{
+	int64_t timestamp_ns;
+	int32_t line;
+	uint16_t message_type;
+	uint16_t context_size;
+	uint32_t thread;
+	uint16_t file_size;
+	uint16_t tag_size;
+	uint32_t message_size;
+};
+
+constexpr size_t kEntrySize =
+	sizeof(int64_t) + sizeof(int32_t) + 2 * sizeof(uint32_t) + 4 * sizeof(uint16_t);
+
+template <typename T>
+void Store(char*& out, const T value)
+{
+	std::memcpy(out, &value, sizeof(value));
+	out += sizeof(value);
+}
+
+// An empty string_view may have a null data(), which memcpy must not get.
+void StoreBytes(char*& out, const char* const data, const size_t size)
+{
+	if (size != 0)
+	{
+		std::memcpy(out, data, size);
+		out += size;
+	}
+}
+
+template <typename T>
+void Load(const char*& in, T& value)
+{
+	std::memcpy(&value, in, sizeof(value));
+	in += sizeof(value);
+}
+
+// "[3:name]" -> 3; 0 without a number.
+uint32_t ParseThreadNumber(const std::string_view thread_tag)
+{
+	uint32_t number = 0;
+	for (size_t i = 1; i < thread_tag.size() && thread_tag[i] >= '0' && thread_tag[i] <= '9'; ++i)
+	{
+		number = number * 10 + static_cast<uint32_t>(thread_tag[i] - '0');
+	}
+	return number;
+}
+
+uint64_t GetThreadBit(const uint32_t thread)
+{
+	return thread == 0 ? 0 : uint64_t(1) << ((thread - 1) % 64);
+}
+
+uint64_t HashSite(const std::string_view file, const int line)
+{
+	// FNV-1a, then the line mixed in with a multiplicative step.
+	uint64_t hash = 14695981039346656037ull;
+	for (const auto c : file)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return (hash ^ static_cast<uint64_t>(static_cast<uint32_t>(line))) * 0x9e3779b97f4a7c15ull;
+}
+
+// Three probes into the 256-bit filter; line 0 stands for the file alone.
+void AddToFilter(uint64_t (&filter)[4], const uint64_t hash)
+{
+	for (int probe = 0; probe < 3; ++probe)
+	{
+		const auto bit = (hash >> (probe * 16 + 8)) & 255;
+		filter[bit / 64] |= uint64_t(1) << (bit % 64);
+	}
+}
+
+bool MayContain(const uint64_t (&filter)[4], const uint64_t hash)
+{
+	for (int probe = 0; probe < 3; ++probe)
+	{
+		const auto bit = (hash >> (probe * 16 + 8)) & 255;
+		if ((filter[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ReadAt(const int fd, void* const data, const size_t size, const uint64_t offset)
+{
+	auto* out = static_cast<char*>(data);
+	size_t done = 0;
+	while (done < size)
+	{
+		const auto count = pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+		if (count <= 0)
+		{
+			return false;
+		}
+		done += static_cast<size_t>(count);
+	}
+	return true;
+}
+
+bool WriteAt(const int fd, const void* const data, const size_t size, const uint64_t offset)
+{
+	const auto* in = static_cast<const char*>(data);
+	size_t done = 0;
+	while (done < size)
+	{
+		const auto count = pwrite(fd, in + done, size - done, static_cast<off_t>(offset + done));
+		if (count <= 0)
+		{
+			return false;
+		}
+		done += static_cast<size_t>(count);
+	}
+	return true;
+}
+
+uint64_t GetFileSize(const int fd)
+{
+	struct stat file_stat;
+	return fstat(fd, &file_stat) == 0 ? static_cast<uint64_t>(file_stat.st_size) : 0;
+}
+
+bool IsValidHeader(const BlockLogHeader& header, const uint64_t offset)
+{
+	return header.magic == kBlockMagic && header.offset == offset &&
+		header.size >= sizeof(BlockLogHeader) &&
+		header.payload_size <= header.size - sizeof(BlockLogHeader);
+}
+
+// Loads the block headers from the index of a closed file or, failing that, from the
+// blocks themselves. end is the offset just past the last block.
+void ReadBlockIndex(const int fd, std::vector<BlockLogHeader>& index, uint64_t& end, bool& indexed)
+{
+	index.clear();
+	end = 0;
+	indexed = false;
+	const auto file_size = GetFileSize(fd);
+
+	BlockLogTrailer trailer;
+	if (file_size >= sizeof(trailer) && ReadAt(fd, &trailer, sizeof(trailer), file_size - sizeof(trailer)) &&
+		trailer.magic == kIndexMagic &&
+		trailer.index_offset + uint64_t(trailer.block_count) * sizeof(BlockLogHeader) + sizeof(trailer) == file_size)
+	{
+		index.resize(trailer.block_count);
+		if (index.empty() || ReadAt(fd, index.data(), index.size() * sizeof(BlockLogHeader), trailer.index_offset))
+		{
+			end = trailer.index_offset;
+			indexed = true;
+			return;
+		}
+		index.clear();
+	}
+
+	BlockLogHeader header;
+	while (end + sizeof(header) <= file_size && ReadAt(fd, &header, sizeof(header), end) && IsValidHeader(header, end))
+	{
+		index.push_back(header);
+		end += header.size;
+	}
+}
+
+bool Matches(const BlockLogHeader& header, const BlockLogQuery& query, const uint64_t site_hash)
+{
+	return header.record_count != 0 &&
+		header.max_timestamp_ns >= query.begin_ns &&
+		header.min_timestamp_ns <= query.end_ns &&
+		(header.message_types & query.message_types) != 0 &&
+		(query.thread == 0 || (header.thread_mask & GetThreadBit(query.thread)) != 0) &&
+		(query.file.empty() || MayContain(header.site_filter, site_hash));
+}
+
+} // namespace
+
+BlockFileSink::BlockFileSink(const std::string& path, const uint32_t message_types, const size_t block_size)
+	: LogSink(message_types)
+	, block_size_(std::max<size_t>(block_size, 4 << 10))
+{
+	fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+	{
+		return;
+	}
+	// Appending drops the index of a closed file and whatever a crash left after the
+	// last complete block.
+	bool indexed = false;
+	ReadBlockIndex(fd_, index_, block_offset_, indexed);
+	if (ftruncate(fd_, static_cast<off_t>(block_offset_)) != 0)
+	{
+		close(fd_);
+		fd_ = -1;
+		return;
+	}
+	StartBlock();
+}
+
+BlockFileSink::~BlockFileSink()
+{
+	Close();
+}
+
+bool BlockFileSink::IsOpen() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return fd_ >= 0;
+}
+
+void BlockFileSink::Write(const LogRecord& record, std::string_view)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ < 0)
+	{
+		return;
+	}
+
+	const auto file_size = std::min<size_t>(record.file_name.size(), UINT16_MAX);
+	const auto tag_size = std::min<size_t>(record.thread_tag.size(), UINT16_MAX);
+	const auto context_size = std::min<size_t>(record.context.size(), UINT16_MAX);
+	const auto message_size = std::min<size_t>(record.message.size() + record.fields.size(), UINT32_MAX / 2);
+	const auto entry_size = kEntrySize + file_size + tag_size + context_size + message_size;
+
+	auto used = sizeof(BlockLogHeader) + header_.payload_size;
+	if (header_.record_count != 0 && used + entry_size > block_.size())
+	{
+		WriteBlock();
+		index_.push_back(header_);
+		block_offset_ += block_.size();
+		StartBlock();
+		used = sizeof(BlockLogHeader);
+	}
+	if (used + entry_size > block_.size())
+	{
+		// A record larger than a block gets a block of several.
+		block_.resize((used + entry_size + block_size_ - 1) / block_size_ * block_size_);
+	}
+
+	const auto thread = ParseThreadNumber(record.thread_tag);
+	auto* out = block_.data() + used;
+	Store(out, record.timestamp_ns);
+	Store(out, static_cast<int32_t>(record.line));
+	Store(out, static_cast<uint16_t>(record.message_type));
+	Store(out, static_cast<uint16_t>(context_size));
+	Store(out, thread);
+	Store(out, static_cast<uint16_t>(file_size));
+	Store(out, static_cast<uint16_t>(tag_size));
+	Store(out, static_cast<uint32_t>(message_size));
+	StoreBytes(out, record.file_name.data(), file_size);
+	StoreBytes(out, record.thread_tag.data(), tag_size);
+	StoreBytes(out, record.context.data(), context_size);
+	const auto text_size = std::min(record.message.size(), message_size);
+	StoreBytes(out, record.message.data(), text_size);
+	StoreBytes(out, record.fields.data(), message_size - text_size);
+
+	header_.payload_size += static_cast<uint32_t>(entry_size);
+	++header_.record_count;
+	header_.min_timestamp_ns = std::min(header_.min_timestamp_ns, record.timestamp_ns);
+	header_.max_timestamp_ns = std::max(header_.max_timestamp_ns, record.timestamp_ns);
+	header_.message_types |= static_cast<uint32_t>(record.message_type);
+	header_.thread_mask |= GetThreadBit(thread);
+	const std::string_view file_name(record.file_name.data(), file_size);
+	AddToFilter(header_.site_filter, HashSite(file_name, 0));
+	AddToFilter(header_.site_filter, HashSite(file_name, record.line));
+}
+
+void BlockFileSink::Flush()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ >= 0 && header_.record_count != 0)
+	{
+		WriteBlock();
+	}
+}
+
+void BlockFileSink::Close()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ < 0)
+	{
+		return;
+	}
+	auto index_offset = block_offset_;
+	if (header_.record_count != 0)
+	{
+		WriteBlock();
+		index_.push_back(header_);
+		index_offset += block_.size();
+	}
+	const BlockLogTrailer trailer{index_offset, static_cast<uint32_t>(index_.size()), kIndexMagic};
+	const auto index_size = index_.size() * sizeof(BlockLogHeader);
+	if (WriteAt(fd_, index_.data(), index_size, index_offset))
+	{
+		WriteAt(fd_, &trailer, sizeof(trailer), index_offset + index_size);
+	}
+	close(fd_);
+	fd_ = -1;
+}
+
+// The records go first and the header last, so a header never covers bytes that are
+// not in the file yet.
+void BlockFileSink::WriteBlock()
+{
+	const auto used = sizeof(BlockLogHeader) + header_.payload_size;
+	header_.size = static_cast<uint32_t>(block_.size());
+	const auto payload_begin = std::max(written_size_, sizeof(BlockLogHeader));
+	if (WriteAt(fd_, block_.data() + payload_begin, used - payload_begin, block_offset_ + payload_begin) &&
+		WriteAt(fd_, &header_, sizeof(header_), block_offset_))
+	{
+		written_size_ = used;
+	}
+}
+
+void BlockFileSink::StartBlock()
+{
+	block_.assign(block_size_, 0);
+	written_size_ = 0;
+	header_ = BlockLogHeader();
+	header_.magic = kBlockMagic;
+	header_.offset = block_offset_;
+	header_.min_timestamp_ns = std::numeric_limits<int64_t>::max();
+	header_.max_timestamp_ns = std::numeric_limits<int64_t>::min();
+}
+
+bool QueryBlockLog(
+	const std::string& path,
+	const BlockLogQuery& query,
+	const std::function<void(const LogRecord&)>& visit,
+	BlockLogQueryStats* const stats)
+{
+	const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	BlockLogQueryStats query_stats;
+	std::vector<BlockLogHeader> index;
+	uint64_t end = 0;
+	ReadBlockIndex(fd, index, end, query_stats.indexed);
+	query_stats.blocks = index.size();
+
+	const auto site_hash = HashSite(query.file, query.line);
+	std::vector<char> block;
+	for (const auto& header : index)
+	{
+		if (!Matches(header, query, site_hash))
+		{
+			continue;
+		}
+		// Only the records: the block's tail may not be in the file.
+		block.resize(header.payload_size);
+		if (!ReadAt(fd, block.data(), block.size(), header.offset + sizeof(BlockLogHeader)))
+		{
+			continue;
+		}
+		++query_stats.blocks_read;
+
+		const char* in = block.data();
+		const char* const block_end = block.data() + block.size();
+		for (uint32_t i = 0; i < header.record_count && static_cast<size_t>(block_end - in) >= kEntrySize; ++i)
+		{
+			BlockLogEntry entry;
+			Load(in, entry.timestamp_ns);
+			Load(in, entry.line);
+			Load(in, entry.message_type);
+			Load(in, entry.context_size);
+			Load(in, entry.thread);
+			Load(in, entry.file_size);
+			Load(in, entry.tag_size);
+			Load(in, entry.message_size);
+			const size_t size = size_t(entry.file_size) + entry.tag_size + entry.context_size + entry.message_size;
+			if (static_cast<size_t>(block_end - in) < size)
+			{
+				break;
+			}
+			const std::string_view file_name(in, entry.file_size);
+			const std::string_view thread_tag(in + entry.file_size, entry.tag_size);
+			const std::string_view context(in + entry.file_size + entry.tag_size, entry.context_size);
+			const std::string_view message(in + entry.file_size + entry.tag_size + entry.context_size, entry.message_size);
+			in += size;
+
+			if (entry.timestamp_ns < query.begin_ns || entry.timestamp_ns > query.end_ns ||
+				(entry.message_type & query.message_types) == 0 ||
+				(query.thread != 0 && entry.thread != query.thread) ||
+				(!query.file.empty() && file_name != query.file) ||
+				(query.line != 0 && entry.line != query.line))
+			{
+				continue;
+			}
+			++query_stats.records;
+			visit(LogRecord{
+				static_cast<LogMessageType>(entry.message_type),
+				entry.timestamp_ns,
+				thread_tag,
+				file_name,
+				entry.line,
+				message,
+				std::string_view(),
+				std::string_view(),
+				context});
+		}
+	}
+	close(fd);
+	if (stats != nullptr)
+	{
+		*stats = query_stats;
+	}
+	return true;
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,330 @@
+#include "../Headers/Logger.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SimpleLog
+{
+
+class CallSiteRegistry
+{
+public:
+	uint32_t Resolve(CallSite& site)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto decision = Decide(site);
+		const auto generation = detail::log_config.generation.load(std::memory_order_relaxed);
+		site.state_.store((generation << CallSite::kDecisionBits) | decision, std::memory_order_relaxed);
+		return decision;
+	}
+
+	void SetEnabled(const char* const file_name, const int line, const bool enabled)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		rules_[RuleKey(file_name, std::max(line, 0))] = Rule{enabled, ++rule_order_};
+		PruneRules();
+		BumpGeneration();
+	}
+
+	bool SetVModule(const std::string_view spec)
+	{
+		std::vector<VModuleEntry> entries;
+		if (!ParseVModule(spec, entries))
+		{
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		vmodule_ = std::move(entries);
+		vmodule_spec_ = std::string(spec);
+		BumpGeneration();
+		SetLogConfigFlag(LogConfig::kVModule, !vmodule_.empty());
+		return true;
+	}
+
+	std::string GetVModule()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return vmodule_spec_;
+	}
+
+private:
+	// File name and line, 0 for the whole file.
+	using RuleKey = std::pair<std::string, int>;
+
+	struct Rule
+	{
+		bool enabled;
+		// Later rules override earlier ones.
+		uint64_t order;
+	};
+
+	struct VModuleEntry
+	{
+		std::string pattern;
+		// Least severe GetLogLevel() enabled.
+		uint32_t level;
+	};
+
+	// Whether suffix is path or its trailing path components.
+	static bool IsPathSuffix(const std::string_view path, const std::string_view suffix)
+	{
+		if (path.size() < suffix.size() || path.compare(path.size() - suffix.size(), suffix.size(), suffix) != 0)
+		{
+			return false;
+		}
+		if (path.size() == suffix.size())
+		{
+			return true;
+		}
+		const auto separator = path[path.size() - suffix.size() - 1];
+		return separator == '/' || separator == '\\';
+	}
+
+	static bool Matches(const RuleKey& key, const CallSite& site)
+	{
+		return (key.second == 0 || key.second == site.GetLine()) && IsPathSuffix(site.GetFile(), key.first);
+	}
+
+	// Every site matching key also matches cover.
+	static bool Covers(const RuleKey& cover, const RuleKey& key)
+	{
+		return (cover.second == 0 || cover.second == key.second) && IsPathSuffix(key.first, cover.first);
+	}
+
+	// Some site may match both keys.
+	static bool Overlap(const RuleKey& first, const RuleKey& second)
+	{
+		return (first.second == 0 || second.second == 0 || first.second == second.second) &&
+			(IsPathSuffix(first.first, second.first) || IsPathSuffix(second.first, first.first));
+	}
+
+	// Keeps rules_ bounded by what can still change a decision: drops the rules a later
+	// one fully overrides, then the enabling rules no earlier disabling rule overlaps.
+	void PruneRules()
+	{
+		for (auto it = rules_.begin(); it != rules_.end();)
+		{
+			const auto shadowed = std::any_of(rules_.cbegin(), rules_.cend(), [it](const auto& other)
+			{
+				return other.second.order > it->second.order && Covers(other.first, it->first);
+			});
+			it = shadowed ? rules_.erase(it) : std::next(it);
+		}
+		for (auto it = rules_.begin(); it != rules_.end();)
+		{
+			const auto needed = !it->second.enabled ||
+				std::any_of(rules_.cbegin(), rules_.cend(), [it](const auto& other)
+				{
+					return !other.second.enabled && other.second.order < it->second.order &&
+						Overlap(other.first, it->first);
+				});
+			it = needed ? std::next(it) : rules_.erase(it);
+		}
+	}
+
+	// '*' matches any run of characters, '?' one; backtracks to the last '*' only.
+	static bool GlobMatches(const std::string_view pattern, const std::string_view text)
+	{
+		size_t p = 0;
+		size_t t = 0;
+		auto star = std::string_view::npos;
+		size_t star_text = 0;
+		while (t < text.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+			{
+				++p;
+				++t;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				star = p++;
+				star_text = t;
+			}
+			else if (star != std::string_view::npos)
+			{
+				p = star + 1;
+				t = ++star_text;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*')
+		{
+			++p;
+		}
+		return p == pattern.size();
+	}
+
+	// Against the whole path and every suffix starting after a separator.
+	static bool Matches(const VModuleEntry& entry, const CallSite& site)
+	{
+		const auto file = site.GetFile();
+		for (size_t begin = 0; begin < file.size(); ++begin)
+		{
+			if ((begin == 0 || file[begin - 1] == '/' || file[begin - 1] == '\\') &&
+				GlobMatches(entry.pattern, file.substr(begin)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static std::string_view Trim(std::string_view text)
+	{
+		while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+		{
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+		{
+			text.remove_suffix(1);
+		}
+		return text;
+	}
+
+	static bool ParseLevel(const std::string_view text, uint32_t& level)
+	{
+		std::string name;
+		for (const auto c : text)
+		{
+			name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+		if (name == "info")
+		{
+			level = SIMPLE_LOG_LEVEL_INFO;
+		}
+		else if (name == "warning")
+		{
+			level = SIMPLE_LOG_LEVEL_WARNING;
+		}
+		else if (name == "error")
+		{
+			level = SIMPLE_LOG_LEVEL_ERROR;
+		}
+		else if (name == "fatal")
+		{
+			level = SIMPLE_LOG_LEVEL_FATAL_ERROR;
+		}
+		else if (name == "off")
+		{
+			level = SIMPLE_LOG_LEVEL_NONE;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	static bool ParseVModule(const std::string_view spec, std::vector<VModuleEntry>& entries)
+	{
+		size_t begin = 0;
+		while (begin <= spec.size())
+		{
+			const auto end = std::min(spec.find(',', begin), spec.size());
+			const auto entry = Trim(spec.substr(begin, end - begin));
+			begin = end + 1;
+			if (entry.empty())
+			{
+				continue;
+			}
+			const auto equal = entry.rfind('=');
+			if (equal == std::string_view::npos)
+			{
+				return false;
+			}
+			const auto pattern = Trim(entry.substr(0, equal));
+			uint32_t level = 0;
+			if (pattern.empty() || !ParseLevel(Trim(entry.substr(equal + 1)), level))
+			{
+				return false;
+			}
+			entries.push_back(VModuleEntry{std::string(pattern), level});
+		}
+		return true;
+	}
+
+	// Later rules and entries override earlier ones.
+	uint32_t Decide(const CallSite& site) const
+	{
+		auto enabled = true;
+		uint64_t order = 0;
+		for (const auto& [key, rule] : rules_)
+		{
+			if (rule.order > order && Matches(key, site))
+			{
+				enabled = rule.enabled;
+				order = rule.order;
+			}
+		}
+		if (!enabled)
+		{
+			return CallSite::kSwitchedOff;
+		}
+		for (auto it = vmodule_.rbegin(); it != vmodule_.rend(); ++it)
+		{
+			if (Matches(*it, site))
+			{
+				return GetLogLevel(site.GetMessageType()) >= it->level ? CallSite::kForced : CallSite::kFiltered;
+			}
+		}
+		return CallSite::kFollowFilters;
+	}
+
+	// Every site resolves again on its next evaluation.
+	static void BumpGeneration()
+	{
+		constexpr auto mask = UINT32_MAX >> CallSite::kDecisionBits;
+		auto generation = (detail::log_config.generation.load(std::memory_order_relaxed) + 1) & mask;
+		detail::log_config.generation.store(generation == 0 ? 1 : generation, std::memory_order_relaxed);
+	}
+
+	std::mutex mutex_;
+	std::map<RuleKey, Rule> rules_;
+	uint64_t rule_order_ = 0;
+	std::vector<VModuleEntry> vmodule_;
+	std::string vmodule_spec_;
+};
+
+namespace
+{
+
+// Never destroyed: sites may be reached during static destruction.
+CallSiteRegistry& GetCallSiteRegistry()
+{
+	static auto* const registry = new CallSiteRegistry();
+	return *registry;
+}
+
+} // namespace
+
+uint32_t CallSite::Resolve()
+{
+	return GetCallSiteRegistry().Resolve(*this);
+}
+
+void SetCallSiteEnabled(const char* const file_name, const int line, const bool enabled)
+{
+	GetCallSiteRegistry().SetEnabled(file_name, line, enabled);
+}
+
+bool SetLogVModule(const std::string_view spec)
+{
+	return GetCallSiteRegistry().SetVModule(spec);
+}
+
+std::string GetLogVModule()
+{
+	return GetCallSiteRegistry().GetVModule();
+}
+
+} // namespace SimpleLog
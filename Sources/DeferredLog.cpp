@@ -0,0 +1,617 @@
+#include "../Headers/DeferredLog.h"
+#include "../Headers/FlightRecorder.h"
+#include "../Headers/LogContext.h"
+#include "../Headers/LoggerStats.h"
+#include "AsyncBackend.h"
+#include "EmergencyLine.h"
+#include "LoggerPrivate.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kThreadBufferSize = 1 << 18;
+
+// Followed by the producer's context text, then the arguments.
+struct DeferredRecordHeader
+{
+	const DeferredSite* site;
+	int64_t timestamp_ns;
+	uint32_t size;
+	uint32_t context_size;
+};
+
+constexpr size_t AlignRecord(const size_t size)
+{
+	return (size + alignof(DeferredRecordHeader) - 1) & ~(alignof(DeferredRecordHeader) - 1);
+}
+
+template <typename Out>
+void AppendArgument(Out& buffer, DeferredArgType type, const char*& payload);
+
+// Appends the format of site with its placeholders replaced by the arguments in payload.
+template <typename Out>
+void AppendDeferredMessage(Out& buffer, const DeferredSite& site, const char* payload)
+{
+	const char* format = site.format;
+	size_t arg_index = 0;
+	while (*format != '\0')
+	{
+		const char* placeholder = std::strstr(format, "{}");
+		if (placeholder == nullptr || arg_index == site.arg_count)
+		{
+			buffer.Append(format, std::strlen(format));
+			break;
+		}
+		buffer.Append(format, static_cast<size_t>(placeholder - format));
+		AppendArgument(buffer, site.arg_types[arg_index++], payload);
+		format = placeholder + 2;
+	}
+}
+
+// Renders a record into buffer; returns the offset of its message text.
+size_t AppendDeferredRecord(
+	LogBuffer& buffer,
+	const DeferredSite& site,
+	const char* payload,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context)
+{
+	buffer.ResetStream();
+	PrintInfos(buffer, *site.call_site, timestamp_ns, thread_tag, context);
+	buffer.Append("$ ", 2);
+	const auto message_begin = buffer.Size();
+	AppendDeferredMessage(buffer, site, payload);
+	buffer.Append('\n');
+	return message_begin;
+}
+
+// Formats the record behind header and hands it to the sinks.
+// With queue set the record goes through the asynchronous queue when it is running.
+void WriteDeferredRecord(
+	LogBuffer& buffer,
+	const DeferredRecordHeader& header,
+	const std::string_view thread_tag,
+	const bool queue = false)
+{
+	const auto& site = *header.site;
+	const auto begin = buffer.Size();
+	const auto format_begin_ns = IsLoggerTimingEnabled() ? GetCurrentTimeStamp() : 0;
+	const std::string_view context(reinterpret_cast<const char*>(&header + 1), header.context_size);
+	const auto message_begin = AppendDeferredRecord(
+		buffer, site, context.data() + context.size(), header.timestamp_ns, thread_tag, context);
+	if (format_begin_ns != 0)
+	{
+		CountFormatTime(GetCurrentTimeStamp() - format_begin_ns);
+	}
+	const LogRecord record{
+		site.call_site->GetMessageType(),
+		header.timestamp_ns,
+		thread_tag,
+		site.call_site->GetFileName(),
+		site.call_site->GetLine(),
+		std::string_view(buffer.Data() + message_begin, buffer.Size() - 1 - message_begin),
+		std::string_view(buffer.Data() + begin, buffer.Size() - begin),
+		std::string_view(),
+		context};
+	// A fatal record, never queued, is written by its thread once everything queued
+	// before it is; it goes to the emergency descriptors first, as the flush can block.
+	if (record.message_type == LogMessageType::FatalError)
+	{
+		WriteEmergencyRecord(record.text);
+		FlushAsyncLogging();
+	}
+	if (!queue || !PushAsyncRecord(nullptr, record))
+	{
+		CountEmitted(record.message_type, record.text.size());
+		DispatchLogRecord(record);
+	}
+	buffer.Truncate(begin);
+}
+
+// Single-producer/single-consumer byte ring owned by one logging thread. Records never
+// wrap: a header with a null site (or a tail too short for a header) pads to the end.
+class DeferredThreadBuffer
+{
+public:
+	DeferredThreadBuffer()
+		: thread_tag_(GetThreadTag())
+		, data_(new char[kThreadBufferSize])
+	{}
+
+	char* Reserve(const size_t size)
+	{
+		const auto offset = head_ & (kThreadBufferSize - 1);
+		const auto to_end = kThreadBufferSize - offset;
+		const auto needed = size <= to_end ? size : to_end + size;
+		if (!HasSpace(needed))
+		{
+			return nullptr;
+		}
+
+		if (size > to_end)
+		{
+			if (to_end >= sizeof(DeferredRecordHeader))
+			{
+				auto* const padding = reinterpret_cast<DeferredRecordHeader*>(data_.get() + offset);
+				padding->site = nullptr;
+			}
+			head_ += to_end;
+		}
+		pending_size_ = size;
+		return data_.get() + (head_ & (kThreadBufferSize - 1));
+	}
+
+	void Commit()
+	{
+		head_ += pending_size_;
+		// Sequentially consistent, like the load of the head in Drain: with the accepting
+		// flag of the backend, either the producer sees it cleared or the last drain of
+		// StopAsyncLogging sees the record.
+		published_head_.store(head_, std::memory_order_seq_cst);
+	}
+
+	bool Empty() const
+	{
+		return tail_.load(std::memory_order_acquire) == published_head_.load(std::memory_order_acquire);
+	}
+
+	// Consumer side; callers serialize through DrainMutex().
+	size_t Drain(LogBuffer& buffer)
+	{
+		const auto head = published_head_.load(std::memory_order_seq_cst);
+		auto tail = tail_.load(std::memory_order_relaxed);
+		size_t drained = 0;
+		while (tail != head)
+		{
+			const auto offset = tail & (kThreadBufferSize - 1);
+			const auto to_end = kThreadBufferSize - offset;
+			const auto* const header = reinterpret_cast<const DeferredRecordHeader*>(data_.get() + offset);
+			if (to_end < sizeof(DeferredRecordHeader) || header->site == nullptr)
+			{
+				tail += to_end;
+				continue;
+			}
+
+			WriteDeferredRecord(buffer, *header, thread_tag_);
+
+			tail += header->size;
+			tail_.store(tail, std::memory_order_release);
+			++drained;
+		}
+		tail_.store(tail, std::memory_order_release);
+		return drained;
+	}
+
+	// Producer side: discards the oldest committed record to make room. Returns its
+	// site, or null when there is none or a drain, which frees space anyway, is running.
+	const DeferredSite* DropOldest()
+	{
+		std::unique_lock<std::mutex> lock(drain_mutex_, std::try_to_lock);
+		if (!lock.owns_lock())
+		{
+			return nullptr;
+		}
+		const auto head = published_head_.load(std::memory_order_acquire);
+		auto tail = tail_.load(std::memory_order_relaxed);
+		while (tail != head)
+		{
+			const auto offset = tail & (kThreadBufferSize - 1);
+			const auto to_end = kThreadBufferSize - offset;
+			const auto* const header = reinterpret_cast<const DeferredRecordHeader*>(data_.get() + offset);
+			if (to_end < sizeof(DeferredRecordHeader) || header->site == nullptr)
+			{
+				tail += to_end;
+				continue;
+			}
+			tail_.store(tail + header->size, std::memory_order_release);
+			return header->site;
+		}
+		tail_.store(tail, std::memory_order_release);
+		return nullptr;
+	}
+
+	std::mutex& DrainMutex()
+	{
+		return drain_mutex_;
+	}
+
+	void Retire()
+	{
+		retired_.store(true);
+	}
+
+	bool Retired() const
+	{
+		return retired_.load();
+	}
+
+private:
+	bool HasSpace(const size_t size)
+	{
+		if (head_ + size - cached_tail_ <= kThreadBufferSize)
+		{
+			return true;
+		}
+		cached_tail_ = tail_.load(std::memory_order_acquire);
+		return head_ + size - cached_tail_ <= kThreadBufferSize;
+	}
+
+	// Captured when the thread first defers a record; later SetThreadName calls only
+	// affect records formatted on the calling thread.
+	const std::string thread_tag_;
+	const std::unique_ptr<char[]> data_;
+
+	// Producer state.
+	size_t head_ = 0;
+	size_t cached_tail_ = 0;
+	size_t pending_size_ = 0;
+	alignas(64) std::atomic<size_t> published_head_{0};
+
+	alignas(64) std::atomic<size_t> tail_{0};
+	std::mutex drain_mutex_;
+	std::atomic<bool> retired_{false};
+};
+
+struct DeferredRegistry
+{
+	std::mutex mutex;
+	std::vector<std::shared_ptr<DeferredThreadBuffer>> buffers;
+};
+
+// Never destroyed: the backend drains it during static destruction.
+DeferredRegistry& GetDeferredRegistry()
+{
+	static auto* const registry = new DeferredRegistry();
+	return *registry;
+}
+
+class DeferredThreadState
+{
+public:
+	~DeferredThreadState()
+	{
+		if (buffer_ == nullptr)
+		{
+			return;
+		}
+		if (!IsAsyncLogging())
+		{
+			DrainOwnBuffer();
+		}
+		buffer_->Retire();
+	}
+
+	char* Begin(const DeferredSite& site, const size_t payload_size, const LogDisposition disposition)
+	{
+		const auto context = GetLogContext();
+		const auto size = AlignRecord(sizeof(DeferredRecordHeader) + context.size() + payload_size);
+		const auto message_type = site.call_site->GetMessageType();
+		char* record = nullptr;
+		record_only_ = disposition == LogDisposition::RecordOnly;
+		dropped_ = false;
+		overflowed_ = false;
+		// A fatal record is written by the calling thread once the queue is flushed.
+		in_ring_ = !record_only_ && message_type != LogMessageType::FatalError &&
+			IsAsyncLogging() && size <= kThreadBufferSize / 2;
+		if (in_ring_)
+		{
+			record = GetBuffer().Reserve(size);
+			if (record == nullptr)
+			{
+				record = ReserveFull(message_type, size);
+			}
+		}
+
+		if (!in_ring_)
+		{
+			if (!record_only_ && !dropped_ && !overflowed_ && buffer_ != nullptr && !buffer_->Empty())
+			{
+				// Records left behind by a stopped backend, or by one too slow for a
+				// blocking record, keep their order.
+				DrainOwnBuffer();
+			}
+			if (scratch_size_ < size)
+			{
+				scratch_.reset(new DeferredRecordHeader[size / sizeof(DeferredRecordHeader) + 1]);
+				scratch_size_ = size;
+			}
+			record = reinterpret_cast<char*>(scratch_.get());
+		}
+
+		auto* const header = reinterpret_cast<DeferredRecordHeader*>(record);
+		header->site = &site;
+		header->timestamp_ns = GetCurrentTimeStamp();
+		header->size = static_cast<uint32_t>(size);
+		header->context_size = static_cast<uint32_t>(context.size());
+		header_ = header;
+		auto* const context_copy = reinterpret_cast<char*>(header + 1);
+		// Without a context, context.data() may be null.
+		if (!context.empty())
+		{
+			std::memcpy(context_copy, context.data(), context.size());
+		}
+		return context_copy + context.size();
+	}
+
+	void Commit()
+	{
+		if (IsFlightRecorderEnabled())
+		{
+			const auto* const context = reinterpret_cast<const char*>(header_ + 1);
+			RecordFlightDeferred(*header_->site, header_->timestamp_ns,
+				std::string_view(context, header_->context_size), context + header_->context_size,
+				header_->size - sizeof(DeferredRecordHeader) - header_->context_size);
+		}
+		if (record_only_)
+		{
+			return;
+		}
+
+		const auto message_type = header_->site->call_site->GetMessageType();
+		if (dropped_)
+		{
+			ReportDroppedRecord(message_type);
+			return;
+		}
+		if (in_ring_)
+		{
+			buffer_->Commit();
+			// StopAsyncLogging may have run its last drain since Begin: the record is
+			// then written by this thread.
+			if (!IsAsyncLogging())
+			{
+				DrainOwnBuffer();
+			}
+			return;
+		}
+
+		const auto fatal = message_type == LogMessageType::FatalError;
+		WriteDeferredRecord(GetThreadLogBuffer(), *header_, GetThreadTag(), overflowed_);
+		if (fatal)
+		{
+			FlushLogSinks();
+			DumpFlightRecorder();
+		}
+	}
+
+private:
+	// The ring is full: applies the overflow policy of the record's type. Returns the
+	// reserved space, or null with in_ring_ cleared when the record takes another path.
+	char* ReserveFull(const LogMessageType message_type, const size_t size)
+	{
+		in_ring_ = false;
+		const auto policy = GetLogOverflowPolicy(message_type);
+		switch (policy)
+		{
+		case LogOverflowPolicy::DropNewest:
+			dropped_ = true;
+			return nullptr;
+		case LogOverflowPolicy::OverflowToHeap:
+			// Formatted by this thread and parked in the asynchronous queue's overflow.
+			overflowed_ = true;
+			return nullptr;
+		case LogOverflowPolicy::DropOldest:
+		case LogOverflowPolicy::Block:
+			break;
+		}
+
+		const auto deadline = GetBlockDeadline(message_type);
+		char* record = nullptr;
+		while ((record = buffer_->Reserve(size)) == nullptr)
+		{
+			if (!IsAsyncLogging())
+			{
+				return nullptr;
+			}
+			if (policy == LogOverflowPolicy::DropOldest)
+			{
+				const auto* const dropped_site = buffer_->DropOldest();
+				if (dropped_site == nullptr)
+				{
+					// The backend is draining this ring, maybe stuck in a slow sink:
+					// drop the new record rather than wait for it.
+					dropped_ = true;
+					return nullptr;
+				}
+				ReportDroppedRecord(dropped_site->call_site->GetMessageType());
+				continue;
+			}
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				return nullptr;
+			}
+			std::this_thread::yield();
+		}
+		in_ring_ = true;
+		return record;
+	}
+
+	DeferredThreadBuffer& GetBuffer()
+	{
+		if (buffer_ == nullptr)
+		{
+			buffer_ = std::make_shared<DeferredThreadBuffer>();
+			auto& registry = GetDeferredRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.buffers.push_back(buffer_);
+		}
+		return *buffer_;
+	}
+
+	// Also reached at thread exit, where the thread-local LogBuffer may already be
+	// destroyed, so it is not used here.
+	void DrainOwnBuffer()
+	{
+		LogBuffer log_buffer;
+		std::lock_guard<std::mutex> lock(buffer_->DrainMutex());
+		buffer_->Drain(log_buffer);
+	}
+
+	std::shared_ptr<DeferredThreadBuffer> buffer_;
+	std::unique_ptr<DeferredRecordHeader[]> scratch_;
+	size_t scratch_size_ = 0;
+	DeferredRecordHeader* header_ = nullptr;
+	bool in_ring_ = false;
+	bool record_only_ = false;
+	bool dropped_ = false;
+	bool overflowed_ = false;
+};
+
+DeferredThreadState& GetDeferredThreadState()
+{
+	thread_local DeferredThreadState state;
+	return state;
+}
+
+// Async-signal-safe counterparts of the LogBuffer helpers, for the flight recorder's
+// signal dump.
+void AppendInteger(EmergencyLine& line, const int64_t value)
+{
+	line.AppendSigned(value);
+}
+
+void AppendInteger(EmergencyLine& line, const uint64_t value)
+{
+	line.AppendUnsigned(value);
+}
+
+template <typename T>
+void AppendFloatingPoint(EmergencyLine& line, const T value)
+{
+	char digits[32];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+	line.Append(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+void AppendPointer(EmergencyLine& line, const void* const value)
+{
+	if (value == nullptr)
+	{
+		line.Append('0');
+		return;
+	}
+	line.Append("0x", 2);
+	line.AppendUnsigned(reinterpret_cast<uintptr_t>(value), 16);
+}
+
+template <typename Out>
+void AppendArgument(Out& buffer, const DeferredArgType type, const char*& payload)
+{
+	switch (type)
+	{
+	case DeferredArgType::Int:
+	{
+		int64_t value;
+		std::memcpy(&value, payload, sizeof(value));
+		payload += sizeof(value);
+		AppendInteger(buffer, value);
+		break;
+	}
+	case DeferredArgType::UInt:
+	{
+		uint64_t value;
+		std::memcpy(&value, payload, sizeof(value));
+		payload += sizeof(value);
+		AppendInteger(buffer, value);
+		break;
+	}
+	case DeferredArgType::Float:
+	{
+		float value;
+		std::memcpy(&value, payload, sizeof(value));
+		payload += sizeof(value);
+		AppendFloatingPoint(buffer, value);
+		break;
+	}
+	case DeferredArgType::Double:
+	{
+		double value;
+		std::memcpy(&value, payload, sizeof(value));
+		payload += sizeof(value);
+		AppendFloatingPoint(buffer, value);
+		break;
+	}
+	case DeferredArgType::Bool:
+		buffer.Append(*payload != 0 ? '1' : '0');
+		++payload;
+		break;
+	case DeferredArgType::Char:
+		buffer.Append(*payload);
+		++payload;
+		break;
+	case DeferredArgType::String:
+	{
+		uint32_t size;
+		std::memcpy(&size, payload, sizeof(size));
+		buffer.Append(payload + sizeof(size), size);
+		payload += sizeof(size) + size;
+		break;
+	}
+	case DeferredArgType::Pointer:
+	{
+		uintptr_t value;
+		std::memcpy(&value, payload, sizeof(value));
+		payload += sizeof(value);
+		AppendPointer(buffer, reinterpret_cast<const void*>(value));
+		break;
+	}
+	}
+}
+
+} // namespace
+
+size_t DrainDeferredRecords(LogBuffer& buffer)
+{
+	auto& registry = GetDeferredRegistry();
+	std::lock_guard<std::mutex> registry_lock(registry.mutex);
+	size_t drained = 0;
+	for (auto it = registry.buffers.begin(); it != registry.buffers.end();)
+	{
+		auto& thread_buffer = **it;
+		const auto retired = thread_buffer.Retired();
+		{
+			std::lock_guard<std::mutex> lock(thread_buffer.DrainMutex());
+			drained += thread_buffer.Drain(buffer);
+		}
+		it = retired ? registry.buffers.erase(it) : it + 1;
+	}
+	return drained;
+}
+
+char* BeginDeferredRecord(const DeferredSite& site, const size_t payload_size, const LogDisposition disposition)
+{
+	return GetDeferredThreadState().Begin(site, payload_size, disposition);
+}
+
+void CommitDeferredRecord()
+{
+	GetDeferredThreadState().Commit();
+}
+
+void FormatDeferredMessageFromSignal(EmergencyLine& line, const DeferredSite& site, const char* const payload)
+{
+	AppendDeferredMessage(line, site, payload);
+}
+
+void FormatDeferredRecord(
+	LogBuffer& buffer,
+	const DeferredSite& site,
+	const char* payload,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context)
+{
+	AppendDeferredRecord(buffer, site, payload, timestamp_ns, thread_tag, context);
+}
+
+} // namespace SimpleLog
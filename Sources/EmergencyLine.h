@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+// Async-signal-safe building blocks of the emergency path (EmergencyLog.cpp) and of
+// the flight recorder's signal dump (FlightRecorder.cpp).
+
+constexpr size_t kMaxEmergencyMessageSize = 1024;
+
+// A line formatted on the stack; what does not fit is cut.
+class EmergencyLine
+{
+public:
+	void Append(const char* const data, const size_t size)
+	{
+		const auto count = std::min(size, sizeof(data_) - size_);
+		std::memcpy(data_ + size_, data, count);
+		size_ += count;
+	}
+
+	void Append(const std::string_view text)
+	{
+		Append(text.data(), text.size());
+	}
+
+	void Append(const char c)
+	{
+		Append(&c, 1);
+	}
+
+	void AppendUnsigned(uint64_t value, const uint32_t base = 10)
+	{
+		char digits[24];
+		auto* const end = digits + sizeof(digits);
+		auto* begin = end;
+		do
+		{
+			*--begin = "0123456789abcdef"[value % base];
+			value /= base;
+		}
+		while (value != 0);
+		Append(begin, static_cast<size_t>(end - begin));
+	}
+
+	void AppendSigned(const int64_t value)
+	{
+		if (value < 0)
+		{
+			Append('-');
+			AppendUnsigned(0 - static_cast<uint64_t>(value));
+			return;
+		}
+		AppendUnsigned(static_cast<uint64_t>(value));
+	}
+
+	const char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+private:
+	// The message, its prefix and the cut marker.
+	char data_[kMaxEmergencyMessageSize + 256];
+	size_t size_ = 0;
+};
+
+inline void WriteAll(const int fd, const char* data, size_t size)
+{
+	while (size != 0)
+	{
+		const auto written = write(fd, data, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,257 @@
+#include "../Headers/EmergencyLog.h"
+#include "../Headers/FlightRecorder.h"
+#include "AsyncBackend.h"
+#include "EmergencyLine.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kMaxEmergencyFds = 4;
+constexpr size_t kAlternateStackSize = 64 << 10;
+
+constexpr int kCrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+constexpr size_t kCrashSignalCount = sizeof(kCrashSignals) / sizeof(kCrashSignals[0]);
+
+std::atomic<int> emergency_fds_[kMaxEmergencyFds] = {-1, -1, -1, -1};
+
+// State of the crash handler. previous_actions_ is written before the handlers are
+// installed and read by them once they are.
+struct sigaction previous_actions_[kCrashSignalCount];
+std::atomic<bool> crash_handler_installed_{false};
+std::atomic<int64_t> crash_flush_timeout_ns_{0};
+// Set by the first crashing thread; the others wait for it to take the process down.
+std::atomic<bool> crashing_{false};
+alignas(16) char alternate_stack_[kAlternateStackSize];
+
+// Returns whether a descriptor was added.
+bool WriteToEmergencyFds(const char* const data, const size_t size)
+{
+	auto written = false;
+	for (auto& emergency_fd : emergency_fds_)
+	{
+		const auto fd = emergency_fd.load(std::memory_order_relaxed);
+		if (fd >= 0)
+		{
+			WriteAll(fd, data, size);
+			written = true;
+		}
+	}
+	return written;
+}
+
+const char* GetSignalName(const int signal_number)
+{
+	switch (signal_number)
+	{
+	case SIGSEGV:
+		return "SIGSEGV";
+	case SIGBUS:
+		return "SIGBUS";
+	case SIGFPE:
+		return "SIGFPE";
+	case SIGILL:
+		return "SIGILL";
+	case SIGABRT:
+		return "SIGABRT";
+	default:
+		return "signal";
+	}
+}
+
+void RestorePreviousActions()
+{
+	for (size_t i = 0; i < kCrashSignalCount; ++i)
+	{
+		sigaction(kCrashSignals[i], &previous_actions_[i], nullptr);
+	}
+}
+
+void HandleCrash(const int signal_number, siginfo_t* const info, void*)
+{
+	const auto errno_value = errno;
+	if (crashing_.exchange(true))
+	{
+		// Another thread is reporting its crash and then ends the process.
+		for (;;)
+		{
+			pause();
+		}
+	}
+
+	EmergencyLine message;
+	message.Append("Fatal signal ");
+	message.AppendUnsigned(static_cast<uint32_t>(signal_number));
+	message.Append(" (");
+	message.Append(std::string_view(GetSignalName(signal_number)));
+	message.Append(')');
+	// Only a fault raised by the kernel has an address; kill() and raise() fill the
+	// same bytes with the sender.
+	if (signal_number != SIGABRT && info != nullptr && info->si_code > 0)
+	{
+		message.Append(" at address 0x");
+		message.AppendUnsigned(reinterpret_cast<uintptr_t>(info->si_addr), 16);
+	}
+	WriteEmergencyLog(LogMessageType::FatalError, nullptr, 0, std::string_view(message.Data(), message.Size()));
+
+	if (IsAsyncLogging() && !FlushAsyncLoggingFromSignal(crash_flush_timeout_ns_.load()))
+	{
+		WriteEmergencyLog(LogMessageType::FatalError, nullptr, 0, "Queued records not flushed before the timeout");
+	}
+
+	auto dumped = false;
+	for (auto& emergency_fd : emergency_fds_)
+	{
+		const auto fd = emergency_fd.load(std::memory_order_relaxed);
+		if (fd >= 0)
+		{
+			DumpFlightRecorderFromSignal(fd);
+			dumped = true;
+		}
+	}
+	if (!dumped)
+	{
+		DumpFlightRecorderFromSignal(STDERR_FILENO);
+	}
+
+	// Delivered with the previous disposition once the handler returns; a fault
+	// happens again on the faulting instruction anyway.
+	RestorePreviousActions();
+	crash_handler_installed_.store(false);
+	raise(signal_number);
+	errno = errno_value;
+}
+
+} // namespace
+
+bool AddEmergencyLogFd(const int fd)
+{
+	for (auto& emergency_fd : emergency_fds_)
+	{
+		auto free = -1;
+		if (emergency_fd.compare_exchange_strong(free, fd))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void RemoveEmergencyLogFds()
+{
+	for (auto& emergency_fd : emergency_fds_)
+	{
+		emergency_fd.store(-1);
+	}
+}
+
+void WriteEmergencyRecord(const std::string_view text)
+{
+	WriteToEmergencyFds(text.data(), text.size());
+}
+
+void WriteEmergencyLog(
+	const LogMessageType message_type,
+	const char* const file_name,
+	const int line,
+	const std::string_view message)
+{
+	EmergencyLine out;
+	const char type_prefix[] = {'[', MessageTypeToChar(message_type), ']'};
+	out.Append(type_prefix, sizeof(type_prefix));
+	const auto log_infos = GetLogInfos();
+	if ((log_infos & static_cast<uint32_t>(LogInfos::TimeStamp)) != 0)
+	{
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		char time_stamp[kMaxTimeStampSize];
+		out.Append('[');
+		out.Append(time_stamp, FormatTimeStamp(time_stamp, now.tv_sec * int64_t{1000000000} + now.tv_nsec));
+		out.Append(']');
+	}
+	if ((log_infos & static_cast<uint32_t>(LogInfos::ThreadId)) != 0)
+	{
+		// The kernel's id: the thread's tag may not be rendered yet.
+		out.Append("[tid ");
+		out.AppendSigned(static_cast<int64_t>(syscall(SYS_gettid)));
+		out.Append(']');
+	}
+	if ((log_infos & static_cast<uint32_t>(LogInfos::FileNameWithLine)) != 0 && file_name != nullptr)
+	{
+		out.Append('[');
+		out.Append(file_name, std::strlen(file_name));
+		out.Append(':');
+		out.AppendSigned(line);
+		out.Append(']');
+	}
+	out.Append("$ ");
+	if (message.size() > kMaxEmergencyMessageSize)
+	{
+		out.Append(message.substr(0, kMaxEmergencyMessageSize));
+		out.Append(" [cut]");
+	}
+	else
+	{
+		out.Append(message);
+	}
+	out.Append('\n');
+
+	if (!WriteToEmergencyFds(out.Data(), out.Size()))
+	{
+		WriteAll(STDERR_FILENO, out.Data(), out.Size());
+	}
+}
+
+void InstallCrashHandler(const std::chrono::milliseconds flush_timeout)
+{
+	crash_flush_timeout_ns_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(flush_timeout).count());
+	if (crash_handler_installed_.exchange(true))
+	{
+		return;
+	}
+
+	// Constructs the backend's singleton here rather than in the handler.
+	IsAsyncLogging();
+
+	stack_t alternate_stack = {};
+	alternate_stack.ss_sp = alternate_stack_;
+	alternate_stack.ss_size = sizeof(alternate_stack_);
+	sigaltstack(&alternate_stack, nullptr);
+
+	struct sigaction action = {};
+	action.sa_sigaction = HandleCrash;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	// A fault in the handler then kills the process instead of entering it again.
+	sigemptyset(&action.sa_mask);
+	for (const auto signal_number : kCrashSignals)
+	{
+		sigaddset(&action.sa_mask, signal_number);
+	}
+	for (size_t i = 0; i < kCrashSignalCount; ++i)
+	{
+		sigaction(kCrashSignals[i], &action, &previous_actions_[i]);
+	}
+}
+
+void UninstallCrashHandler()
+{
+	if (crash_handler_installed_.exchange(false))
+	{
+		RestorePreviousActions();
+	}
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,555 @@
+#include "../Headers/FlightRecorder.h"
+#include "../Headers/DeferredLog.h"
+#include "EmergencyLine.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kMinRingSize = 4 << 10;
+// Rings the signal dump can reach; threads beyond that are only dumped by FatalError.
+constexpr size_t kMaxSignalRings = 256;
+// Attempts at a ring's spinlock before the signal dump skips the ring.
+constexpr size_t kSignalLockAttempts = 1 << 16;
+
+enum class FlightRecordKind : uint32_t
+{
+	Padding,
+	Text,
+	Deferred,
+};
+
+// A Deferred payload starts with context_size bytes of the producer's context.
+struct FlightRecordHeader
+{
+	int64_t timestamp_ns;
+	const DeferredSite* site;
+	uint32_t payload_size;
+	FlightRecordKind kind;
+	uint32_t context_size;
+};
+
+constexpr size_t AlignRecord(const size_t size)
+{
+	return (size + alignof(FlightRecordHeader) - 1) & ~(alignof(FlightRecordHeader) - 1);
+}
+
+size_t RoundRingSize(const size_t size)
+{
+	size_t rounded = kMinRingSize;
+	while (rounded < size)
+	{
+		rounded <<= 1;
+	}
+	return rounded;
+}
+
+// Byte ring of one thread that overwrites its oldest records. Records never wrap: a
+// Padding header (or a tail too short for a header) fills the end of the ring. The
+// owner thread and the dumper serialize through a spinlock that is only contended
+// while a dump runs.
+class FlightRing
+{
+public:
+	FlightRing(const size_t capacity, const std::string_view thread_tag)
+		: thread_tag_(thread_tag)
+	{
+		Resize(capacity);
+	}
+
+	void Resize(const size_t capacity)
+	{
+		Lock();
+		data_.reset(new FlightRecordHeader[(capacity + sizeof(FlightRecordHeader) - 1) / sizeof(FlightRecordHeader)]);
+		capacity_ = capacity;
+		head_ = 0;
+		tail_ = 0;
+		Unlock();
+	}
+
+	void Append(const int64_t timestamp_ns, const DeferredSite* const site, const FlightRecordKind kind,
+		const std::string_view context, const char* const payload, const size_t payload_size)
+	{
+		const auto size = AlignRecord(sizeof(FlightRecordHeader) + context.size() + payload_size);
+		Lock();
+		// Records larger than half the ring would evict everything else.
+		if (size <= capacity_ / 2)
+		{
+			auto* const header = Reserve(size);
+			header->timestamp_ns = timestamp_ns;
+			header->site = site;
+			header->payload_size = static_cast<uint32_t>(context.size() + payload_size);
+			header->kind = kind;
+			header->context_size = static_cast<uint32_t>(context.size());
+			auto* const out = reinterpret_cast<char*>(header + 1);
+			// Empty parts may come with a null pointer, which memcpy must not get.
+			if (!context.empty())
+			{
+				std::memcpy(out, context.data(), context.size());
+			}
+			if (payload_size != 0)
+			{
+				std::memcpy(out + context.size(), payload, payload_size);
+			}
+			head_ += size;
+		}
+		Unlock();
+	}
+
+	// Copies the live records out and empties the ring.
+	std::string Take()
+	{
+		std::string records;
+		Lock();
+		auto position = tail_;
+		while (const auto* const record = Next(position))
+		{
+			records.append(record, RecordSize(record));
+		}
+		tail_ = head_;
+		Unlock();
+		return records;
+	}
+
+	void Clear()
+	{
+		Lock();
+		tail_ = head_;
+		Unlock();
+	}
+
+	// For the signal dump, which must not wait for an owner that may be the crashed
+	// thread itself.
+	bool TryLock()
+	{
+		for (size_t attempt = 0; attempt < kSignalLockAttempts; ++attempt)
+		{
+			if (!locked_.exchange(true, std::memory_order_acquire))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Unlock()
+	{
+		locked_.store(false, std::memory_order_release);
+	}
+
+	// Walks the live records without copying them; called locked. position starts at
+	// Begin() and Next returns null once every record was returned.
+	size_t Begin() const
+	{
+		return tail_;
+	}
+
+	const char* Next(size_t& position)
+	{
+		while (position != head_)
+		{
+			const auto offset = position & (capacity_ - 1);
+			const auto to_end = capacity_ - offset;
+			const auto* const header = Data() + offset;
+			if (to_end < sizeof(FlightRecordHeader) ||
+				reinterpret_cast<const FlightRecordHeader*>(header)->kind == FlightRecordKind::Padding)
+			{
+				position += to_end;
+				continue;
+			}
+			position += RecordSize(header);
+			return header;
+		}
+		return nullptr;
+	}
+
+	std::string_view GetThreadTag() const
+	{
+		return thread_tag_;
+	}
+
+	static size_t RecordSize(const char* const record)
+	{
+		const auto* const header = reinterpret_cast<const FlightRecordHeader*>(record);
+		return AlignRecord(sizeof(FlightRecordHeader) + header->payload_size);
+	}
+
+private:
+	char* Data()
+	{
+		return reinterpret_cast<char*>(data_.get());
+	}
+
+	void Lock()
+	{
+		while (locked_.exchange(true, std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Evicts the oldest records until size bytes fit at the head; called locked.
+	FlightRecordHeader* Reserve(const size_t size)
+	{
+		auto offset = head_ & (capacity_ - 1);
+		const auto to_end = capacity_ - offset;
+		const auto needed = size <= to_end ? size : to_end + size;
+		while (head_ + needed - tail_ > capacity_)
+		{
+			const auto tail_offset = tail_ & (capacity_ - 1);
+			const auto tail_to_end = capacity_ - tail_offset;
+			const auto* const header = Data() + tail_offset;
+			if (tail_to_end < sizeof(FlightRecordHeader) ||
+				reinterpret_cast<const FlightRecordHeader*>(header)->kind == FlightRecordKind::Padding)
+			{
+				tail_ += tail_to_end;
+			}
+			else
+			{
+				tail_ += RecordSize(header);
+			}
+		}
+
+		if (size > to_end)
+		{
+			if (to_end >= sizeof(FlightRecordHeader))
+			{
+				reinterpret_cast<FlightRecordHeader*>(Data() + offset)->kind = FlightRecordKind::Padding;
+			}
+			head_ += to_end;
+			offset = 0;
+		}
+		return reinterpret_cast<FlightRecordHeader*>(Data() + offset);
+	}
+
+	// Captured when the thread first records; see DeferredThreadBuffer.
+	const std::string thread_tag_;
+	std::unique_ptr<FlightRecordHeader[]> data_;
+	size_t capacity_ = 0;
+	size_t head_ = 0;
+	size_t tail_ = 0;
+	std::atomic<bool> locked_{false};
+};
+
+struct FlightRegistry
+{
+	std::mutex mutex;
+	std::vector<FlightRing*> rings;
+	size_t ring_size = 64 << 10;
+	std::ostream* dump_stream = &std::cerr;
+};
+
+// Never destroyed: fatal records may be dumped during static destruction.
+FlightRegistry& GetFlightRegistry()
+{
+	static auto* const registry = new FlightRegistry();
+	return *registry;
+}
+
+// Lock-free copy of the ring list for the signal dump. A ring leaves its slot before it
+// is deleted, and is not deleted while a signal dump runs.
+std::atomic<FlightRing*> signal_rings_[kMaxSignalRings];
+std::atomic<bool> signal_dumping_{false};
+
+// Trivially destructible, so records made while thread_local objects are destroyed
+// find either the live ring or none; the owner unregisters the ring at thread exit.
+thread_local FlightRing* flight_ring_ = nullptr;
+thread_local bool flight_ring_released_ = false;
+
+struct FlightRingOwner
+{
+	~FlightRingOwner()
+	{
+		auto& registry = GetFlightRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.rings.erase(std::find(registry.rings.begin(), registry.rings.end(), flight_ring_));
+		for (auto& slot : signal_rings_)
+		{
+			auto* expected = flight_ring_;
+			if (slot.compare_exchange_strong(expected, nullptr))
+			{
+				break;
+			}
+		}
+		while (signal_dumping_.load())
+		{
+			std::this_thread::yield();
+		}
+		delete flight_ring_;
+		flight_ring_ = nullptr;
+		flight_ring_released_ = true;
+	}
+};
+
+FlightRing* GetFlightRing()
+{
+	if (flight_ring_ == nullptr && !flight_ring_released_)
+	{
+		thread_local FlightRingOwner owner;
+		auto& registry = GetFlightRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		flight_ring_ = new FlightRing(registry.ring_size, GetThreadTag());
+		registry.rings.push_back(flight_ring_);
+		for (auto& slot : signal_rings_)
+		{
+			FlightRing* expected = nullptr;
+			if (slot.compare_exchange_strong(expected, flight_ring_))
+			{
+				break;
+			}
+		}
+	}
+	return flight_ring_;
+}
+
+struct FlightEntry
+{
+	int64_t timestamp_ns;
+	const char* record;
+	const FlightRing* ring;
+};
+
+// Renders a deferred record as PrintInfos and FormatDeferredRecord would.
+void WriteDeferredFromSignal(const int fd, const FlightRecordHeader& header, const std::string_view thread_tag)
+{
+	const auto& site = *header.site;
+	const auto* const payload = reinterpret_cast<const char*>(&header + 1);
+	EmergencyLine line;
+	const char type_prefix[] = {'[', MessageTypeToChar(site.call_site->GetMessageType()), ']'};
+	line.Append(type_prefix, sizeof(type_prefix));
+	const auto log_infos = GetLogInfos();
+	if ((log_infos & static_cast<uint32_t>(LogInfos::TimeStamp)) != 0)
+	{
+		char time_stamp[kMaxTimeStampSize];
+		line.Append('[');
+		line.Append(time_stamp, FormatTimeStamp(time_stamp, header.timestamp_ns));
+		line.Append(']');
+	}
+	if ((log_infos & static_cast<uint32_t>(LogInfos::ThreadId)) != 0)
+	{
+		line.Append(thread_tag);
+	}
+	if (header.context_size != 0)
+	{
+		line.Append('[');
+		line.Append(payload, header.context_size);
+		line.Append(']');
+	}
+	if ((log_infos & static_cast<uint32_t>(LogInfos::FileNameWithLine)) != 0)
+	{
+		line.Append('[');
+		line.Append(site.call_site->GetFileNameWithLine());
+	}
+	line.Append("$ ", 2);
+	FormatDeferredMessageFromSignal(line, site, payload + header.context_size);
+	line.Append('\n');
+	WriteAll(fd, line.Data(), line.Size());
+}
+
+} // namespace
+
+void EnableFlightRecorder(const size_t bytes_per_thread, std::ostream& dump_stream)
+{
+	auto& registry = GetFlightRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.ring_size = RoundRingSize(bytes_per_thread);
+	registry.dump_stream = &dump_stream;
+	for (auto* const ring : registry.rings)
+	{
+		ring->Resize(registry.ring_size);
+	}
+	SetLogConfigFlag(LogConfig::kFlightRecorder, true);
+}
+
+void DisableFlightRecorder()
+{
+	auto& registry = GetFlightRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	SetLogConfigFlag(LogConfig::kFlightRecorder, false);
+	for (auto* const ring : registry.rings)
+	{
+		ring->Clear();
+	}
+}
+
+bool IsFlightRecorderEnabled()
+{
+	return (detail::log_config.word.load(std::memory_order_relaxed) & LogConfig::kFlightRecorder) != 0;
+}
+
+void RecordFlightText(const int64_t timestamp_ns, const std::string_view text)
+{
+	if (auto* const ring = GetFlightRing())
+	{
+		ring->Append(timestamp_ns, nullptr, FlightRecordKind::Text, std::string_view(), text.data(), text.size());
+	}
+}
+
+void RecordFlightDeferred(
+	const DeferredSite& site,
+	const int64_t timestamp_ns,
+	const std::string_view context,
+	const char* const payload,
+	const size_t payload_size)
+{
+	if (auto* const ring = GetFlightRing())
+	{
+		ring->Append(timestamp_ns, &site, FlightRecordKind::Deferred, context, payload, payload_size);
+	}
+}
+
+size_t DumpFlightRecorder()
+{
+	if (!IsFlightRecorderEnabled())
+	{
+		return 0;
+	}
+
+	auto& registry = GetFlightRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	std::vector<std::string> snapshots;
+	snapshots.reserve(registry.rings.size());
+	std::vector<FlightEntry> entries;
+	for (auto* const ring : registry.rings)
+	{
+		snapshots.push_back(ring->Take());
+		const auto& records = snapshots.back();
+		for (size_t offset = 0; offset < records.size(); offset += FlightRing::RecordSize(records.data() + offset))
+		{
+			const auto* const header = reinterpret_cast<const FlightRecordHeader*>(records.data() + offset);
+			entries.push_back(FlightEntry{header->timestamp_ns, records.data() + offset, ring});
+		}
+	}
+	// Records of one thread are already in order; stable keeps them so on equal times.
+	std::stable_sort(entries.begin(), entries.end(), [](const FlightEntry& left, const FlightEntry& right)
+	{
+		return left.timestamp_ns < right.timestamp_ns;
+	});
+
+	LogBuffer buffer;
+	buffer.Append("[flight recorder: ", 18);
+	AppendInteger(buffer, entries.size());
+	buffer.Append(" records]\n", 10);
+	for (const auto& entry : entries)
+	{
+		const auto& header = *reinterpret_cast<const FlightRecordHeader*>(entry.record);
+		const auto* const payload = entry.record + sizeof(FlightRecordHeader);
+		if (header.kind == FlightRecordKind::Text)
+		{
+			buffer.Append(payload, header.payload_size);
+		}
+		else
+		{
+			FormatDeferredRecord(buffer, *header.site, payload + header.context_size, header.timestamp_ns,
+				entry.ring->GetThreadTag(), std::string_view(payload, header.context_size));
+		}
+	}
+	buffer.Append("[flight recorder end]\n", 22);
+
+	auto& stream = *registry.dump_stream;
+	stream.write(buffer.Data(), static_cast<std::streamsize>(buffer.Size()));
+	stream.flush();
+	return entries.size();
+}
+
+size_t DumpFlightRecorderFromSignal(const int fd)
+{
+	if (!IsFlightRecorderEnabled())
+	{
+		return 0;
+	}
+
+	signal_dumping_.store(true);
+	FlightRing* rings[kMaxSignalRings];
+	size_t positions[kMaxSignalRings];
+	size_t ring_count = 0;
+	size_t busy = 0;
+	size_t records = 0;
+	for (auto& slot : signal_rings_)
+	{
+		auto* const ring = slot.load();
+		if (ring == nullptr)
+		{
+			continue;
+		}
+		if (!ring->TryLock())
+		{
+			++busy;
+			continue;
+		}
+		rings[ring_count] = ring;
+		positions[ring_count] = ring->Begin();
+		for (auto position = ring->Begin(); ring->Next(position) != nullptr;)
+		{
+			++records;
+		}
+		++ring_count;
+	}
+
+	EmergencyLine line;
+	line.Append("[flight recorder: ", 18);
+	line.AppendUnsigned(records);
+	line.Append(" records");
+	if (busy != 0)
+	{
+		line.Append(", ", 2);
+		line.AppendUnsigned(busy);
+		line.Append(" busy threads skipped");
+	}
+	line.Append("]\n", 2);
+	WriteAll(fd, line.Data(), line.Size());
+
+	// Merged by timestamp; on equal times the earlier ring goes first, like the
+	// stable sort of DumpFlightRecorder.
+	for (;;)
+	{
+		size_t oldest = ring_count;
+		const FlightRecordHeader* oldest_header = nullptr;
+		for (size_t i = 0; i < ring_count; ++i)
+		{
+			auto position = positions[i];
+			const auto* const record = rings[i]->Next(position);
+			const auto* const header = reinterpret_cast<const FlightRecordHeader*>(record);
+			if (header != nullptr && (oldest_header == nullptr || header->timestamp_ns < oldest_header->timestamp_ns))
+			{
+				oldest = i;
+				oldest_header = header;
+			}
+		}
+		if (oldest_header == nullptr)
+		{
+			break;
+		}
+		rings[oldest]->Next(positions[oldest]);
+		if (oldest_header->kind == FlightRecordKind::Text)
+		{
+			WriteAll(fd, reinterpret_cast<const char*>(oldest_header + 1), oldest_header->payload_size);
+		}
+		else
+		{
+			WriteDeferredFromSignal(fd, *oldest_header, rings[oldest]->GetThreadTag());
+		}
+	}
+	WriteAll(fd, "[flight recorder end]\n", 22);
+
+	for (size_t i = 0; i < ring_count; ++i)
+	{
+		rings[i]->Unlock();
+	}
+	signal_dumping_.store(false);
+	return records;
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,90 @@
+#include "../Headers/LogContext.h"
+#include "LoggerPrivate.h"
+
+#include <string>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+// The context outlives the thread's other thread_locals: records logged from their
+// destructors still read it, and find it empty once released.
+thread_local std::string* thread_context_ = nullptr;
+thread_local bool thread_context_released_ = false;
+
+struct ThreadContextOwner
+{
+	~ThreadContextOwner()
+	{
+		delete thread_context_;
+		thread_context_ = nullptr;
+		thread_context_released_ = true;
+	}
+};
+
+std::string* GetThreadContext()
+{
+	if (thread_context_ == nullptr && !thread_context_released_)
+	{
+		thread_local ThreadContextOwner owner;
+		thread_context_ = new std::string();
+	}
+	return thread_context_;
+}
+
+} // namespace
+
+std::string_view GetLogContext()
+{
+	return thread_context_ == nullptr ? std::string_view() : std::string_view(*thread_context_);
+}
+
+LogContext CaptureLogContext()
+{
+	LogContext context;
+	context.text_ = GetLogContext();
+	return context;
+}
+
+size_t ScopedContext::Push(const std::string_view pair)
+{
+	auto* const context = GetThreadContext();
+	if (context == nullptr)
+	{
+		return 0;
+	}
+	const auto size = context->size();
+	// The first pair goes without its leading space.
+	context->append(pair.data() + (size == 0 ? 1 : 0), pair.size() - (size == 0 ? 1 : 0));
+	return size;
+}
+
+ScopedContext::ScopedContext(const LogContext& context)
+{
+	if (auto* const current = GetThreadContext())
+	{
+		previous_ = *current;
+		*current = context.text_;
+	}
+}
+
+ScopedContext::~ScopedContext()
+{
+	auto* const context = thread_context_;
+	if (context == nullptr)
+	{
+		return;
+	}
+	if (previous_size_ == std::string::npos)
+	{
+		context->swap(previous_);
+	}
+	else
+	{
+		context->resize(previous_size_);
+	}
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,346 @@
+#include "../Headers/LogSink.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+enum : uint8_t
+{
+	// Escaped inside a JSON (or quoted logfmt) string.
+	kEscape = 0x1,
+	// Forces quoting of a logfmt value.
+	kQuote = 0x2,
+};
+
+constexpr std::array<uint8_t, 256> MakeCharacterClasses()
+{
+	std::array<uint8_t, 256> classes{};
+	for (size_t c = 0; c < 0x20; ++c)
+	{
+		classes[c] = kEscape | kQuote;
+	}
+	classes['"'] = kEscape | kQuote;
+	classes['\\'] = kEscape | kQuote;
+	classes[' '] = kQuote;
+	classes['='] = kQuote;
+	return classes;
+}
+
+constexpr auto kCharacterClasses = MakeCharacterClasses();
+
+uint8_t GetCharacterClass(const char c)
+{
+	return kCharacterClasses[static_cast<unsigned char>(c)];
+}
+
+// Writes the escape sequence of c to escape; returns its size.
+size_t FormatEscape(const char c, char* const escape)
+{
+	escape[0] = '\\';
+	switch (c)
+	{
+	case '"':
+	case '\\':
+		escape[1] = c;
+		return 2;
+	case '\n':
+		escape[1] = 'n';
+		return 2;
+	case '\r':
+		escape[1] = 'r';
+		return 2;
+	case '\t':
+		escape[1] = 't';
+		return 2;
+	default:
+	{
+		constexpr char kHex[] = "0123456789abcdef";
+		escape[1] = 'u';
+		escape[2] = '0';
+		escape[3] = '0';
+		escape[4] = kHex[(c >> 4) & 0xf];
+		escape[5] = kHex[c & 0xf];
+		return 6;
+	}
+	}
+}
+
+void AppendEscape(LogBuffer& out, const char c)
+{
+	char escape[6];
+	out.Append(escape, FormatEscape(c, escape));
+}
+
+// Copies runs of plain bytes in one Append; only bytes that need escaping branch off.
+void AppendQuoted(LogBuffer& out, const std::string_view text)
+{
+	out.Append('"');
+	const char* run = text.data();
+	const char* const end = text.data() + text.size();
+	for (const char* it = run; it != end; ++it)
+	{
+		if ((GetCharacterClass(*it) & kEscape) != 0)
+		{
+			out.Append(run, static_cast<size_t>(it - run));
+			AppendEscape(out, *it);
+			run = it + 1;
+		}
+	}
+	out.Append(run, static_cast<size_t>(end - run));
+	out.Append('"');
+}
+
+bool NeedsLogfmtQuotes(const std::string_view text)
+{
+	// No early exit: or-ing the classes of the whole value keeps the scan branch free.
+	uint8_t classes = 0;
+	for (const auto c : text)
+	{
+		classes |= GetCharacterClass(c);
+	}
+	return text.empty() || (classes & kQuote) != 0;
+}
+
+void AppendLogfmtValue(LogBuffer& out, const std::string_view text)
+{
+	if (NeedsLogfmtQuotes(text))
+	{
+		AppendQuoted(out, text);
+	}
+	else
+	{
+		out.Append(text.data(), text.size());
+	}
+}
+
+// Numbers and bools are the only unquoted field values starting so (see
+// LogRecord::fields); to_chars writes non-finite doubles as "inf", "-inf" and "nan".
+bool IsLogfmtLiteral(const std::string_view text)
+{
+	const auto first = text.front();
+	return (first >= '0' && first <= '9') || first == '-' || first == '+' || first == '.' ||
+		text == "true" || text == "false" || text == "nan" || text == "inf";
+}
+
+// Copies the logfmt fields as JSON members: quoted values are JSON strings already,
+// literals stay numbers or bools, non-finite doubles become null.
+void AppendJsonFields(LogBuffer& out, const std::string_view fields)
+{
+	size_t position = 0;
+	while (position < fields.size())
+	{
+		// " key=value"
+		const auto key_begin = position + 1;
+		const auto key_end = fields.find('=', key_begin);
+		out.Append(",\"", 2);
+		out.Append(fields.data() + key_begin, key_end - key_begin);
+		out.Append("\":", 2);
+		auto value_end = key_end + 1;
+		if (value_end < fields.size() && fields[value_end] == '"')
+		{
+			for (++value_end; fields[value_end] != '"'; ++value_end)
+			{
+				value_end += fields[value_end] == '\\' ? 1 : 0;
+			}
+			++value_end;
+			out.Append(fields.data() + key_end + 1, value_end - key_end - 1);
+		}
+		else
+		{
+			value_end = std::min(fields.find(' ', value_end), fields.size());
+			const auto value = fields.substr(key_end + 1, value_end - key_end - 1);
+			if (!IsLogfmtLiteral(value))
+			{
+				AppendQuoted(out, value);
+			}
+			else if (value.find_first_of("in") != std::string_view::npos)
+			{
+				out.Append("null", 4);
+			}
+			else
+			{
+				out.Append(value.data(), value.size());
+			}
+		}
+		position = value_end;
+	}
+}
+
+std::string_view GetLevelName(const LogMessageType message_type)
+{
+	switch (message_type)
+	{
+	case LogMessageType::Error:
+		return "error";
+	case LogMessageType::Warning:
+		return "warning";
+	case LogMessageType::Info:
+		return "info";
+	case LogMessageType::FatalError:
+		return "fatal";
+	}
+	return "unknown";
+}
+
+// "[3:name]" -> "3:name"
+std::string_view StripBrackets(const std::string_view thread_tag)
+{
+	return thread_tag.size() >= 2 ? thread_tag.substr(1, thread_tag.size() - 2) : thread_tag;
+}
+
+bool HasInfo(const uint32_t log_infos, const LogInfos info)
+{
+	return (log_infos & static_cast<uint32_t>(info)) != 0;
+}
+
+} // namespace
+
+void AppendOddLogfmtKey(LogBuffer& out, const std::string_view key)
+{
+	if (key.empty())
+	{
+		out.Append('_');
+		return;
+	}
+	for (const auto c : key)
+	{
+		out.Append(IsPlainKeyCharacter(c) ? c : '_');
+	}
+}
+
+void AppendLogfmtText(LogBuffer& out, const std::string_view text)
+{
+	if (NeedsLogfmtQuotes(text) || IsLogfmtLiteral(text))
+	{
+		AppendQuoted(out, text);
+	}
+	else
+	{
+		out.Append(text.data(), text.size());
+	}
+}
+
+void QuoteLogfmtText(LogBuffer& out, const size_t begin)
+{
+	const auto size = out.Size() - begin;
+	const std::string_view text(out.Data() + begin, size);
+	if (!NeedsLogfmtQuotes(text) && !IsLogfmtLiteral(text))
+	{
+		return;
+	}
+	size_t quoted_size = size + 2;
+	char escape[6];
+	for (const auto c : text)
+	{
+		if ((GetCharacterClass(c) & kEscape) != 0)
+		{
+			quoted_size += FormatEscape(c, escape) - 1;
+		}
+	}
+	// Quoted in place, back to front: the text only moves right.
+	for (auto grow = quoted_size - size; grow != 0; --grow)
+	{
+		out.Append('"');
+	}
+	auto* const data = out.Data() + begin;
+	auto* write = data + quoted_size - 1;
+	for (auto read = data + size; read != data;)
+	{
+		const auto c = *--read;
+		if ((GetCharacterClass(c) & kEscape) != 0)
+		{
+			const auto escape_size = FormatEscape(c, escape);
+			write -= escape_size;
+			std::memcpy(write, escape, escape_size);
+		}
+		else
+		{
+			*--write = c;
+		}
+	}
+	data[0] = '"';
+}
+
+JsonFormatter::JsonFormatter(const uint32_t log_infos)
+	: log_infos_(log_infos)
+{}
+
+void JsonFormatter::Format(const LogRecord& record, LogBuffer& out) const
+{
+	const auto level = GetLevelName(record.message_type);
+	out.Append("{\"level\":\"", 10);
+	out.Append(level.data(), level.size());
+	out.Append('"');
+	if (HasInfo(log_infos_, LogInfos::TimeStamp))
+	{
+		out.Append(",\"ts\":", 6);
+		AppendInteger(out, record.timestamp_ns);
+	}
+	if (HasInfo(log_infos_, LogInfos::ThreadId))
+	{
+		out.Append(",\"thread\":", 10);
+		AppendQuoted(out, StripBrackets(record.thread_tag));
+	}
+	if (HasInfo(log_infos_, LogInfos::FileNameWithLine))
+	{
+		out.Append(",\"file\":", 8);
+		AppendQuoted(out, record.file_name);
+		out.Append(",\"line\":", 8);
+		AppendInteger(out, record.line);
+	}
+	if (!record.context.empty())
+	{
+		out.Append(",\"ctx\":", 7);
+		AppendQuoted(out, record.context);
+	}
+	out.Append(",\"msg\":", 7);
+	AppendQuoted(out, record.message);
+	AppendJsonFields(out, record.fields);
+	out.Append("}\n", 2);
+}
+
+LogfmtFormatter::LogfmtFormatter(const uint32_t log_infos)
+	: log_infos_(log_infos)
+{}
+
+void LogfmtFormatter::Format(const LogRecord& record, LogBuffer& out) const
+{
+	const auto level = GetLevelName(record.message_type);
+	out.Append("level=", 6);
+	out.Append(level.data(), level.size());
+	if (HasInfo(log_infos_, LogInfos::TimeStamp))
+	{
+		out.Append(" ts=", 4);
+		AppendInteger(out, record.timestamp_ns);
+	}
+	if (HasInfo(log_infos_, LogInfos::ThreadId))
+	{
+		out.Append(" thread=", 8);
+		AppendLogfmtValue(out, StripBrackets(record.thread_tag));
+	}
+	if (HasInfo(log_infos_, LogInfos::FileNameWithLine))
+	{
+		out.Append(" file=", 6);
+		AppendLogfmtValue(out, record.file_name);
+		out.Append(" line=", 6);
+		AppendInteger(out, record.line);
+	}
+	if (!record.context.empty())
+	{
+		out.Append(' ');
+		out.Append(record.context.data(), record.context.size());
+	}
+	out.Append(" msg=", 5);
+	AppendLogfmtValue(out, record.message);
+	out.Append(record.fields.data(), record.fields.size());
+	out.Append('\n');
+}
+
+} // namespace SimpleLog
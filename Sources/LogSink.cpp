@@ -0,0 +1,412 @@
+#include "../Headers/LogSink.h"
+#include "../Headers/LoggerStats.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr uint32_t kLogStreamTypes =
+	static_cast<uint32_t>(LogMessageType::Warning) |
+	static_cast<uint32_t>(LogMessageType::Info);
+constexpr uint32_t kELogStreamTypes =
+	static_cast<uint32_t>(LogMessageType::Error) |
+	static_cast<uint32_t>(LogMessageType::FatalError);
+
+struct SinkList
+{
+	std::vector<std::shared_ptr<LogSink>> sinks;
+	// The sinks behind SetLogStream/SetELogStream, also present in sinks.
+	std::shared_ptr<StreamSink> log_sink;
+	std::shared_ptr<StreamSink> elog_sink;
+};
+
+// Read-copy-update publication of the sink list. A reader announces itself on the
+// counter of the current epoch and uses whatever list is current; a writer publishes
+// a new list, flips the epoch and waits until the counter of the previous epoch
+// drains before freeing the old list. Readers never block; writers are serialized.
+class SinkRegistry
+{
+public:
+	SinkRegistry()
+	{
+		auto* const list = new SinkList();
+		list->log_sink = std::make_shared<StreamSink>(std::cout, kLogStreamTypes);
+		list->elog_sink = std::make_shared<StreamSink>(std::cerr, kELogStreamTypes);
+		list->sinks = {list->log_sink, list->elog_sink};
+		current_.store(list);
+	}
+
+	template <typename F>
+	void Read(const F& read)
+	{
+		const auto epoch = Enter();
+		read(*current_.load());
+		readers_[epoch].count.fetch_sub(1, std::memory_order_release);
+	}
+
+	template <typename F>
+	void Update(const F& modify)
+	{
+		std::lock_guard<std::mutex> lock(writer_mutex_);
+		auto next = std::make_unique<SinkList>(*current_.load());
+		modify(*next);
+		std::unique_ptr<SinkList> previous(current_.exchange(next.release()));
+		Synchronize();
+	}
+
+	std::ostream& GetLogStream() const
+	{
+		return *log_stream_.load();
+	}
+
+	std::ostream& GetELogStream() const
+	{
+		return *elog_stream_.load();
+	}
+
+	void SetLogStream(std::ostream& stream)
+	{
+		Update([&stream](SinkList& list)
+		{
+			auto sink = std::make_shared<StreamSink>(stream, list.log_sink->GetMessageTypes());
+			std::replace(list.sinks.begin(), list.sinks.end(), std::shared_ptr<LogSink>(list.log_sink), std::shared_ptr<LogSink>(sink));
+			list.log_sink = std::move(sink);
+		});
+		log_stream_.store(&stream);
+	}
+
+	void SetELogStream(std::ostream& stream)
+	{
+		Update([&stream](SinkList& list)
+		{
+			auto sink = std::make_shared<StreamSink>(stream, list.elog_sink->GetMessageTypes());
+			std::replace(list.sinks.begin(), list.sinks.end(), std::shared_ptr<LogSink>(list.elog_sink), std::shared_ptr<LogSink>(sink));
+			list.elog_sink = std::move(sink);
+		});
+		elog_stream_.store(&stream);
+	}
+
+private:
+	struct alignas(64) ReaderCount
+	{
+		std::atomic<uint64_t> count{0};
+	};
+
+	size_t Enter()
+	{
+		for (;;)
+		{
+			const auto epoch = epoch_.load();
+			readers_[epoch].count.fetch_add(1);
+			// A reader counted under a stale epoch could miss the writer's wait.
+			if (epoch_.load() == epoch)
+			{
+				return epoch;
+			}
+			readers_[epoch].count.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	void Synchronize()
+	{
+		const auto previous = epoch_.load();
+		epoch_.store(previous ^ 1);
+		while (readers_[previous].count.load() != 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::atomic<SinkList*> current_{nullptr};
+	alignas(64) std::atomic<size_t> epoch_{0};
+	ReaderCount readers_[2];
+
+	std::mutex writer_mutex_;
+	std::atomic<std::ostream*> log_stream_{&std::cout};
+	std::atomic<std::ostream*> elog_stream_{&std::cerr};
+};
+
+// Never destroyed: records may be written during static destruction.
+SinkRegistry& GetSinkRegistry()
+{
+	static auto* const registry = new SinkRegistry();
+	return *registry;
+}
+
+// Formatter output goes to a buffer of its own since the record text usually lives in
+// the thread's message buffer. The pointer stays valid while thread_local objects are
+// destroyed; once the owner is gone, callers fall back to a local buffer.
+thread_local LogBuffer* formatter_buffer_ = nullptr;
+thread_local bool formatter_buffer_released_ = false;
+
+struct FormatterBufferOwner
+{
+	~FormatterBufferOwner()
+	{
+		delete formatter_buffer_;
+		formatter_buffer_ = nullptr;
+		formatter_buffer_released_ = true;
+	}
+};
+
+LogBuffer* GetFormatterBuffer()
+{
+	if (formatter_buffer_ == nullptr && !formatter_buffer_released_)
+	{
+		thread_local FormatterBufferOwner owner;
+		formatter_buffer_ = new LogBuffer();
+	}
+	return formatter_buffer_;
+}
+
+} // namespace
+
+LogInfosFormatter::LogInfosFormatter(const uint32_t log_infos)
+	: log_infos_(log_infos)
+{}
+
+void LogInfosFormatter::Format(const LogRecord& record, LogBuffer& out) const
+{
+	PrintInfos(out, log_infos_, record);
+	out.Append("$ ", 2);
+	out.Append(record.message.data(), record.message.size());
+	out.Append(record.fields.data(), record.fields.size());
+	out.Append('\n');
+}
+
+LogSink::LogSink(const uint32_t message_types, std::shared_ptr<const LogFormatter> formatter)
+	: message_types_(message_types)
+	, formatter_(std::move(formatter))
+{}
+
+uint32_t LogSink::GetMessageTypes() const
+{
+	return message_types_.load(std::memory_order_relaxed);
+}
+
+void LogSink::SetMessageTypes(const uint32_t message_types)
+{
+	message_types_.store(message_types, std::memory_order_relaxed);
+}
+
+const LogFormatter* LogSink::GetFormatter() const
+{
+	return formatter_.get();
+}
+
+void LogSink::Flush()
+{}
+
+uint64_t LogSink::GetWrittenRecords() const
+{
+	return counters_.records.load(std::memory_order_relaxed);
+}
+
+uint64_t LogSink::GetWrittenBytes() const
+{
+	return counters_.bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t LogSink::GetWriteTime() const
+{
+	return counters_.write_ns.load(std::memory_order_relaxed);
+}
+
+void LogSink::WriteCounted(const LogRecord& record, const std::string_view text)
+{
+	if (IsLoggerTimingEnabled())
+	{
+		const auto begin_ns = GetCurrentTimeStamp();
+		Write(record, text);
+		const auto elapsed_ns = GetCurrentTimeStamp() - begin_ns;
+		counters_.write_ns.fetch_add(static_cast<uint64_t>(std::max<int64_t>(elapsed_ns, 0)), std::memory_order_relaxed);
+	}
+	else
+	{
+		Write(record, text);
+	}
+	counters_.records.fetch_add(1, std::memory_order_relaxed);
+	counters_.bytes.fetch_add(text.size(), std::memory_order_relaxed);
+}
+
+void LogSink::WriteFormatted(const LogRecord& record, LogBuffer& buffer)
+{
+	const auto begin = buffer.Size();
+	formatter_->Format(record, buffer);
+	WriteCounted(record, std::string_view(buffer.Data() + begin, buffer.Size() - begin));
+	buffer.Truncate(begin);
+}
+
+StreamSink::StreamSink(
+	std::ostream& stream,
+	const uint32_t message_types,
+	std::shared_ptr<const LogFormatter> formatter)
+	: LogSink(message_types, std::move(formatter))
+	, stream_(stream)
+{}
+
+std::ostream& StreamSink::GetStream() const
+{
+	return stream_;
+}
+
+void StreamSink::Write(const LogRecord&, const std::string_view text)
+{
+	stream_.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void StreamSink::Flush()
+{
+	stream_.flush();
+}
+
+FileSink::FileSink(
+	const std::string& path,
+	const uint32_t message_types,
+	std::shared_ptr<const LogFormatter> formatter,
+	const BatchedFileOptions& options)
+	: LogSink(message_types, std::move(formatter))
+	, stream_(path, options)
+{}
+
+bool FileSink::IsOpen() const
+{
+	return stream_.IsOpen();
+}
+
+void FileSink::Write(const LogRecord&, const std::string_view text)
+{
+	stream_.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void FileSink::Flush()
+{
+	stream_.flush();
+}
+
+MemorySink::MemorySink(
+	const size_t capacity,
+	const uint32_t message_types,
+	std::shared_ptr<const LogFormatter> formatter)
+	: LogSink(message_types, std::move(formatter))
+	, capacity_(capacity)
+{}
+
+std::vector<std::string> MemorySink::GetLines() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return std::vector<std::string>(lines_.cbegin(), lines_.cend());
+}
+
+void MemorySink::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	lines_.clear();
+}
+
+void MemorySink::Write(const LogRecord&, const std::string_view text)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (capacity_ == 0)
+	{
+		return;
+	}
+	if (lines_.size() == capacity_)
+	{
+		lines_.pop_front();
+	}
+	lines_.emplace_back(text);
+}
+
+void AddLogSink(std::shared_ptr<LogSink> sink)
+{
+	GetSinkRegistry().Update([&sink](SinkList& list)
+	{
+		list.sinks.push_back(std::move(sink));
+	});
+}
+
+void RemoveLogSink(const std::shared_ptr<LogSink>& sink)
+{
+	GetSinkRegistry().Update([&sink](SinkList& list)
+	{
+		list.sinks.erase(std::remove(list.sinks.begin(), list.sinks.end(), sink), list.sinks.end());
+	});
+}
+
+std::vector<std::shared_ptr<LogSink>> GetLogSinks()
+{
+	std::vector<std::shared_ptr<LogSink>> sinks;
+	GetSinkRegistry().Read([&sinks](const SinkList& list)
+	{
+		sinks = list.sinks;
+	});
+	return sinks;
+}
+
+void FlushLogSinks()
+{
+	GetSinkRegistry().Read([](const SinkList& list)
+	{
+		for (const auto& sink : list.sinks)
+		{
+			sink->Flush();
+		}
+	});
+}
+
+void DispatchLogRecord(const LogRecord& record)
+{
+	const auto type = static_cast<uint32_t>(record.message_type);
+	GetSinkRegistry().Read([&record, type](const SinkList& list)
+	{
+		for (const auto& sink : list.sinks)
+		{
+			if ((sink->GetMessageTypes() & type) == 0)
+			{
+				continue;
+			}
+			if (sink->GetFormatter() == nullptr)
+			{
+				sink->WriteCounted(record, record.text);
+			}
+			else if (auto* const buffer = GetFormatterBuffer())
+			{
+				sink->WriteFormatted(record, *buffer);
+			}
+			else
+			{
+				LogBuffer local_buffer;
+				sink->WriteFormatted(record, local_buffer);
+			}
+		}
+	});
+}
+
+std::ostream& GetLogStream()
+{
+	return GetSinkRegistry().GetLogStream();
+}
+
+void SetLogStream(std::ostream& stream)
+{
+	GetSinkRegistry().SetLogStream(stream);
+}
+
+std::ostream& GetELogStream()
+{
+	return GetSinkRegistry().GetELogStream();
+}
+
+void SetELogStream(std::ostream& stream)
+{
+	GetSinkRegistry().SetELogStream(stream);
+}
+
+} // namespace SimpleLog
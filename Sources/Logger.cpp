@@ -1,103 +1,196 @@
 #include "../Headers/Logger.h"
+#include "../Headers/FlightRecorder.h"
+#include "../Headers/LogContext.h"
+#include "../Headers/LoggerStats.h"
+#include "AsyncBackend.h"
+#include "LoggerPrivate.h"
 
-#include <map>
-#include <thread>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 
 namespace SimpleLog
 {
 
 namespace
 {
-#ifndef NDEBUG
-std::atomic<LogType> log_type_(LogType::Debug);
-#else
-std::atomic<LogType> log_type_(LogType::Release);
-#endif
-
 std::atomic<uint32_t> log_infos_(
 	static_cast<uint32_t>(LogInfos::ThreadId) |
 	static_cast<uint32_t>(LogInfos::FileNameWithLine) |
 	static_cast<uint32_t>(LogInfos::TimeStamp));
 
-std::atomic<uint32_t> log_message_types_(
-	static_cast<uint32_t>(LogMessageType::Error) |
-	static_cast<uint32_t>(LogMessageType::Info) |
-	static_cast<uint32_t>(LogMessageType::Warning) |
-	static_cast<uint32_t>(LogMessageType::FatalError));
+// Flag bits of the config word, kept by SetLogType and SetLogMessageTypes.
+constexpr uint32_t kLogConfigFlags =
+	LogConfig::kFlightRecorder | LogConfig::kCountSuppressed | LogConfig::kVModule;
+
+constexpr uint32_t MakeLogConfig(const LogType log_type, const uint32_t log_message_types, const uint32_t flags)
+{
+	const auto message_types = log_message_types & LogConfig::kMessageTypes;
+	auto word = message_types | (flags & kLogConfigFlags);
+	if (log_type == LogType::Debug)
+	{
+		word |= (message_types << LogConfig::kDebugTypesShift) | LogConfig::kDebug;
+		if ((flags & LogConfig::kVModule) != 0)
+		{
+			word |= LogConfig::kDebugVModule;
+		}
+	}
+	return word;
+}
+
+// Serializes the setters, which each rewrite part of the config word.
+std::mutex log_config_mutex_;
 
-std::atomic<std::ostream*> log_stream_(&std::cout);
-std::atomic<std::ostream*> elog_stream_(&std::cerr);
+} // namespace
 
-void GetTimeStamp(char buffer[64])
+char MessageTypeToChar(const LogMessageType message_type)
 {
-	const auto now = std::time(nullptr);
-	struct std::tm* ptmgm = gmtime(&now); // GMT
-	std::strftime(buffer, 64, "%d-%m-%Y(%H:%M:%S)", ptmgm);
+	switch (message_type)
+	{
+	case LogMessageType::Warning:
+		return 'W';
+	case LogMessageType::Error:
+		return 'E';
+	case LogMessageType::FatalError:
+		return 'F';
+	case LogMessageType::Info:
+	default:
+		return 'I';
+	}
 }
 
-std::string MessageTypeToString(const LogMessageType message_type)
+LogConfig detail::log_config{
+	MakeLogConfig(
+#ifndef NDEBUG
+		LogType::Debug,
+#else
+		LogType::Release,
+#endif
+		kAllLogMessageTypes,
+		0),
+	1};
+
+namespace
 {
-	static const std::map<LogMessageType, std::string> type_to_string = {
-		{LogMessageType::Info,        "I"},
-		{LogMessageType::Warning,     "W"},
-		{LogMessageType::Error,       "E"},
-		{LogMessageType::FatalError,  "F"}
-	};
-	const auto it = type_to_string.find(message_type);
-	return it != type_to_string.cend() ? it->second : "I";
+
+void AppendContext(LogBuffer& buffer, const std::string_view context)
+{
+	if (!context.empty())
+	{
+		buffer.Append('[');
+		buffer.Append(context.data(), context.size());
+		buffer.Append(']');
+	}
 }
 
-void PrintInfos(
-	std::stringstream& ss,
+// Appends everything up to the source location; returns the enabled LogInfos.
+uint32_t PrintInfosBeforeLocation(
+	LogBuffer& buffer,
+	const uint32_t type,
 	const LogMessageType message_type,
-	const char* const file_name,
-	const int line)
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context)
 {
-	const auto type = GetLogInfos();
-	ss << "[" << MessageTypeToString(message_type) << "]";
+	const char type_prefix[] = {'[', MessageTypeToChar(message_type), ']'};
+	buffer.Append(type_prefix, sizeof(type_prefix));
 	if (type == 0)
 	{
-		return;
+		AppendContext(buffer, context);
+		return type;
 	}
 
 	if ((type & static_cast<uint32_t>(LogInfos::TimeStamp)) != 0)
 	{
-		char buffer[64];
-		GetTimeStamp(buffer);
-		ss << "[(GMT)" << buffer << "]";
+		buffer.Append('[');
+		AppendTimeStamp(buffer, timestamp_ns);
+		buffer.Append(']');
 	}
 
 	if ((type & static_cast<uint32_t>(LogInfos::ThreadId)) != 0)
 	{
-		ss << "[" << std::this_thread::get_id() << "]";
+		buffer.Append(thread_tag.data(), thread_tag.size());
 	}
+	AppendContext(buffer, context);
+	return type;
+}
+
+} // namespace
 
+void PrintInfos(
+	LogBuffer& buffer,
+	const LogMessageType message_type,
+	const char* const file_name,
+	const int line,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context)
+{
+	const auto type = PrintInfosBeforeLocation(buffer, GetLogInfos(), message_type, timestamp_ns, thread_tag, context);
 	if ((type & static_cast<uint32_t>(LogInfos::FileNameWithLine)) != 0)
 	{
-		ss << "[" << file_name << ":" << line << "]";
+		buffer.Append('[');
+		buffer.Append(file_name, std::strlen(file_name));
+		buffer.Append(':');
+		AppendInteger(buffer, line);
+		buffer.Append(']');
 	}
 }
 
-} // namespace
+void PrintInfos(
+	LogBuffer& buffer,
+	const CallSite& site,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context)
+{
+	const auto type = PrintInfosBeforeLocation(
+		buffer, GetLogInfos(), site.GetMessageType(), timestamp_ns, thread_tag, context);
+	if ((type & static_cast<uint32_t>(LogInfos::FileNameWithLine)) != 0)
+	{
+		const auto file_name_with_line = site.GetFileNameWithLine();
+		buffer.Append('[');
+		buffer.Append(file_name_with_line.data(), file_name_with_line.size());
+	}
+}
 
-LogType GetLogType()
+void PrintInfos(LogBuffer& buffer, const uint32_t log_infos, const LogRecord& record)
 {
-	return log_type_.load();
+	const auto type = PrintInfosBeforeLocation(
+		buffer, log_infos, record.message_type, record.timestamp_ns, record.thread_tag, record.context);
+	if ((type & static_cast<uint32_t>(LogInfos::FileNameWithLine)) != 0)
+	{
+		buffer.Append('[');
+		buffer.Append(record.file_name.data(), record.file_name.size());
+		buffer.Append(':');
+		AppendInteger(buffer, record.line);
+		buffer.Append(']');
+	}
 }
 
 void SetLogType(const LogType log_type)
 {
-	log_type_.store(log_type);
+	std::lock_guard<std::mutex> lock(log_config_mutex_);
+	const auto word = detail::log_config.word.load(std::memory_order_relaxed);
+	detail::log_config.word.store(MakeLogConfig(log_type, word, word), std::memory_order_relaxed);
 }
 
-uint32_t GetLogMessageTypes()
+void SetLogMessageTypes(const uint32_t log_message_types)
 {
-	return log_message_types_.load();
+	std::lock_guard<std::mutex> lock(log_config_mutex_);
+	const auto word = detail::log_config.word.load(std::memory_order_relaxed);
+	detail::log_config.word.store(MakeLogConfig(GetLogType(), log_message_types, word), std::memory_order_relaxed);
 }
 
-void SetLogMessageTypes(const uint32_t log_message_types)
+void SetLogConfigFlag(const uint32_t flag, const bool set)
 {
-	log_message_types_.store(log_message_types);
+	std::lock_guard<std::mutex> lock(log_config_mutex_);
+	const auto word = detail::log_config.word.load(std::memory_order_relaxed);
+	detail::log_config.word.store(
+		MakeLogConfig(GetLogType(), word, set ? word | flag : word & ~flag),
+		std::memory_order_relaxed);
 }
 
 uint32_t GetLogInfos()
@@ -110,24 +203,83 @@ void SetLogInfos(const uint32_t log_infos)
 	log_infos_.store(log_infos);
 }
 
-std::ostream& GetLogStream()
+LogBuffer::LogBuffer()
+	: stream_(this)
+{
+	Grow(256);
+}
+
+void LogBuffer::ResetStream()
+{
+	stream_.flags(std::ios_base::dec | std::ios_base::skipws);
+	stream_.precision(6);
+	stream_.width(0);
+	stream_.fill(' ');
+	stream_.clear();
+}
+
+void AppendFloatingPoint(LogBuffer& buffer, const float value)
 {
-	return *log_stream_.load();
+	char digits[32];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+	buffer.Append(digits, static_cast<size_t>(result.ptr - digits));
 }
 
-void SetLogStream(std::ostream& stream)
+void AppendFloatingPoint(LogBuffer& buffer, const double value)
 {
-	log_stream_.store(&stream);
+	char digits[32];
+	const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+	buffer.Append(digits, static_cast<size_t>(result.ptr - digits));
 }
 
-std::ostream& GetELogStream()
+// Same text as the ostream inserter: "0x1a2b", or "0" for a null pointer.
+void AppendPointer(LogBuffer& buffer, const void* const value)
 {
-	return *elog_stream_.load();
+	if (value == nullptr)
+	{
+		buffer.Append('0');
+		return;
+	}
+	char digits[2 + 2 * sizeof(uintptr_t)] = {'0', 'x'};
+	const auto result = std::to_chars(digits + 2, digits + sizeof(digits), reinterpret_cast<uintptr_t>(value), 16);
+	buffer.Append(digits, static_cast<size_t>(result.ptr - digits));
 }
 
-void SetELogStream(std::ostream& stream)
+LogBuffer::int_type LogBuffer::overflow(const int_type ch)
 {
-	elog_stream_.store(&stream);
+	if (!traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		Append(traits_type::to_char_type(ch));
+	}
+	return traits_type::not_eof(ch);
+}
+
+std::streamsize LogBuffer::xsputn(const char* const data, const std::streamsize count)
+{
+	Append(data, static_cast<size_t>(count));
+	return count;
+}
+
+void LogBuffer::Grow(const size_t min_capacity)
+{
+	auto capacity = capacity_ == 0 ? 256 : capacity_;
+	while (capacity < min_capacity)
+	{
+		capacity *= 2;
+	}
+	std::unique_ptr<char[]> data(new char[capacity]);
+	if (size_ != 0)
+	{
+		std::memcpy(data.get(), data_.get(), size_);
+	}
+	data_ = std::move(data);
+	capacity_ = capacity;
+}
+
+LogBuffer& GetThreadLogBuffer()
+{
+	thread_local LogBuffer buffer;
+	return buffer;
 }
 
 Logger::Logger(
@@ -135,16 +287,163 @@ Logger::Logger(
 	const LogMessageType message_type,
 	const char* const file_name,
 	const int line)
-	: out_str_(out_str)
+	: buffer_(GetThreadLogBuffer())
+	, begin_(buffer_.Size())
+	, stream_(&out_str)
+	, message_type_(message_type)
+	, timestamp_ns_(GetCurrentTimeStamp())
+	, file_name_(file_name)
+	, line_(line)
+	, disposition_(LogDisposition::Emit)
+{
+	buffer_.ResetStream();
+	PrintInfos(buffer_, message_type, file_name, line, timestamp_ns_, GetThreadTag(), GetLogContext());
+	buffer_.Append("$ ", 2);
+	message_begin_ = buffer_.Size();
+	fields_begin_ = message_begin_;
+	fields_end_ = message_begin_;
+	if (IsLoggerTimingEnabled())
+	{
+		format_begin_ns_ = GetCurrentTimeStamp();
+		CountInfosTime(format_begin_ns_ - timestamp_ns_);
+	}
+}
+
+Logger::Logger(std::ostream& out_str, const CallSite& site)
+	: Logger(&out_str, site, LogDisposition::Emit)
+{}
+
+Logger::Logger(const CallSite& site, const LogDisposition disposition)
+	: Logger(nullptr, site, disposition)
+{}
+
+Logger::Logger(std::ostream* const out_str, const CallSite& site, const LogDisposition disposition)
+	: buffer_(GetThreadLogBuffer())
+	, begin_(buffer_.Size())
+	, stream_(out_str)
+	, message_type_(site.GetMessageType())
+	, timestamp_ns_(GetCurrentTimeStamp())
+	, file_name_(site.GetFileName())
+	, line_(site.GetLine())
+	, disposition_(disposition)
 {
-	PrintInfos(ss_, message_type, file_name, line);
-	ss_ << "$ ";
+	buffer_.ResetStream();
+	PrintInfos(buffer_, site, timestamp_ns_, GetThreadTag(), GetLogContext());
+	buffer_.Append("$ ", 2);
+	message_begin_ = buffer_.Size();
+	fields_begin_ = message_begin_;
+	fields_end_ = message_begin_;
+	if (IsLoggerTimingEnabled())
+	{
+		format_begin_ns_ = GetCurrentTimeStamp();
+		CountInfosTime(format_begin_ns_ - timestamp_ns_);
+	}
+}
+
+void Logger::MoveFieldsToEnd()
+{
+	auto* const data = buffer_.Data();
+	const auto text_size = buffer_.Size() - fields_end_;
+	// Usually a short message after the fields: swapped through the stack.
+	char text[256];
+	if (text_size <= sizeof(text))
+	{
+		std::memcpy(text, data + fields_end_, text_size);
+		std::memmove(data + fields_begin_ + text_size, data + fields_begin_, fields_end_ - fields_begin_);
+		std::memcpy(data + fields_begin_, text, text_size);
+	}
+	else
+	{
+		std::rotate(data + fields_begin_, data + fields_end_, data + buffer_.Size());
+	}
+	fields_begin_ = buffer_.Size() - (fields_end_ - fields_begin_);
+	fields_end_ = buffer_.Size();
+}
+
+LogDisposition GetSuppressedLogDisposition(CallSite& site)
+{
+	CountSuppressed(site.GetMessageType());
+	return site.IsSwitchedOn() ? LogDisposition::RecordOnly : LogDisposition::Skip;
 }
 
 Logger::~Logger()
 {
-	ss_ << "\n";
-	out_str_ << ss_.str();
+	if (format_begin_ns_ != 0)
+	{
+		CountFormatTime(GetCurrentTimeStamp() - format_begin_ns_);
+	}
+	if (fields_end_ != buffer_.Size())
+	{
+		MoveFieldsToEnd();
+	}
+	buffer_.Append('\n');
+	const auto* const data = buffer_.Data();
+	const LogRecord record{
+		message_type_,
+		timestamp_ns_,
+		GetThreadTag(),
+		file_name_,
+		line_,
+		std::string_view(data + message_begin_, fields_begin_ - message_begin_),
+		std::string_view(data + begin_, buffer_.Size() - begin_),
+		std::string_view(data + fields_begin_, fields_end_ - fields_begin_),
+		GetLogContext()};
+	if (IsFlightRecorderEnabled())
+	{
+		RecordFlightText(record.timestamp_ns, record.text);
+	}
+	if (disposition_ == LogDisposition::RecordOnly)
+	{
+		buffer_.Truncate(begin_);
+		return;
+	}
+
+	// A fatal record bypasses the queue: everything queued before it is written first,
+	// then the record itself by this thread.
+	const auto fatal = message_type_ == LogMessageType::FatalError;
+	if (fatal)
+	{
+		// Out first: the flushes below can block, or the process die in them.
+		WriteEmergencyRecord(record.text);
+		FlushAsyncLogging();
+	}
+	if (fatal || !PushAsyncRecord(stream_, record))
+	{
+		CountEmitted(message_type_, record.text.size());
+		if (stream_ != nullptr)
+		{
+			stream_->write(record.text.data(), static_cast<std::streamsize>(record.text.size()));
+		}
+		else
+		{
+			DispatchLogRecord(record);
+		}
+	}
+	buffer_.Truncate(begin_);
+
+	// A fatal record is committed by its sinks before the statement returns.
+	if (fatal)
+	{
+		if (stream_ != nullptr)
+		{
+			stream_->flush();
+		}
+		else
+		{
+			FlushLogSinks();
+		}
+		DumpFlightRecorder();
+	}
+}
+
+void ThrowRuntimeError(const char* message)
+{
+	throw std::runtime_error(message);
+}
+
+void ThrowRuntimeError(const std::string& message)
+{
+	throw std::runtime_error(message);
 }
 
 } // namespace SimpleLog
\ No newline at end of file
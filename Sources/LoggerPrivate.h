@@ -0,0 +1,86 @@
+#pragma once
+#include "../Headers/LogSink.h"
+#include "../Headers/Logger.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace SimpleLog
+{
+
+class EmergencyLine;
+struct DeferredSite;
+
+// Nanoseconds since the Unix epoch (system clock).
+int64_t GetCurrentTimeStamp();
+
+// Appends the timestamp in the configured TimeStampFormat/TimeStampPrecision.
+void AppendTimeStamp(LogBuffer& buffer, const int64_t timestamp_ns);
+
+constexpr size_t kMaxTimeStampSize = 40;
+// Async-signal-safe form of AppendTimeStamp: renders into out, which holds
+// kMaxTimeStampSize bytes, and returns the size.
+size_t FormatTimeStamp(char* out, const int64_t timestamp_ns);
+
+// 'E', 'W', 'I' or 'F', as in the "[I]" prefix.
+char MessageTypeToChar(const LogMessageType message_type);
+
+// "[number]" or "[number:name]" of the calling thread, rendered once per thread and
+// again only after SetThreadName.
+std::string_view GetThreadTag();
+
+// Renders the "[type][(GMT)time][thread][context][file:line]" prefix selected by
+// GetLogInfos(); thread_tag is the bracketed text from GetThreadTag(), context the
+// producer's GetLogContext(), shown whenever it is not empty.
+void PrintInfos(
+	LogBuffer& buffer,
+	const LogMessageType message_type,
+	const char* const file_name,
+	const int line,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context);
+
+// Same, with the source location pre-rendered by the call site.
+void PrintInfos(
+	LogBuffer& buffer,
+	const CallSite& site,
+	const int64_t timestamp_ns,
+	const std::string_view thread_tag,
+	const std::string_view context);
+
+// Same for a record handed to a sink formatter, with an explicit LogInfos mask.
+void PrintInfos(LogBuffer& buffer, const uint32_t log_infos, const LogRecord& record);
+
+// Sets or clears a flag bit of the config word, such as LogConfig::kFlightRecorder
+// (Logger.cpp).
+void SetLogConfigFlag(const uint32_t flag, const bool set);
+
+// Per-thread counters behind GetLoggerStats() (LoggerStats.cpp).
+void CountEmitted(const LogMessageType message_type, const size_t bytes);
+void CountDropped(const LogMessageType message_type);
+void CountInfosTime(const int64_t ns);
+void CountFormatTime(const int64_t ns);
+
+// Writes record to every registered sink accepting its type (LogSink.cpp).
+void DispatchLogRecord(const LogRecord& record);
+
+// Writes the text of a FatalError record to the emergency descriptors, if any
+// (EmergencyLog.cpp).
+void WriteEmergencyRecord(const std::string_view text);
+
+// Copy a rendered record, or the context and raw arguments of a deferred one, into
+// the calling thread's flight recorder ring (FlightRecorder.cpp).
+void RecordFlightText(const int64_t timestamp_ns, const std::string_view text);
+void RecordFlightDeferred(
+	const DeferredSite& site,
+	const int64_t timestamp_ns,
+	const std::string_view context,
+	const char* const payload,
+	const size_t payload_size);
+
+// Async-signal-safe: appends the message of a deferred record, its raw arguments in
+// payload, to line (DeferredLog.cpp).
+void FormatDeferredMessageFromSignal(EmergencyLine& line, const DeferredSite& site, const char* const payload);
+
+} // namespace SimpleLog
@@ -0,0 +1,220 @@
+#include "../Headers/LoggerStats.h"
+#include "AsyncBackend.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+enum Counter : size_t
+{
+	kEmitted = 0,
+	kSuppressed = kEmitted + 4,
+	kDropped = kSuppressed + 4,
+	kBytes = kDropped + 4,
+	kInfosTime,
+	kFormatTime,
+	kCounterCount,
+};
+
+// One line per thread: only its owner writes, so a relaxed load and store replace
+// the locked read-modify-write.
+struct alignas(64) ThreadStats
+{
+	std::atomic<uint64_t> counters[kCounterCount]{};
+
+	void Add(const size_t counter, const uint64_t value)
+	{
+		auto& target = counters[counter];
+		target.store(target.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+};
+
+struct StatsRegistry
+{
+	std::mutex mutex;
+	std::vector<ThreadStats*> threads;
+	// Counts of exited threads, and of threads logging while their thread_local
+	// objects are destroyed.
+	std::atomic<uint64_t> retired[kCounterCount]{};
+	// Totals at the last ResetLoggerStats().
+	uint64_t baseline[kCounterCount] = {};
+};
+
+StatsRegistry& GetStatsRegistry()
+{
+	static auto* const registry = new StatsRegistry();
+	return *registry;
+}
+
+std::atomic<bool> logger_timing_enabled_{false};
+
+// Trivially destructible like the other per-thread state; the owner folds the counts
+// into the registry at thread exit.
+thread_local ThreadStats* thread_stats_ = nullptr;
+thread_local bool thread_stats_released_ = false;
+
+struct ThreadStatsOwner
+{
+	~ThreadStatsOwner()
+	{
+		auto& registry = GetStatsRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (size_t i = 0; i < kCounterCount; ++i)
+		{
+			registry.retired[i].fetch_add(thread_stats_->counters[i].load(std::memory_order_relaxed));
+		}
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), thread_stats_));
+		detail::thread_suppressed_counts = nullptr;
+		delete thread_stats_;
+		thread_stats_ = nullptr;
+		thread_stats_released_ = true;
+	}
+};
+
+ThreadStats* GetThreadStats()
+{
+	if (thread_stats_ == nullptr && !thread_stats_released_)
+	{
+		thread_local ThreadStatsOwner owner;
+		auto& registry = GetStatsRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		thread_stats_ = new ThreadStats();
+		registry.threads.push_back(thread_stats_);
+		detail::thread_suppressed_counts = thread_stats_->counters + kSuppressed;
+	}
+	return thread_stats_;
+}
+
+void Count(const size_t counter, const uint64_t value)
+{
+	if (auto* const stats = GetThreadStats())
+	{
+		stats->Add(counter, value);
+	}
+	else
+	{
+		GetStatsRegistry().retired[counter].fetch_add(value, std::memory_order_relaxed);
+	}
+}
+
+// The clock is the wall clock: a step backwards counts as nothing.
+uint64_t ToElapsed(const int64_t ns)
+{
+	return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+}
+
+void SumCounters(StatsRegistry& registry, uint64_t (&totals)[kCounterCount])
+{
+	for (size_t i = 0; i < kCounterCount; ++i)
+	{
+		totals[i] = registry.retired[i].load(std::memory_order_relaxed);
+	}
+	for (const auto* const stats : registry.threads)
+	{
+		for (size_t i = 0; i < kCounterCount; ++i)
+		{
+			totals[i] += stats->counters[i].load(std::memory_order_relaxed);
+		}
+	}
+}
+
+} // namespace
+
+void CountFirstSuppressed(const LogMessageType message_type)
+{
+	Count(kSuppressed + GetLogMessageTypeIndex(message_type), 1);
+}
+
+void CountEmitted(const LogMessageType message_type, const size_t bytes)
+{
+	Count(kEmitted + GetLogMessageTypeIndex(message_type), 1);
+	Count(kBytes, bytes);
+}
+
+void CountDropped(const LogMessageType message_type)
+{
+	Count(kDropped + GetLogMessageTypeIndex(message_type), 1);
+}
+
+void CountInfosTime(const int64_t ns)
+{
+	Count(kInfosTime, ToElapsed(ns));
+}
+
+void CountFormatTime(const int64_t ns)
+{
+	Count(kFormatTime, ToElapsed(ns));
+}
+
+LoggerStats GetLoggerStats()
+{
+	uint64_t totals[kCounterCount];
+	{
+		auto& registry = GetStatsRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		SumCounters(registry, totals);
+		for (size_t i = 0; i < kCounterCount; ++i)
+		{
+			totals[i] -= std::min(totals[i], registry.baseline[i]);
+		}
+	}
+
+	LoggerStats stats;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		stats.message_types[i].emitted = totals[kEmitted + i];
+		stats.message_types[i].suppressed = totals[kSuppressed + i];
+		stats.message_types[i].dropped = totals[kDropped + i];
+	}
+	stats.bytes = totals[kBytes];
+	stats.infos_ns = totals[kInfosTime];
+	stats.format_ns = totals[kFormatTime];
+	stats.queue = GetAsyncQueueStats();
+	for (auto& sink : GetLogSinks())
+	{
+		LogSinkStats sink_stats;
+		sink_stats.records = sink->GetWrittenRecords();
+		sink_stats.bytes = sink->GetWrittenBytes();
+		sink_stats.write_ns = sink->GetWriteTime();
+		sink_stats.sink = std::move(sink);
+		stats.sinks.push_back(std::move(sink_stats));
+	}
+	return stats;
+}
+
+void ResetLoggerStats()
+{
+	auto& registry = GetStatsRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	SumCounters(registry, registry.baseline);
+}
+
+bool IsLoggerTimingEnabled()
+{
+	return logger_timing_enabled_.load(std::memory_order_relaxed);
+}
+
+void SetLoggerTimingEnabled(const bool enabled)
+{
+	logger_timing_enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsSuppressedCountingEnabled()
+{
+	return (detail::log_config.word.load(std::memory_order_relaxed) & LogConfig::kCountSuppressed) != 0;
+}
+
+void SetSuppressedCountingEnabled(const bool enabled)
+{
+	SetLogConfigFlag(LogConfig::kCountSuppressed, enabled);
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,297 @@
+#include "../Headers/MappedFileStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+// 64 GiB with the default chunk size.
+constexpr size_t kMaxChunks = 4096;
+
+size_t RoundToPages(const size_t size)
+{
+	const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return std::max(page_size, (size + page_size - 1) / page_size * page_size);
+}
+
+// Drops whatever follows the last complete record of a file left by a crash.
+size_t TrimIncompleteTail(const int fd)
+{
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		return 0;
+	}
+	const auto size = static_cast<size_t>(file_stat.st_size);
+	auto* const data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		return 0;
+	}
+	const auto end = FindMappedLogEnd(static_cast<const char*>(data), size);
+	munmap(data, size);
+	if (end != size && ftruncate(fd, static_cast<off_t>(end)) != 0)
+	{
+		return size;
+	}
+	return end;
+}
+
+} // namespace
+
+MappedFileStream::Buffer::Buffer(const std::string& path, const size_t chunk_size)
+	: chunk_size_(RoundToPages(chunk_size))
+	, chunks_(new std::atomic<char*>[kMaxChunks])
+{
+	for (size_t i = 0; i < kMaxChunks; ++i)
+	{
+		chunks_[i].store(nullptr, std::memory_order_relaxed);
+	}
+	fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd_ >= 0)
+	{
+		cursor_.store(TrimIncompleteTail(fd_));
+	}
+	closed_.store(fd_ < 0);
+}
+
+MappedFileStream::Buffer::~Buffer()
+{
+	Close();
+}
+
+bool MappedFileStream::Buffer::IsOpen() const
+{
+	return !closed_.load();
+}
+
+size_t MappedFileStream::Buffer::Size() const
+{
+	return cursor_.load(std::memory_order_relaxed);
+}
+
+void MappedFileStream::Buffer::Close()
+{
+	if (closed_.exchange(true))
+	{
+		return;
+	}
+	// A writer may still be copying into a chunk.
+	while (writers_.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	std::lock_guard<std::mutex> lock(map_mutex_);
+	for (size_t i = 0; i < kMaxChunks; ++i)
+	{
+		if (auto* const chunk = chunks_[i].exchange(nullptr))
+		{
+			munmap(chunk, chunk_size_);
+		}
+	}
+	// The mapped chunks pre-size the file; keep only what was written.
+	static_cast<void>(ftruncate(fd_, static_cast<off_t>(cursor_.load())));
+	close(fd_);
+	fd_ = -1;
+}
+
+bool MappedFileStream::Buffer::EnterWriter()
+{
+	writers_.fetch_add(1);
+	if (closed_.load())
+	{
+		LeaveWriter();
+		return false;
+	}
+	return true;
+}
+
+void MappedFileStream::Buffer::LeaveWriter()
+{
+	writers_.fetch_sub(1, std::memory_order_release);
+}
+
+std::streamsize MappedFileStream::Buffer::xsputn(const char* data, const std::streamsize size)
+{
+	if (size <= 0 || !EnterWriter())
+	{
+		return 0;
+	}
+	auto offset = cursor_.fetch_add(static_cast<size_t>(size), std::memory_order_relaxed);
+	auto left = static_cast<size_t>(size);
+	while (left != 0)
+	{
+		auto* const chunk = GetChunk(offset / chunk_size_);
+		if (chunk == nullptr)
+		{
+			LeaveWriter();
+			return size - static_cast<std::streamsize>(left);
+		}
+		const auto in_chunk = offset % chunk_size_;
+		const auto count = std::min(left, chunk_size_ - in_chunk);
+		std::memcpy(chunk + in_chunk, data, count);
+		data += count;
+		offset += count;
+		left -= count;
+	}
+	LeaveWriter();
+	return size;
+}
+
+MappedFileStream::Buffer::int_type MappedFileStream::Buffer::overflow(const int_type ch)
+{
+	if (traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		return traits_type::not_eof(ch);
+	}
+	const auto value = traits_type::to_char_type(ch);
+	return xsputn(&value, 1) == 1 ? ch : traits_type::eof();
+}
+
+int MappedFileStream::Buffer::sync()
+{
+	if (!EnterWriter())
+	{
+		return -1;
+	}
+	for (size_t i = 0; i < kMaxChunks; ++i)
+	{
+		if (auto* const chunk = chunks_[i].load(std::memory_order_acquire))
+		{
+			msync(chunk, chunk_size_, MS_ASYNC);
+		}
+	}
+	LeaveWriter();
+	return 0;
+}
+
+char* MappedFileStream::Buffer::GetChunk(const size_t index)
+{
+	if (index >= kMaxChunks)
+	{
+		return nullptr;
+	}
+	if (auto* const chunk = chunks_[index].load(std::memory_order_acquire))
+	{
+		return chunk;
+	}
+	return MapChunk(index);
+}
+
+char* MappedFileStream::Buffer::MapChunk(const size_t index)
+{
+	std::lock_guard<std::mutex> lock(map_mutex_);
+	if (auto* const chunk = chunks_[index].load(std::memory_order_acquire))
+	{
+		return chunk;
+	}
+	if (fd_ < 0)
+	{
+		return nullptr;
+	}
+
+	// Blocks are allocated up front so a full disk fails here rather than with
+	// SIGBUS on a later memcpy.
+	const auto offset = static_cast<off_t>(index * chunk_size_);
+	if (posix_fallocate(fd_, offset, static_cast<off_t>(chunk_size_)) != 0 &&
+		ftruncate(fd_, offset + static_cast<off_t>(chunk_size_)) != 0)
+	{
+		return nullptr;
+	}
+	auto* const data = mmap(nullptr, chunk_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+	if (data == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	auto* const chunk = static_cast<char*>(data);
+	chunks_[index].store(chunk, std::memory_order_release);
+	return chunk;
+}
+
+MappedFileStream::MappedFileStream(const std::string& path, const size_t chunk_size)
+	: std::ostream(nullptr)
+	, buffer_(path, chunk_size)
+{
+	rdbuf(&buffer_);
+	if (!buffer_.IsOpen())
+	{
+		setstate(std::ios_base::badbit);
+	}
+}
+
+MappedFileStream::~MappedFileStream()
+{
+	buffer_.Close();
+}
+
+bool MappedFileStream::IsOpen() const
+{
+	return buffer_.IsOpen();
+}
+
+size_t MappedFileStream::Size() const
+{
+	return buffer_.Size();
+}
+
+void MappedFileStream::Close()
+{
+	buffer_.Close();
+}
+
+size_t FindMappedLogEnd(const char* const data, const size_t size)
+{
+	for (auto end = size; end > 0; --end)
+	{
+		if (data[end - 1] == '\n')
+		{
+			return end;
+		}
+	}
+	return 0;
+}
+
+size_t RecoverMappedLog(const std::string& path, std::string& out)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return 0;
+	}
+	const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	size_t records = 0;
+	size_t begin = 0;
+	while (begin < data.size())
+	{
+		const auto end = data.find('\n', begin);
+		if (end == std::string::npos)
+		{
+			break;
+		}
+		// Anything up to the last NUL belongs to a record that was never completed.
+		const auto hole = data.find_last_of('\0', end);
+		const auto record = hole == std::string::npos || hole < begin ? begin : hole + 1;
+		if (record < end)
+		{
+			out.append(data, record, end + 1 - record);
+			++records;
+		}
+		begin = end + 1;
+	}
+	return records;
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace SimpleLog
+{
+
+// Bounded lock-free multi-producer/single-consumer ring (D. Vyukov's bounded queue
+// with the consumer side reduced to a single thread). Every slot carries a sequence
+// number: a producer owns a slot when sequence == position, the consumer owns it when
+// sequence == position + 1. Slot values are reused, so a T that keeps its capacity
+// (std::string, std::vector) stops allocating once the ring is warm.
+template <typename T>
+class MpscRing
+{
+public:
+	explicit MpscRing(size_t capacity);
+
+	MpscRing(const MpscRing&) = delete;
+	MpscRing& operator=(const MpscRing&) = delete;
+
+	// fill(T&) is called on the claimed slot; returns false when the ring is full.
+	template <typename Fill>
+	bool TryPush(Fill&& fill);
+
+	// consume(T&) is called on the oldest committed slot; returns false when it is
+	// empty or the oldest slot is still being filled. Single consumer only.
+	template <typename Consume>
+	bool TryPop(Consume&& consume);
+
+	size_t Capacity() const;
+	size_t ApproximateSize() const;
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	static size_t RoundUpToPowerOfTwo(size_t value);
+
+	const size_t mask_;
+	std::unique_ptr<Slot[]> slots_;
+	alignas(64) std::atomic<size_t> enqueue_pos_;
+	alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+template <typename T>
+MpscRing<T>::MpscRing(const size_t capacity)
+	: mask_(RoundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1)
+	, slots_(new Slot[mask_ + 1])
+	, enqueue_pos_(0)
+	, dequeue_pos_(0)
+{
+	for (size_t i = 0; i <= mask_; ++i)
+	{
+		slots_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <typename T>
+template <typename Fill>
+bool MpscRing<T>::TryPush(Fill&& fill)
+{
+	auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+	Slot* slot = nullptr;
+	for (;;)
+	{
+		slot = &slots_[pos & mask_];
+		const auto sequence = slot->sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0)
+		{
+			if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			pos = enqueue_pos_.load(std::memory_order_relaxed);
+		}
+	}
+
+	fill(slot->value);
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+template <typename Consume>
+bool MpscRing<T>::TryPop(Consume&& consume)
+{
+	const auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+	Slot& slot = slots_[pos & mask_];
+	if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+	{
+		return false;
+	}
+
+	consume(slot.value);
+	slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+	dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+template <typename T>
+size_t MpscRing<T>::Capacity() const
+{
+	return mask_ + 1;
+}
+
+template <typename T>
+size_t MpscRing<T>::ApproximateSize() const
+{
+	const auto enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+	const auto dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+	return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+template <typename T>
+size_t MpscRing<T>::RoundUpToPowerOfTwo(size_t value)
+{
+	size_t result = 1;
+	while (result < value)
+	{
+		result <<= 1;
+	}
+	return result;
+}
+
+} // namespace SimpleLog
@@ -0,0 +1,374 @@
+#include "../Headers/SharedMemoryLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+constexpr uint32_t kSharedRingMagic = 0x52474c53; // "SLGR"
+constexpr uint32_t kSharedRingVersion = 1;
+
+// Start of the shared memory object; the records follow at kDataOffset.
+struct SharedRingHeader
+{
+	// Stored last by the producer, once the rest is initialized.
+	std::atomic<uint32_t> magic{0};
+	uint32_t version = kSharedRingVersion;
+	uint64_t capacity = 0;
+	int32_t pid = 0;
+	std::atomic<uint32_t> closed{0};
+
+	alignas(64) std::atomic<uint64_t> head{0};
+	std::atomic<uint64_t> dropped{0};
+
+	// Written by the collector only.
+	alignas(64) std::atomic<uint64_t> tail{0};
+};
+
+namespace
+{
+
+constexpr size_t kDataOffset = 4096;
+constexpr size_t kMinCapacity = 64 << 10;
+constexpr size_t kMaxCapacity = size_t{1} << 30;
+
+static_assert(sizeof(SharedRingHeader) <= kDataOffset, "The ring header overlaps the records");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory counters must be lock-free");
+
+// The producer stores the size as soon as it owns the space and adds kCommitted once
+// the record is complete, so the collector can step over the record of a process
+// that died while writing it. Zero: nothing written yet. The collector zeroes every
+// byte it consumed, so a new lap never finds stale state.
+constexpr uint32_t kCommitted = 0x80000000u;
+constexpr uint32_t kPadding = 0x40000000u;
+constexpr uint32_t kSizeMask = kPadding - 1;
+
+struct SharedRecordHeader
+{
+	std::atomic<uint32_t> state;
+	uint32_t text_size;
+	int64_t timestamp_ns;
+};
+
+constexpr size_t AlignRecord(const size_t size)
+{
+	return (size + sizeof(SharedRecordHeader) - 1) & ~(sizeof(SharedRecordHeader) - 1);
+}
+
+size_t RoundCapacity(const size_t capacity)
+{
+	size_t rounded = kMinCapacity;
+	while (rounded < capacity && rounded < kMaxCapacity)
+	{
+		rounded <<= 1;
+	}
+	return rounded;
+}
+
+SharedRecordHeader* GetRecord(char* const data, const uint64_t offset)
+{
+	return reinterpret_cast<SharedRecordHeader*>(data + offset);
+}
+
+bool IsProcessAlive(const int32_t pid)
+{
+	return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+} // namespace
+
+SharedMemorySink::SharedMemorySink(
+	const std::string& prefix,
+	const size_t capacity,
+	const uint32_t message_types,
+	std::shared_ptr<const LogFormatter> formatter)
+	: LogSink(message_types, std::move(formatter))
+{
+	const auto rounded = RoundCapacity(capacity);
+	const auto pid = getpid();
+	// Another sink of the process, or a ring left by a crashed process with the same
+	// pid that the collector has not drained yet, may hold the plain name.
+	int fd = -1;
+	for (int attempt = 0; fd < 0 && attempt < 100; ++attempt)
+	{
+		name_ = prefix + "." + std::to_string(pid);
+		if (attempt != 0)
+		{
+			name_ += "." + std::to_string(attempt);
+		}
+		fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0 && errno != EEXIST)
+		{
+			break;
+		}
+	}
+	if (fd < 0)
+	{
+		return;
+	}
+
+	const auto size = kDataOffset + rounded;
+	auto flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	// Faulted in now rather than by the first records.
+	flags |= MAP_POPULATE;
+#endif
+	void* address = MAP_FAILED;
+	if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+	{
+		address = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	}
+	close(fd);
+	if (address == MAP_FAILED)
+	{
+		shm_unlink(name_.c_str());
+		return;
+	}
+
+	header_ = new (address) SharedRingHeader();
+	header_->capacity = rounded;
+	header_->pid = static_cast<int32_t>(pid);
+	header_->magic.store(kSharedRingMagic, std::memory_order_release);
+	data_ = static_cast<char*>(address) + kDataOffset;
+	mapped_size_ = size;
+}
+
+SharedMemorySink::~SharedMemorySink()
+{
+	if (header_ != nullptr)
+	{
+		header_->closed.store(1, std::memory_order_release);
+		munmap(header_, mapped_size_);
+	}
+}
+
+bool SharedMemorySink::IsOpen() const
+{
+	return header_ != nullptr;
+}
+
+const std::string& SharedMemorySink::GetName() const
+{
+	return name_;
+}
+
+uint64_t SharedMemorySink::GetDroppedRecords() const
+{
+	return header_ == nullptr ? 0 : header_->dropped.load(std::memory_order_relaxed);
+}
+
+void SharedMemorySink::Write(const LogRecord& record, const std::string_view text)
+{
+	if (header_ == nullptr)
+	{
+		return;
+	}
+
+	// Records never wrap: one that does not fit before the end follows a padding record.
+	const auto capacity = header_->capacity;
+	const auto size = AlignRecord(sizeof(SharedRecordHeader) + text.size());
+	auto head = header_->head.load(std::memory_order_relaxed);
+	uint64_t to_end = 0;
+	for (;;)
+	{
+		to_end = capacity - (head & (capacity - 1));
+		const auto needed = size <= to_end ? size : to_end + size;
+		if (size > capacity / 2 || head + needed - header_->tail.load(std::memory_order_acquire) > capacity)
+		{
+			header_->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (header_->head.compare_exchange_weak(head, head + needed, std::memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	auto offset = head & (capacity - 1);
+	if (size > to_end)
+	{
+		GetRecord(data_, offset)->state.store(
+			static_cast<uint32_t>(to_end) | kPadding | kCommitted, std::memory_order_release);
+		offset = 0;
+	}
+	auto* const out = GetRecord(data_, offset);
+	out->state.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+	out->text_size = static_cast<uint32_t>(text.size());
+	out->timestamp_ns = record.timestamp_ns;
+	std::memcpy(reinterpret_cast<char*>(out + 1), text.data(), text.size());
+	out->state.store(static_cast<uint32_t>(size) | kCommitted, std::memory_order_release);
+}
+
+struct SharedLogCollector::Ring
+{
+	std::string name;
+	SharedRingHeader* header;
+	char* data;
+	size_t mapped_size;
+	uint64_t capacity;
+};
+
+SharedLogCollector::SharedLogCollector(const std::string& prefix)
+	: prefix_(prefix)
+{}
+
+SharedLogCollector::~SharedLogCollector()
+{
+	for (const auto& ring : rings_)
+	{
+		munmap(ring->header, ring->mapped_size);
+	}
+}
+
+size_t SharedLogCollector::Poll(const std::function<void(const SharedLogRecord&)>& visit)
+{
+	MapNewRings();
+	size_t count = 0;
+	for (auto it = rings_.begin(); it != rings_.end();)
+	{
+		auto& ring = **it;
+		// Decided before reading: once the process is gone, everything it wrote is there.
+		const auto exited = ring.header->closed.load(std::memory_order_acquire) != 0 ||
+			!IsProcessAlive(ring.header->pid);
+		count += Drain(ring, exited, visit);
+		if (exited && ring.header->tail.load(std::memory_order_relaxed) == ring.header->head.load(std::memory_order_relaxed))
+		{
+			// Drained for good, or left with a record that was never even sized.
+			dropped_ += ring.header->dropped.load(std::memory_order_relaxed);
+			munmap(ring.header, ring.mapped_size);
+			shm_unlink(ring.name.c_str());
+			it = rings_.erase(it);
+			continue;
+		}
+		++it;
+	}
+	return count;
+}
+
+SharedLogCollectorStats SharedLogCollector::GetStats() const
+{
+	SharedLogCollectorStats stats;
+	stats.rings = rings_.size();
+	stats.dropped = dropped_;
+	for (const auto& ring : rings_)
+	{
+		stats.dropped += ring->header->dropped.load(std::memory_order_relaxed);
+	}
+	stats.lost = lost_;
+	return stats;
+}
+
+void SharedLogCollector::MapNewRings()
+{
+	const auto slash = prefix_.find_last_of('/');
+	const auto base = (slash == std::string::npos ? prefix_ : prefix_.substr(slash + 1)) + ".";
+	auto* const directory = opendir("/dev/shm");
+	if (directory == nullptr)
+	{
+		return;
+	}
+	while (const auto* const entry = readdir(directory))
+	{
+		const std::string file_name = entry->d_name;
+		const auto name = "/" + file_name;
+		if (file_name.compare(0, base.size(), base) != 0 ||
+			std::any_of(rings_.cbegin(), rings_.cend(), [&name](const auto& ring) { return ring->name == name; }))
+		{
+			continue;
+		}
+
+		const auto fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+		{
+			continue;
+		}
+		struct stat status;
+		void* address = MAP_FAILED;
+		size_t size = 0;
+		if (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) > kDataOffset)
+		{
+			size = static_cast<size_t>(status.st_size);
+			address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+		if (address == MAP_FAILED)
+		{
+			continue;
+		}
+		// A ring still being created is picked up by a later poll.
+		auto* const header = static_cast<SharedRingHeader*>(address);
+		const auto capacity = header->capacity;
+		if (header->magic.load(std::memory_order_acquire) != kSharedRingMagic ||
+			header->version != kSharedRingVersion ||
+			capacity < kMinCapacity || (capacity & (capacity - 1)) != 0 || kDataOffset + capacity > size)
+		{
+			munmap(address, size);
+			continue;
+		}
+		rings_.push_back(std::make_unique<Ring>(
+			Ring{name, header, static_cast<char*>(address) + kDataOffset, size, capacity}));
+	}
+	closedir(directory);
+}
+
+size_t SharedLogCollector::Drain(
+	Ring& ring,
+	const bool exited,
+	const std::function<void(const SharedLogRecord&)>& visit)
+{
+	auto& header = *ring.header;
+	const auto capacity = ring.capacity;
+	const auto head = header.head.load(std::memory_order_acquire);
+	auto tail = header.tail.load(std::memory_order_relaxed);
+	size_t count = 0;
+	while (tail != head)
+	{
+		const auto offset = tail & (capacity - 1);
+		auto* const record = GetRecord(ring.data, offset);
+		const auto state = record->state.load(std::memory_order_acquire);
+		const auto size = state & kSizeMask;
+		if ((state & kCommitted) == 0 && !exited)
+		{
+			// Still being written.
+			break;
+		}
+		if (size < sizeof(SharedRecordHeader) || size > capacity - offset || size > head - tail)
+		{
+			// A crashed writer never sized its record: the rest of the ring cannot be
+			// walked.
+			++lost_;
+			std::memset(ring.data, 0, capacity);
+			tail = head;
+			break;
+		}
+		if ((state & kCommitted) == 0)
+		{
+			++lost_;
+		}
+		else if ((state & kPadding) == 0 && record->text_size <= size - sizeof(SharedRecordHeader))
+		{
+			visit(SharedLogRecord{
+				record->timestamp_ns,
+				header.pid,
+				std::string_view(reinterpret_cast<const char*>(record + 1), record->text_size)});
+			++count;
+		}
+		std::memset(static_cast<void*>(record), 0, size);
+		tail += size;
+		header.tail.store(tail, std::memory_order_release);
+	}
+	header.tail.store(tail, std::memory_order_release);
+	return count;
+}
+
+} // namespace SimpleLog
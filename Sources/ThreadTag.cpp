@@ -0,0 +1,81 @@
+#include "../Headers/Logger.h"
+#include "LoggerPrivate.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kMaxThreadNameSize = 47;
+
+std::atomic<uint32_t> last_thread_number_(0);
+
+// Trivially destructible, so it stays usable while the thread is being torn down.
+struct ThreadTag
+{
+	uint32_t number = 0;
+	size_t name_size = 0;
+	char name[kMaxThreadNameSize];
+	size_t text_size = 0;
+	// "[" number ":" name "]"
+	char text[kMaxThreadNameSize + 16];
+};
+
+void RenderThreadTag(ThreadTag& tag)
+{
+	char* out = tag.text;
+	*out++ = '[';
+	out = std::to_chars(out, tag.text + sizeof(tag.text), tag.number).ptr;
+	if (tag.name_size != 0)
+	{
+		*out++ = ':';
+		std::memcpy(out, tag.name, tag.name_size);
+		out += tag.name_size;
+	}
+	*out++ = ']';
+	tag.text_size = static_cast<size_t>(out - tag.text);
+}
+
+ThreadTag& GetThreadTagState()
+{
+	thread_local ThreadTag tag;
+	if (tag.number == 0)
+	{
+		tag.number = last_thread_number_.fetch_add(1, std::memory_order_relaxed) + 1;
+		RenderThreadTag(tag);
+	}
+	return tag;
+}
+
+} // namespace
+
+std::string_view GetThreadTag()
+{
+	const auto& tag = GetThreadTagState();
+	return std::string_view(tag.text, tag.text_size);
+}
+
+uint32_t GetThreadNumber()
+{
+	return GetThreadTagState().number;
+}
+
+void SetThreadName(const std::string_view name)
+{
+	auto& tag = GetThreadTagState();
+	tag.name_size = std::min(name.size(), kMaxThreadNameSize);
+	std::memcpy(tag.name, name.data(), tag.name_size);
+	RenderThreadTag(tag);
+}
+
+std::string GetThreadName()
+{
+	const auto& tag = GetThreadTagState();
+	return std::string(tag.name, tag.name_size);
+}
+
+} // namespace SimpleLog
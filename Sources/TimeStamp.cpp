@@ -0,0 +1,221 @@
+#include "../Headers/Logger.h"
+#include "LoggerPrivate.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr int64_t kNanosecondsPerSecond = 1000000000;
+
+std::atomic<TimeStampFormat> time_stamp_format_(TimeStampFormat::Default);
+std::atomic<TimeStampPrecision> time_stamp_precision_(TimeStampPrecision::Seconds);
+
+// Date and time of one second rendered once and reused by every message of that
+// second on this thread; only the fraction is formatted per message.
+struct TimeStampCache
+{
+	int64_t second = INT64_MIN;
+	TimeStampFormat format = TimeStampFormat::Default;
+	char text[40];
+	size_t size = 0;
+};
+
+void AppendDigits(char* out, uint32_t value, const size_t count)
+{
+	for (size_t i = count; i > 0; --i)
+	{
+		out[i - 1] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	}
+}
+
+// UTC calendar fields of a second since the epoch. Hand-rolled (days to civil date,
+// proleptic Gregorian) rather than gmtime_r, which may take the time zone lock and so
+// is not async-signal-safe.
+struct CivilTime
+{
+	uint32_t year;
+	uint32_t month;
+	uint32_t day;
+	uint32_t hour;
+	uint32_t minute;
+	uint32_t second;
+};
+
+CivilTime ToCivilTime(const int64_t second)
+{
+	constexpr int64_t kSecondsPerDay = 86400;
+	auto days = second / kSecondsPerDay;
+	auto time = second % kSecondsPerDay;
+	if (time < 0)
+	{
+		--days;
+		time += kSecondsPerDay;
+	}
+
+	// Eras of 400 years starting on March 1st, 0000.
+	days += 719468;
+	const auto era = (days >= 0 ? days : days - 146096) / 146097;
+	const auto day_of_era = days - era * 146097;
+	const auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	const auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	const auto month_from_march = (5 * day_of_year + 2) / 153;
+
+	CivilTime civil;
+	civil.year = static_cast<uint32_t>(year_of_era + era * 400 + (month_from_march < 10 ? 0 : 1));
+	civil.month = static_cast<uint32_t>(month_from_march < 10 ? month_from_march + 3 : month_from_march - 9);
+	civil.day = static_cast<uint32_t>(day_of_year - (153 * month_from_march + 2) / 5 + 1);
+	civil.hour = static_cast<uint32_t>(time / 3600);
+	civil.minute = static_cast<uint32_t>(time / 60 % 60);
+	civil.second = static_cast<uint32_t>(time % 60);
+	return civil;
+}
+
+void RenderSecond(TimeStampCache& cache, const int64_t second, const TimeStampFormat format)
+{
+	const auto civil = ToCivilTime(second);
+
+	char* out = cache.text;
+	if (format == TimeStampFormat::Iso8601)
+	{
+		// 2026-10-16T12:00:00
+		AppendDigits(out, civil.year, 4);
+		out[4] = '-';
+		AppendDigits(out + 5, civil.month, 2);
+		out[7] = '-';
+		AppendDigits(out + 8, civil.day, 2);
+		out[10] = 'T';
+		out += 11;
+	}
+	else
+	{
+		// (GMT)16-10-2026(12:00:00
+		std::memcpy(out, "(GMT)", 5);
+		AppendDigits(out + 5, civil.day, 2);
+		out[7] = '-';
+		AppendDigits(out + 8, civil.month, 2);
+		out[10] = '-';
+		AppendDigits(out + 11, civil.year, 4);
+		out[15] = '(';
+		out += 16;
+	}
+	AppendDigits(out, civil.hour, 2);
+	out[2] = ':';
+	AppendDigits(out + 3, civil.minute, 2);
+	out[5] = ':';
+	AppendDigits(out + 6, civil.second, 2);
+	out += 8;
+
+	cache.second = second;
+	cache.format = format;
+	cache.size = static_cast<size_t>(out - cache.text);
+}
+
+// Writes the fraction and the closing suffix that follow the cached second.
+size_t RenderFraction(char* const tail, const int64_t nanoseconds, const TimeStampFormat format)
+{
+	size_t tail_size = 0;
+	const auto digits = static_cast<size_t>(time_stamp_precision_.load(std::memory_order_relaxed));
+	if (digits != 0)
+	{
+		tail[0] = '.';
+		uint32_t fraction = static_cast<uint32_t>(nanoseconds);
+		for (size_t i = digits; i < 9; ++i)
+		{
+			fraction /= 10;
+		}
+		AppendDigits(tail + 1, fraction, digits);
+		tail_size = digits + 1;
+	}
+	tail[tail_size++] = format == TimeStampFormat::Iso8601 ? 'Z' : ')';
+	return tail_size;
+}
+
+void SplitTimeStamp(const int64_t timestamp_ns, int64_t& second, int64_t& nanoseconds)
+{
+	second = timestamp_ns / kNanosecondsPerSecond;
+	nanoseconds = timestamp_ns % kNanosecondsPerSecond;
+	if (nanoseconds < 0)
+	{
+		--second;
+		nanoseconds += kNanosecondsPerSecond;
+	}
+}
+
+} // namespace
+
+TimeStampFormat GetTimeStampFormat()
+{
+	return time_stamp_format_.load();
+}
+
+void SetTimeStampFormat(const TimeStampFormat format)
+{
+	time_stamp_format_.store(format);
+}
+
+TimeStampPrecision GetTimeStampPrecision()
+{
+	return time_stamp_precision_.load();
+}
+
+void SetTimeStampPrecision(const TimeStampPrecision precision)
+{
+	time_stamp_precision_.store(precision);
+}
+
+int64_t GetCurrentTimeStamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void AppendTimeStamp(LogBuffer& buffer, const int64_t timestamp_ns)
+{
+	const auto format = time_stamp_format_.load(std::memory_order_relaxed);
+	if (format == TimeStampFormat::EpochNanoseconds)
+	{
+		AppendInteger(buffer, timestamp_ns);
+		return;
+	}
+
+	int64_t second = 0;
+	int64_t nanoseconds = 0;
+	SplitTimeStamp(timestamp_ns, second, nanoseconds);
+	thread_local TimeStampCache cache;
+	if (cache.second != second || cache.format != format)
+	{
+		RenderSecond(cache, second, format);
+	}
+
+	// Fraction and closing suffix are patched after the cached prefix.
+	char tail[16];
+	const auto tail_size = RenderFraction(tail, nanoseconds, format);
+	buffer.Append(cache.text, cache.size);
+	buffer.Append(tail, tail_size);
+}
+
+size_t FormatTimeStamp(char* const out, const int64_t timestamp_ns)
+{
+	const auto format = time_stamp_format_.load(std::memory_order_relaxed);
+	if (format == TimeStampFormat::EpochNanoseconds)
+	{
+		return static_cast<size_t>(std::to_chars(out, out + kMaxTimeStampSize, timestamp_ns).ptr - out);
+	}
+
+	int64_t second = 0;
+	int64_t nanoseconds = 0;
+	SplitTimeStamp(timestamp_ns, second, nanoseconds);
+	TimeStampCache rendered;
+	RenderSecond(rendered, second, format);
+	std::memcpy(out, rendered.text, rendered.size);
+	return rendered.size + RenderFraction(out + rendered.size, nanoseconds, format);
+}
+
+} // namespace SimpleLog
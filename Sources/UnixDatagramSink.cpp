@@ -0,0 +1,339 @@
+#include "../Headers/UnixDatagramSink.h"
+#include "AsyncBackend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+// Datagrams handed to one sendmmsg.
+constexpr size_t kMaxBurst = 64;
+constexpr size_t kMaxDefaultDatagramSize = 64 << 10;
+constexpr size_t kMinDatagramSize = 256;
+// Longest single wait of a blocking record, so a receiver that disappears is noticed.
+constexpr int kBlockPollMs = 100;
+
+constexpr LogMessageType kMessageTypesByIndex[] = {
+	LogMessageType::Error, LogMessageType::Warning, LogMessageType::Info, LogMessageType::FatalError};
+
+} // namespace
+
+UnixDatagramSink::UnixDatagramSink(
+	const std::string& path,
+	const uint32_t message_types,
+	std::shared_ptr<const LogFormatter> formatter,
+	const UnixDatagramOptions& options)
+	: LogSink(message_types, std::move(formatter))
+	, path_(path)
+	, options_(options)
+{
+	fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+	{
+		return;
+	}
+	max_datagram_size_ = options_.max_datagram_size;
+	if (max_datagram_size_ == 0)
+	{
+		int send_buffer = 0;
+		socklen_t length = sizeof(send_buffer);
+		max_datagram_size_ = kMaxDefaultDatagramSize;
+		if (getsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &send_buffer, &length) == 0 && send_buffer > 0)
+		{
+			max_datagram_size_ = std::min(max_datagram_size_, static_cast<size_t>(send_buffer) / 4);
+		}
+	}
+	max_datagram_size_ = std::max(max_datagram_size_, kMinDatagramSize);
+	// The agent may start later: sends connect again.
+	Connect();
+}
+
+UnixDatagramSink::~UnixDatagramSink()
+{
+	if (fd_ >= 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Send(true);
+		close(fd_);
+	}
+}
+
+bool UnixDatagramSink::IsOpen() const
+{
+	return fd_ >= 0;
+}
+
+size_t UnixDatagramSink::GetMaxDatagramSize() const
+{
+	return max_datagram_size_;
+}
+
+uint64_t UnixDatagramSink::GetSentDatagrams() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return sent_datagrams_;
+}
+
+uint64_t UnixDatagramSink::GetSendCalls() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return send_calls_;
+}
+
+uint64_t UnixDatagramSink::GetDroppedRecords() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return dropped_records_;
+}
+
+void UnixDatagramSink::Write(const LogRecord& record, std::string_view text)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	Datagram discarded;
+	discarded.records[GetLogMessageTypeIndex(record.message_type)] = 1;
+	if (fd_ < 0)
+	{
+		Discard(discarded);
+		return;
+	}
+
+	// Cut records keep their newline.
+	const auto cut = text.size() > max_datagram_size_;
+	if (cut)
+	{
+		text = text.substr(0, max_datagram_size_ - 1);
+	}
+	const auto size = text.size() + (cut ? 1 : 0);
+	if (pending_bytes_ + size > options_.max_pending_bytes && !MakeRoom(lock, record.message_type, size))
+	{
+		Discard(discarded);
+		return;
+	}
+
+	if (pending_.empty() || pending_.back().data.size() + size > max_datagram_size_)
+	{
+		pending_.emplace_back();
+		if (!spare_.empty())
+		{
+			pending_.back().data.swap(spare_.back());
+			spare_.pop_back();
+		}
+	}
+	auto& datagram = pending_.back();
+	datagram.data.append(text.data(), text.size());
+	if (cut)
+	{
+		datagram.data.push_back('\n');
+	}
+	++datagram.records[GetLogMessageTypeIndex(record.message_type)];
+	pending_bytes_ += size;
+
+	if (IsAsyncLogging())
+	{
+		if (pending_.size() > options_.batch_datagrams)
+		{
+			Send(false);
+		}
+		return;
+	}
+	if (options_.sync_batch_records > 1)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (unsent_records_++ == 0)
+		{
+			first_unsent_ = now;
+		}
+		if (unsent_records_ < options_.sync_batch_records && now - first_unsent_ < options_.sync_batch_interval)
+		{
+			return;
+		}
+	}
+	unsent_records_ = 0;
+	Send(true);
+}
+
+void UnixDatagramSink::Flush()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (fd_ >= 0)
+	{
+		unsent_records_ = 0;
+		Send(true);
+	}
+}
+
+bool UnixDatagramSink::Connect()
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path_.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+	std::memcpy(address.sun_path, path_.data(), path_.size());
+	connected_ = connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+	return connected_;
+}
+
+bool UnixDatagramSink::Send(const bool all)
+{
+	auto reconnected = false;
+	for (;;)
+	{
+		const auto ready = all ? pending_.size() : pending_.size() - std::min<size_t>(pending_.size(), 1);
+		if (ready == 0)
+		{
+			return true;
+		}
+		if (!connected_ && !Connect())
+		{
+			// No agent: nothing to queue for.
+			for (size_t i = 0; i < ready; ++i)
+			{
+				DropFront();
+			}
+			return true;
+		}
+
+		mmsghdr messages[kMaxBurst] = {};
+		iovec vectors[kMaxBurst];
+		const auto count = std::min(ready, kMaxBurst);
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto& data = pending_[i].data;
+			vectors[i].iov_base = data.data();
+			vectors[i].iov_len = data.size();
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		++send_calls_;
+		const auto sent = sendmmsg(fd_, messages, static_cast<unsigned int>(count), MSG_DONTWAIT);
+		if (sent > 0)
+		{
+			for (int i = 0; i < sent; ++i)
+			{
+				auto& front = pending_.front();
+				pending_bytes_ -= front.data.size();
+				if (spare_.size() < options_.batch_datagrams)
+				{
+					front.data.clear();
+					spare_.push_back(std::move(front.data));
+				}
+				pending_.pop_front();
+			}
+			sent_datagrams_ += static_cast<uint64_t>(sent);
+			continue;
+		}
+
+		switch (errno)
+		{
+		case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+		case EWOULDBLOCK:
+#endif
+			return false;
+		case EINTR:
+			break;
+		case ECONNREFUSED:
+		case ECONNRESET:
+		case ENOTCONN:
+			// The agent restarted with a new socket: connect to it once, then give up
+			// on the datagram.
+			connected_ = false;
+			if (reconnected)
+			{
+				DropFront();
+			}
+			reconnected = true;
+			break;
+		default:
+			// Too large for the receiver, or the socket failed.
+			DropFront();
+			break;
+		}
+	}
+}
+
+void UnixDatagramSink::Discard(const Datagram& datagram)
+{
+	for (size_t index = 0; index < 4; ++index)
+	{
+		for (uint32_t i = 0; i < datagram.records[index]; ++i)
+		{
+			ReportDroppedRecord(kMessageTypesByIndex[index]);
+		}
+		dropped_records_ += datagram.records[index];
+	}
+}
+
+void UnixDatagramSink::DropFront()
+{
+	Discard(pending_.front());
+	pending_bytes_ -= pending_.front().data.size();
+	pending_.pop_front();
+}
+
+bool UnixDatagramSink::MakeRoom(
+	std::unique_lock<std::mutex>& lock,
+	const LogMessageType message_type,
+	const size_t size)
+{
+	const auto full = [this, size]()
+	{
+		return pending_bytes_ + size > options_.max_pending_bytes;
+	};
+	if (Send(true) || !full())
+	{
+		return true;
+	}
+
+	switch (GetLogOverflowPolicy(message_type))
+	{
+	case LogOverflowPolicy::DropNewest:
+		return false;
+	case LogOverflowPolicy::OverflowToHeap:
+		return true;
+	case LogOverflowPolicy::DropOldest:
+		while (!pending_.empty() && full())
+		{
+			DropFront();
+		}
+		return true;
+	case LogOverflowPolicy::Block:
+		break;
+	}
+
+	// Bounded even without a block timeout: the sink may be written by the backend
+	// thread, and an agent that stopped reading must not stall the process.
+	const auto deadline = std::min(
+		GetBlockDeadline(message_type), std::chrono::steady_clock::now() + options_.max_block_time);
+	while (full())
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+		{
+			return false;
+		}
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+		pollfd descriptor = {fd_, POLLOUT, 0};
+		// Other writers, Flush() and the getters go on meanwhile.
+		lock.unlock();
+		poll(&descriptor, 1, static_cast<int>(std::min<int64_t>(remaining + 1, kBlockPollMs)));
+		lock.lock();
+		Send(true);
+	}
+	return true;
+}
+
+} // namespace SimpleLog
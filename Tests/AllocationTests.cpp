@@ -0,0 +1,155 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+std::atomic<bool> g_count_allocations(false);
+std::atomic<size_t> g_allocations(0);
+
+} // namespace
+
+// Every form of new and delete is replaced, so memory from the runtime's own forms is
+// never released by these, nor the other way round.
+void* operator new(std::size_t size)
+{
+	if (g_count_allocations.load(std::memory_order_relaxed))
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (void* const ptr = std::malloc(size != 0 ? size : 1))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class NullBuffer : public std::streambuf
+{
+
+protected:
+	int_type overflow(int_type ch) override
+	{
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char*, std::streamsize count) override
+	{
+		return count;
+	}
+};
+
+} // namespace
+
+TEST(AllocationTest, TestSteadyStateLogDoesNotAllocate)
+{
+	NullBuffer null_buffer;
+	std::ostream null_stream(&null_buffer);
+	SetLogStream(null_stream);
+	SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Info));
+	SetLogInfos(
+		static_cast<uint32_t>(LogInfos::TimeStamp) |
+		static_cast<uint32_t>(LogInfos::ThreadId) |
+		static_cast<uint32_t>(LogInfos::FileNameWithLine));
+
+	const std::string text(100, 'x');
+	const auto log = [&text](const int i)
+	{
+		LOG_INFO << "Message " << i << " " << 2.5 << " " << text;
+	};
+
+	log(0);
+
+	g_allocations.store(0);
+	g_count_allocations.store(true);
+	for (int i = 0; i < 1000; ++i)
+	{
+		log(i);
+	}
+	g_count_allocations.store(false);
+
+	SetLogStream(std::cout);
+	EXPECT_EQ(0u, g_allocations.load());
+}
+
+TEST(AllocationTest, TestNestedLoggersShareThreadBuffer)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogInfos(0);
+	SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Info));
+
+	const auto inner = [&os]()
+	{
+		LOG_INFO << "Inner";
+		return 7;
+	};
+	LOG_INFO << "Outer " << inner() << std::hex << " " << 255;
+	LOG_INFO << 255;
+
+	SetLogStream(std::cout);
+	EXPECT_EQ("[I]$ Inner\n[I]$ Outer 7 ff\n[I]$ 255\n", os.str());
+}
+
+} // SimpleLog
@@ -0,0 +1,143 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class AsyncLoggerTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		StartAsyncLogging(16);
+	}
+
+	void TearDown() override
+	{
+		StopAsyncLogging();
+		SetLogStream(std::cout);
+		SetELogStream(std::cout);
+	}
+
+};
+
+} // namespace
+
+TEST_F(AsyncLoggerTestClass, TestFlushWritesQueuedRecords)
+{
+	std::ostringstream os;
+	std::ostringstream eos;
+	SetLogStream(os);
+	SetELogStream(eos);
+
+	EXPECT_TRUE(IsAsyncLogging());
+	LOG_INFO << "Message1";
+	LOG_WARNING << "Message2";
+	LOG_ERROR << "Message3";
+	FlushAsyncLogging();
+
+	EXPECT_EQ("[I]$ Message1\n[W]$ Message2\n", os.str());
+	EXPECT_EQ("[E]$ Message3\n", eos.str());
+}
+
+TEST_F(AsyncLoggerTestClass, TestStopDrainsQueue)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	std::string expected_string;
+	for (size_t i = 0; i < 100; ++i)
+	{
+		LOG_INFO << "Message" << i;
+		expected_string += "[I]$ Message" + std::to_string(i) + "\n";
+	}
+	StopAsyncLogging();
+
+	EXPECT_FALSE(IsAsyncLogging());
+	EXPECT_EQ(expected_string, os.str());
+
+	LOG_INFO << "Sync";
+	EXPECT_EQ(expected_string + "[I]$ Sync\n", os.str());
+}
+
+TEST_F(AsyncLoggerTestClass, TestManyProducers)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	constexpr size_t threads_count = 4;
+	constexpr size_t messages_count = 500;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < threads_count; ++t)
+	{
+		threads.emplace_back([t]()
+		{
+			for (size_t i = 0; i < messages_count; ++i)
+			{
+				LOG_INFO << t << ":" << i;
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	FlushAsyncLogging();
+
+	const auto result_string = os.str();
+	EXPECT_EQ(threads_count * messages_count, static_cast<size_t>(std::count(result_string.cbegin(), result_string.cend(), '\n')));
+	for (size_t t = 0; t < threads_count; ++t)
+	{
+		const auto last = "[I]$ " + std::to_string(t) + ":" + std::to_string(messages_count - 1) + "\n";
+		EXPECT_NE(std::string::npos, result_string.find(last));
+	}
+}
+
+TEST_F(AsyncLoggerTestClass, TestFlushRacingStop)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	constexpr size_t rounds_count = 500;
+	for (size_t round = 0; round < rounds_count; ++round)
+	{
+		std::atomic<bool> stopped(false);
+		std::thread flusher([&stopped]()
+		{
+			while (!stopped.load())
+			{
+				LOG_INFO << "Message";
+				FlushAsyncLogging();
+			}
+		});
+		std::this_thread::yield();
+		StopAsyncLogging();
+		stopped.store(true);
+		flusher.join();
+		EXPECT_FALSE(IsAsyncLogging());
+		StartAsyncLogging(16);
+	}
+}
+
+TEST(AsyncLoggerTest, TestFlushWithoutBackend)
+{
+	EXPECT_FALSE(IsAsyncLogging());
+	FlushAsyncLogging();
+	StopAsyncLogging();
+	EXPECT_FALSE(IsAsyncLogging());
+}
+
+} // SimpleLog
@@ -0,0 +1,213 @@
+#include <BatchedFileStream.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class BatchedFileStreamTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		path_ = "SimpleLoggerBatched" + std::to_string(getpid()) + ".log";
+		std::remove(path_.c_str());
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+		std::remove(path_.c_str());
+	}
+
+	std::string ReadFile() const
+	{
+		std::ifstream file(path_, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	std::string path_;
+
+};
+
+BatchedFileOptions ManualOptions()
+{
+	BatchedFileOptions options;
+	options.flush_bytes = 1 << 30;
+	options.flush_records = 1 << 30;
+	options.max_latency = std::chrono::hours(1);
+	return options;
+}
+
+} // namespace
+
+TEST_F(BatchedFileStreamTestClass, TestFlushCommitsOneBatch)
+{
+	BatchedFileStream stream(path_, ManualOptions());
+	ASSERT_TRUE(stream.IsOpen());
+	SetLogStream(stream);
+	for (int i = 0; i < 100; ++i)
+	{
+		LOG_INFO << "Message " << i;
+	}
+	EXPECT_EQ("", ReadFile());
+
+	stream.flush();
+	EXPECT_EQ(1u, stream.GetCommitCount());
+	std::string expected;
+	for (int i = 0; i < 100; ++i)
+	{
+		expected += "[I]$ Message " + std::to_string(i) + "\n";
+	}
+	EXPECT_EQ(expected, ReadFile());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestRecordCountTrigger)
+{
+	auto options = ManualOptions();
+	options.flush_records = 10;
+	BatchedFileStream stream(path_, options);
+	SetLogStream(stream);
+	for (int i = 0; i < 10; ++i)
+	{
+		LOG_INFO << "Message";
+	}
+	for (int i = 0; i < 1000 && stream.GetCommitCount() == 0; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(1u, stream.GetCommitCount());
+	EXPECT_EQ(10 * std::string("[I]$ Message\n").size(), ReadFile().size());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestLatencyTrigger)
+{
+	auto options = ManualOptions();
+	options.max_latency = std::chrono::milliseconds(10);
+	BatchedFileStream stream(path_, options);
+	SetLogStream(stream);
+	LOG_INFO << "Message";
+	for (int i = 0; i < 1000 && stream.GetCommitCount() == 0; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ("[I]$ Message\n", ReadFile());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestFatalErrorForcesCommit)
+{
+	BatchedFileStream stream(path_, ManualOptions());
+	SetLogStream(stream);
+	SetELogStream(stream);
+	LOG_INFO << "Before";
+	EXPECT_EQ("", ReadFile());
+	LOG_FATAL_ERROR << "Fatal";
+	EXPECT_EQ("[I]$ Before\n[F]$ Fatal\n", ReadFile());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestSyncCadence)
+{
+	auto options = ManualOptions();
+	options.sync_every_commits = 2;
+	BatchedFileStream stream(path_, options);
+	for (int i = 0; i < 4; ++i)
+	{
+		stream.write("Record\n", 7);
+		stream.flush();
+	}
+	EXPECT_EQ(4u, stream.GetCommitCount());
+	EXPECT_EQ(2u, stream.GetSyncCount());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestManyThreadsShareCommits)
+{
+	auto options = ManualOptions();
+	options.flush_records = 512;
+	{
+		BatchedFileStream stream(path_, options);
+		SetLogStream(stream);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([]
+			{
+				for (int i = 0; i < 2000; ++i)
+				{
+					LOG_INFO << "Message";
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		SetLogStream(std::cout);
+		stream.Close();
+		EXPECT_LT(stream.GetCommitCount(), 100u);
+	}
+	EXPECT_EQ(8000 * std::string("[I]$ Message\n").size(), ReadFile().size());
+}
+
+TEST_F(BatchedFileStreamTestClass, TestCloseWhileWriting)
+{
+	// Small batches: writers also commit themselves, from the backpressure branch.
+	auto options = ManualOptions();
+	options.flush_bytes = 64;
+	BatchedFileStream stream(path_, options);
+	std::atomic<size_t> written{0};
+	std::atomic<size_t> started{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		// Straight to the buffer: a failed ostream::write would set the shared stream
+		// state from every thread.
+		threads.emplace_back([&stream, &written, &started]
+		{
+			started.fetch_add(1);
+			while (stream.rdbuf()->sputn("Record\n", 7) == 7)
+			{
+				written.fetch_add(1);
+			}
+		});
+	}
+	while (started.load() != threads.size() || written.load() < 1000)
+	{
+		std::this_thread::yield();
+	}
+	stream.Close();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_FALSE(stream.IsOpen());
+	std::string expected;
+	for (size_t i = 0; i < written.load(); ++i)
+	{
+		expected += "Record\n";
+	}
+	EXPECT_EQ(expected, ReadFile());
+}
+
+} // SimpleLog
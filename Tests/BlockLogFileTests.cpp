@@ -0,0 +1,187 @@
+#include <BlockLogFile.h>
+#include <DeferredLog.h>
+#include <LogSink.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kBlockSize = 4 << 10;
+
+class BlockLogFileTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		path_ = "SimpleLoggerBlocks" + std::to_string(getpid()) + ".slb";
+		std::remove(path_.c_str());
+	}
+
+	void TearDown() override
+	{
+		std::remove(path_.c_str());
+	}
+
+	// Records with consecutive timestamps: i microseconds after the epoch, thread
+	// 1 + i % 2, line 100 + i % 10, an error every 100th.
+	void WriteRecords(BlockFileSink& sink, const int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const auto message = "Record " + std::to_string(i);
+			const LogRecord record{
+				i % 100 == 0 ? LogMessageType::Error : LogMessageType::Info,
+				int64_t(i) * 1000,
+				i % 2 == 0 ? "[1]" : "[2:worker]",
+				"Orders.cpp",
+				100 + i % 10,
+				message,
+				std::string_view()};
+			sink.Write(record, record.text);
+		}
+	}
+
+	std::vector<std::string> Query(const BlockLogQuery& query, const uint32_t log_infos = 0)
+	{
+		const LogInfosFormatter formatter(log_infos);
+		std::vector<std::string> lines;
+		EXPECT_TRUE(QueryBlockLog(path_, query, [&formatter, &lines](const LogRecord& record)
+		{
+			LogBuffer buffer;
+			formatter.Format(record, buffer);
+			lines.emplace_back(buffer.Data(), buffer.Size());
+		}, &stats_));
+		return lines;
+	}
+
+	std::string path_;
+	BlockLogQueryStats stats_;
+
+};
+
+} // namespace
+
+TEST_F(BlockLogFileTestClass, TestLoggedRecordsRoundTrip)
+{
+	auto sink = std::make_shared<BlockFileSink>(path_, kAllLogMessageTypes, kBlockSize);
+	ASSERT_TRUE(sink->IsOpen());
+	AddLogSink(sink);
+	LOG_INFO << "Plain " << 1;
+	LOG_WARNING.kv("user", 42).kv("name", "bob smith") << "With fields";
+	LOG_ERROR_FMT("Deferred {}", 2.5);
+	RemoveLogSink(sink);
+	sink->Close();
+
+	EXPECT_EQ(std::vector<std::string>({
+		"[I]$ Plain 1\n",
+		"[W]$ With fields user=42 name=\"bob smith\"\n",
+		"[E]$ Deferred 2.5\n"}),
+		Query(BlockLogQuery()));
+	EXPECT_TRUE(stats_.indexed);
+
+	// The full layout is rebuilt from the stored thread, file and line.
+	const auto lines = Query(BlockLogQuery(), kAllLogInfos);
+	ASSERT_EQ(3u, lines.size());
+	EXPECT_NE(std::string::npos, lines[0].find("[" + std::to_string(GetThreadNumber()) + "]"));
+	EXPECT_NE(std::string::npos, lines[0].find("[BlockLogFileTests.cpp:"));
+}
+
+TEST_F(BlockLogFileTestClass, TestTimeRangeReadsOnlyMatchingBlocks)
+{
+	{
+		BlockFileSink sink(path_, kAllLogMessageTypes, kBlockSize);
+		WriteRecords(sink, 5000);
+	}
+
+	BlockLogQuery query;
+	query.begin_ns = 2000 * 1000;
+	query.end_ns = 2099 * 1000;
+	const auto lines = Query(query);
+	ASSERT_EQ(100u, lines.size());
+	EXPECT_EQ("[E]$ Record 2000\n", lines.front());
+	EXPECT_EQ("[I]$ Record 2099\n", lines.back());
+	EXPECT_TRUE(stats_.indexed);
+	EXPECT_GT(stats_.blocks, 20u);
+	EXPECT_LE(stats_.blocks_read, 3u);
+}
+
+TEST_F(BlockLogFileTestClass, TestLevelSiteAndThreadFilters)
+{
+	{
+		BlockFileSink sink(path_, kAllLogMessageTypes, kBlockSize);
+		WriteRecords(sink, 1000);
+	}
+
+	BlockLogQuery errors;
+	errors.message_types = static_cast<uint32_t>(LogMessageType::Error);
+	const auto error_lines = Query(errors);
+	ASSERT_EQ(10u, error_lines.size());
+	EXPECT_EQ("[E]$ Record 900\n", error_lines.back());
+
+	BlockLogQuery site;
+	site.file = "Orders.cpp";
+	site.line = 103;
+	site.thread = 2;
+	const auto site_lines = Query(site);
+	ASSERT_EQ(100u, site_lines.size());
+	EXPECT_EQ("[I]$ Record 3\n", site_lines.front());
+
+	BlockLogQuery other_file;
+	other_file.file = "Payments.cpp";
+	EXPECT_TRUE(Query(other_file).empty());
+	EXPECT_EQ(0u, stats_.records);
+}
+
+TEST_F(BlockLogFileTestClass, TestUnindexedFileAndAppend)
+{
+	{
+		BlockFileSink sink(path_, kAllLogMessageTypes, kBlockSize);
+		WriteRecords(sink, 300);
+		sink.Flush();
+		// Read as a crashed process would leave it: no index yet.
+		EXPECT_EQ(300u, Query(BlockLogQuery()).size());
+		EXPECT_FALSE(stats_.indexed);
+		WriteRecords(sink, 10);
+	}
+	{
+		BlockFileSink sink(path_, kAllLogMessageTypes, kBlockSize);
+		WriteRecords(sink, 5);
+	}
+	const auto lines = Query(BlockLogQuery());
+	EXPECT_TRUE(stats_.indexed);
+	ASSERT_EQ(315u, lines.size());
+	EXPECT_EQ("[I]$ Record 299\n", lines[299]);
+	EXPECT_EQ("[E]$ Record 0\n", lines[310]);
+}
+
+TEST_F(BlockLogFileTestClass, TestRecordLargerThanBlock)
+{
+	const std::string large(3 * kBlockSize, 'x');
+	{
+		BlockFileSink sink(path_, kAllLogMessageTypes, kBlockSize);
+		WriteRecords(sink, 2);
+		const LogRecord record{LogMessageType::Info, 5000, "[1]", "Orders.cpp", 1, large, std::string_view()};
+		sink.Write(record, record.text);
+		WriteRecords(sink, 1);
+	}
+	const auto lines = Query(BlockLogQuery());
+	ASSERT_EQ(4u, lines.size());
+	EXPECT_EQ("[I]$ " + large + "\n", lines[2]);
+	EXPECT_EQ("[E]$ Record 0\n", lines[3]);
+}
+
+} // SimpleLog
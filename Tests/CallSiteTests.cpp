@@ -0,0 +1,204 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class CallSiteTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		saved_log_type_ = GetLogType();
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+	}
+
+	void TearDown() override
+	{
+		SetCallSiteEnabled("CallSiteTests.cpp", 0, true);
+		SetLogVModule("");
+		SetLogType(saved_log_type_);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	LogType saved_log_type_ = LogType::Release;
+
+};
+
+} // namespace
+
+TEST(CallSiteTest, TestPrecomputedFileName)
+{
+	static CallSite site("/some/path/File.cpp:12]", sizeof("/some/path/File.cpp") - 1, 12, LogMessageType::Info);
+	EXPECT_EQ("/some/path/File.cpp", site.GetFile());
+	EXPECT_EQ("File.cpp", site.GetFileName());
+	EXPECT_EQ("File.cpp:12]", site.GetFileNameWithLine());
+	EXPECT_EQ(12, site.GetLine());
+	EXPECT_EQ(LogMessageType::Info, site.GetMessageType());
+}
+
+TEST_F(CallSiteTestClass, TestFileNameWithLine)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogInfos(static_cast<uint32_t>(LogInfos::FileNameWithLine));
+
+	const auto line = std::to_string(__LINE__ + 1);
+	LOG_INFO << "Message";
+
+	EXPECT_EQ("[I][CallSiteTests.cpp:" + line + "]$ Message\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestDisableSingleSite)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	const auto log = [](const int i)
+	{
+		LOG_INFO << "First " << i;
+		LOG_INFO << "Second " << i;
+	};
+	const auto second_line = __LINE__ - 2;
+
+	log(1);
+	SetCallSiteEnabled("CallSiteTests.cpp", second_line, false);
+	log(2);
+	SetCallSiteEnabled("Tests/CallSiteTests.cpp", second_line, true);
+	log(3);
+
+	EXPECT_EQ("[I]$ First 1\n[I]$ Second 1\n[I]$ First 2\n[I]$ First 3\n[I]$ Second 3\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestRuleAppliesToSitesNotReachedYet)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	SetCallSiteEnabled("CallSiteTests.cpp", 0, false);
+	LOG_INFO << "Skipped";
+	SetCallSiteEnabled("sts.cpp", 0, true);
+	LOG_INFO << "Skipped too";
+	SetCallSiteEnabled("CallSiteTests.cpp", 0, true);
+	LOG_INFO << "Logged";
+
+	EXPECT_EQ("[I]$ Logged\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestLaterRuleWins)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	const auto log = [](const int i)
+	{
+		LOG_INFO << "Value " << i;
+	};
+	const auto line = __LINE__ - 2;
+
+	SetCallSiteEnabled("CallSiteTests.cpp", 0, false);
+	SetCallSiteEnabled("CallSiteTests.cpp", line, true);
+	log(1);
+	SetCallSiteEnabled("Tests/CallSiteTests.cpp", 0, false);
+	log(2);
+	// Toggling the same site replaces its rule.
+	for (int i = 0; i < 1000; ++i)
+	{
+		SetCallSiteEnabled("CallSiteTests.cpp", line, i % 2 == 0);
+	}
+	log(3);
+	SetCallSiteEnabled("CallSiteTests.cpp", line, true);
+	log(4);
+	SetCallSiteEnabled("CallSiteTests.cpp", 0, true);
+	log(5);
+
+	EXPECT_EQ("[I]$ Value 1\n[I]$ Value 4\n[I]$ Value 5\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestVModuleEnablesFilteredType)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Error));
+
+	const auto log = [](const int i)
+	{
+		LOG_INFO << "Info " << i;
+		LOG_WARNING << "Warning " << i;
+	};
+	log(1);
+	EXPECT_TRUE(SetLogVModule("Other*.cpp=info, Tests/CallSite*.cpp=warning"));
+	EXPECT_EQ("Other*.cpp=info, Tests/CallSite*.cpp=warning", GetLogVModule());
+	log(2);
+	EXPECT_TRUE(SetLogVModule("Tests/CallSite*.cpp=warning,*Site?ests.cpp=INFO"));
+	log(3);
+	EXPECT_TRUE(SetLogVModule(""));
+	log(4);
+
+	EXPECT_EQ("[W]$ Warning 2\n[I]$ Info 3\n[W]$ Warning 3\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestVModuleFiltersOutType)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetELogStream(os);
+
+	EXPECT_TRUE(SetLogVModule("Tests/*=error"));
+	LOG_INFO << "Info";
+	LOG_WARNING << "Warning";
+	LOG_ERROR << "Error";
+	EXPECT_TRUE(SetLogVModule("CallSiteTests.cpp=off"));
+	LOG_ERROR << "Off";
+	// The last matching entry wins.
+	EXPECT_TRUE(SetLogVModule("CallSiteTests.cpp=off,Call*=warning"));
+	LOG_WARNING << "Last";
+
+	EXPECT_EQ("[E]$ Error\n[W]$ Last\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestVModuleRulesAndDebugStatements)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Error));
+	EXPECT_TRUE(SetLogVModule("CallSiteTests.cpp=info"));
+
+	const auto log = []
+	{
+		LOG_INFO << "Switched";
+	};
+	const auto line = __LINE__ - 2;
+	log();
+	SetCallSiteEnabled("CallSiteTests.cpp", line, false);
+	log();
+
+	SetLogType(LogType::Release);
+	DEBUG_LOG_INFO << "Release debug";
+	SetLogType(LogType::Debug);
+	DEBUG_LOG_INFO << "Debug";
+
+	EXPECT_EQ("[I]$ Switched\n[I]$ Debug\n", os.str());
+}
+
+TEST_F(CallSiteTestClass, TestMalformedVModuleKeepsOverrides)
+{
+	EXPECT_TRUE(SetLogVModule("net/*=info"));
+	EXPECT_FALSE(SetLogVModule("db/*=verbose"));
+	EXPECT_FALSE(SetLogVModule("db/*"));
+	EXPECT_FALSE(SetLogVModule("=info"));
+	EXPECT_EQ("net/*=info", GetLogVModule());
+}
+
+} // SimpleLog
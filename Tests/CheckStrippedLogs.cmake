@@ -0,0 +1,47 @@
+# Usage: cmake -DOBJDUMP=<objdump> -DOBJECT=<FloorProbe object> -P CheckStrippedLogs.cmake
+# Verifies that statements below the compile-time floor leave no code behind.
+
+execute_process(
+	COMMAND ${OBJDUMP} -d --no-show-raw-insn ${OBJECT}
+	OUTPUT_VARIABLE disassembly
+	RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "objdump failed on ${OBJECT}")
+endif ()
+
+function(get_function_body name out_var)
+	string(REGEX MATCH "<${name}>:\n([^\n]+\n)+" body "${disassembly}")
+	if (body STREQUAL "")
+		message(FATAL_ERROR "${name} not found in ${OBJECT}")
+	endif ()
+	set(${out_var} "${body}" PARENT_SCOPE)
+endfunction()
+
+# Alignment padding after the function is not counted.
+function(count_instructions body out_var)
+	string(REGEX MATCHALL "\n +[0-9a-f]+:[^\n]+" instructions "${body}")
+	list(FILTER instructions EXCLUDE REGEX "nop")
+	list(LENGTH instructions count)
+	set(${out_var} ${count} PARENT_SCOPE)
+endfunction()
+
+get_function_body(SimpleLogProbeStripped stripped)
+count_instructions("${stripped}" stripped_count)
+message(STATUS "SimpleLogProbeStripped: ${stripped_count} instructions\n${stripped}")
+if (stripped MATCHES "call|jmp" OR stripped_count GREATER 2)
+	message(FATAL_ERROR "Logging below the floor was not compiled away")
+endif ()
+
+get_function_body(SimpleLogProbeStrippedCheck stripped_check)
+count_instructions("${stripped_check}" stripped_check_count)
+message(STATUS "SimpleLogProbeStrippedCheck: ${stripped_check_count} instructions\n${stripped_check}")
+if (stripped_check MATCHES "call")
+	message(FATAL_ERROR "Logging of CHECK_* below the floor was not compiled away")
+endif ()
+
+get_function_body(SimpleLogProbeKept kept)
+count_instructions("${kept}" kept_count)
+message(STATUS "SimpleLogProbeKept: ${kept_count} instructions")
+if (NOT kept MATCHES "call")
+	message(FATAL_ERROR "Probe is broken: logging above the floor emitted no call")
+endif ()
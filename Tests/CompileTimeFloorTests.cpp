@@ -0,0 +1,86 @@
+// Built as its own executable with a compile-time floor of Error and stripped debug
+// logs (see Tests/CMakeLists.txt).
+#include <DeferredLog.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class CompileTimeFloorTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogType(LogType::Debug);
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+		SetELogStream(std::cout);
+	}
+
+};
+
+} // namespace
+
+TEST_F(CompileTimeFloorTestClass, TestStatementsBelowFloorAreDiscarded)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetELogStream(os);
+
+	size_t calls = 0;
+	const auto count = [&calls]()
+	{
+		return ++calls;
+	};
+
+	LOG_INFO << count();
+	LOG_WARNING << count();
+	LOG_INFO_FMT("{}", count());
+	DEBUG_LOG_ERROR << count();
+	DEBUG_LOG_ERROR_FMT("{}", count());
+	EXPECT_EQ(0u, calls);
+	EXPECT_EQ("", os.str());
+
+	LOG_ERROR << count();
+	LOG_FATAL_ERROR_FMT("{}", count());
+	EXPECT_EQ(2u, calls);
+	EXPECT_EQ("[E]$ 1\n[F]$ 2\n", os.str());
+}
+
+TEST_F(CompileTimeFloorTestClass, TestChecksStillRun)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetELogStream(os);
+
+	const auto funct = [](const int value)
+	{
+		CHECK_ILOG_RETURN(value != 1, "Info", 1);
+		CHECK_DELOG_RETURN(value != 2, "Debug error", 2);
+		CHECK_ELOG_AUTO_RETURN(value != 3, 3);
+		return 0;
+	};
+
+	EXPECT_EQ(1, funct(1));
+	EXPECT_EQ(2, funct(2));
+	EXPECT_EQ(3, funct(3));
+	EXPECT_EQ(0, funct(4));
+	EXPECT_EQ("[E]$ value != 3 = false\n", os.str());
+}
+
+} // SimpleLog
@@ -0,0 +1,238 @@
+#include <DeferredLog.h>
+#include <LogSink.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+enum class TestEnum
+{
+	Value = 7
+};
+
+const std::string g_file_name("DeferredLogTests.cpp");
+
+class NullBuffer : public std::streambuf
+{
+
+protected:
+	int_type overflow(int_type ch) override
+	{
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char*, std::streamsize count) override
+	{
+		return count;
+	}
+};
+
+class CountingSink : public LogSink
+{
+public:
+	void Write(const LogRecord&, const std::string_view) override
+	{
+		count_.fetch_add(1);
+	}
+
+	size_t Count() const
+	{
+		return count_.load();
+	}
+
+private:
+	std::atomic<size_t> count_{0};
+};
+
+class DeferredLogTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogType(LogType::Debug);
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+	}
+
+	void TearDown() override
+	{
+		StopAsyncLogging();
+		SetLogStream(std::cout);
+		SetELogStream(std::cout);
+	}
+
+};
+
+} // namespace
+
+TEST_F(DeferredLogTestClass, TestSynchronousFormatting)
+{
+	std::ostringstream os;
+	std::ostringstream eos;
+	SetLogStream(os);
+	SetELogStream(eos);
+
+	const std::string name("name");
+	const char* c_name = "c_name";
+	LOG_INFO_FMT("No arguments");
+	LOG_WARNING_FMT("{} {} {} {} {}", -5, 7u, 2.5, true, 'c');
+	LOG_ERROR_FMT("{}/{}/{}/{}", name, c_name, "literal", TestEnum::Value);
+	LOG_INFO_FMT("Missing {} {}", 1);
+
+	EXPECT_EQ("[I]$ No arguments\n[W]$ -5 7 2.5 1 c\n[I]$ Missing 1 {}\n", os.str());
+	EXPECT_EQ("[E]$ name/c_name/literal/7\n", eos.str());
+}
+
+TEST_F(DeferredLogTestClass, TestNullString)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+
+	const char* null_text = nullptr;
+	LOG_INFO_FMT("{} after", null_text);
+
+	EXPECT_EQ("[I]$ (null) after\n", os.str());
+}
+
+TEST_F(DeferredLogTestClass, TestFileNameWithLine)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogInfos(static_cast<uint32_t>(LogInfos::FileNameWithLine));
+
+	const auto line = std::to_string(__LINE__ + 1);
+	DEBUG_LOG_INFO_FMT("Value {}", 1);
+	SetLogType(LogType::Release);
+	DEBUG_LOG_INFO_FMT("Skipped {}", 2);
+
+	EXPECT_EQ("[I][" + g_file_name + ":" + line + "]$ Value 1\n", os.str());
+}
+
+TEST_F(DeferredLogTestClass, TestDisabledTypeIsNotCaptured)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Error));
+
+	size_t calls = 0;
+	const auto count = [&calls]()
+	{
+		return ++calls;
+	};
+	LOG_INFO_FMT("Value {}", count());
+
+	EXPECT_EQ(0u, calls);
+	EXPECT_EQ("", os.str());
+}
+
+TEST_F(DeferredLogTestClass, TestBackendFormatting)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	StartAsyncLogging();
+
+	constexpr size_t threads_count = 4;
+	constexpr size_t messages_count = 5000;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < threads_count; ++t)
+	{
+		threads.emplace_back([t]()
+		{
+			for (size_t i = 0; i < messages_count; ++i)
+			{
+				LOG_INFO_FMT("{}:{} {}", t, i, std::string(i % 64, 'x'));
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	FlushAsyncLogging();
+
+	const auto result_string = os.str();
+	EXPECT_EQ(threads_count * messages_count, static_cast<size_t>(std::count(result_string.cbegin(), result_string.cend(), '\n')));
+	const auto last = "[I]$ 0:" + std::to_string(messages_count - 1) + " " + std::string((messages_count - 1) % 64, 'x') + "\n";
+	EXPECT_NE(std::string::npos, result_string.find(last));
+}
+
+TEST_F(DeferredLogTestClass, TestStopDrainsDeferredRecords)
+{
+	std::ostringstream os;
+	SetLogStream(os);
+	StartAsyncLogging();
+
+	LOG_INFO_FMT("Async {}", 1);
+	StopAsyncLogging();
+	LOG_INFO_FMT("Sync {}", 2);
+
+	EXPECT_EQ("[I]$ Async 1\n[I]$ Sync 2\n", os.str());
+}
+
+TEST_F(DeferredLogTestClass, TestRecordsCommittedDuringStopAreWritten)
+{
+	// Producers write concurrently once the backend stopped: the sinks must not race.
+	NullBuffer null_buffer;
+	std::ostream null_stream(&null_buffer);
+	SetLogStream(null_stream);
+	const auto sink = std::make_shared<CountingSink>();
+	AddLogSink(sink);
+	StartAsyncLogging();
+
+	// The producers stay alive after the stop, so their rings are not drained at exit.
+	constexpr size_t threads_count = 4;
+	std::atomic<bool> stop{false};
+	std::atomic<bool> done{false};
+	std::atomic<size_t> logged{0};
+	std::atomic<size_t> idle{0};
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < threads_count; ++t)
+	{
+		threads.emplace_back([&stop, &done, &logged, &idle]()
+		{
+			while (!stop.load())
+			{
+				LOG_INFO_FMT("Value {}", 1);
+				logged.fetch_add(1);
+			}
+			idle.fetch_add(1);
+			while (!done.load())
+			{
+				std::this_thread::yield();
+			}
+		});
+	}
+	while (logged.load() < 1000)
+	{
+		std::this_thread::yield();
+	}
+	StopAsyncLogging();
+	stop.store(true);
+	while (idle.load() != threads_count)
+	{
+		std::this_thread::yield();
+	}
+
+	const auto written = sink->Count();
+	done.store(true);
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	RemoveLogSink(sink);
+	EXPECT_EQ(logged.load(), written);
+}
+
+} // SimpleLog
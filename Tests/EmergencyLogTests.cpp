@@ -0,0 +1,185 @@
+#include <DeferredLog.h>
+#include <EmergencyLog.h>
+#include <FlightRecorder.h>
+#include <LogSink.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class EmergencyLogTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+		ASSERT_EQ(0, pipe2(pipe_, O_NONBLOCK | O_CLOEXEC));
+		ASSERT_TRUE(AddEmergencyLogFd(pipe_[1]));
+	}
+
+	void TearDown() override
+	{
+		RemoveEmergencyLogFds();
+		close(pipe_[0]);
+		close(pipe_[1]);
+		SetLogInfos(
+			static_cast<uint32_t>(LogInfos::ThreadId) |
+			static_cast<uint32_t>(LogInfos::FileNameWithLine) |
+			static_cast<uint32_t>(LogInfos::TimeStamp));
+		SetTimeStampFormat(TimeStampFormat::Default);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	std::string ReadEmergency()
+	{
+		std::string text;
+		char data[4096];
+		ssize_t size = 0;
+		while ((size = read(pipe_[0], data, sizeof(data))) > 0)
+		{
+			text.append(data, static_cast<size_t>(size));
+		}
+		return text;
+	}
+
+	static std::string ReadFile(const std::string& path)
+	{
+		std::ifstream in(path);
+		std::ostringstream text;
+		text << in.rdbuf();
+		return text.str();
+	}
+
+	std::ostringstream os_;
+	int pipe_[2] = {-1, -1};
+
+};
+
+} // namespace
+
+TEST_F(EmergencyLogTestClass, TestWriteEmergencyLog)
+{
+	WriteEmergencyLog(LogMessageType::Error, "a.cpp", 12, "Boom");
+	EXPECT_EQ("[E]$ Boom\n", ReadEmergency());
+
+	SetLogInfos(
+		static_cast<uint32_t>(LogInfos::ThreadId) |
+		static_cast<uint32_t>(LogInfos::FileNameWithLine) |
+		static_cast<uint32_t>(LogInfos::TimeStamp));
+	SetTimeStampFormat(TimeStampFormat::Iso8601);
+	WriteEmergencyLog(LogMessageType::FatalError, "a.cpp", 12, "Boom");
+	const std::regex expected(R"(\[F\]\[\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}Z\]\[tid \d+\]\[a\.cpp:12\]\$ Boom\n)");
+	EXPECT_TRUE(std::regex_match(ReadEmergency(), expected));
+
+	SetLogInfos(0);
+	WriteEmergencyLog(LogMessageType::Info, nullptr, 0, std::string(5000, 'x'));
+	EXPECT_EQ("[I]$ " + std::string(1024, 'x') + " [cut]\n", ReadEmergency());
+	EXPECT_TRUE(os_.str().empty());
+}
+
+TEST_F(EmergencyLogTestClass, TestFatalRecordsAreWrittenFirst)
+{
+	LOG_ERROR << "Error";
+	LOG_FATAL_ERROR << "Fatal " << 1;
+	LOG_FATAL_ERROR_FMT("Fatal {}", 2);
+	EXPECT_EQ("[F]$ Fatal 1\n[F]$ Fatal 2\n", ReadEmergency());
+	EXPECT_EQ("[E]$ Error\n[F]$ Fatal 1\n[F]$ Fatal 2\n", os_.str());
+}
+
+TEST_F(EmergencyLogTestClass, TestCrashHandlerFlushesQueuedRecords)
+{
+	const auto suffix = std::to_string(getpid());
+	const auto log_path = "SimpleLoggerCrash" + suffix + ".log";
+	const auto emergency_path = "SimpleLoggerCrash" + suffix + ".emergency";
+	const auto child = fork();
+	ASSERT_GE(child, 0);
+	if (child == 0)
+	{
+		const auto fd = open(emergency_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		RemoveEmergencyLogFds();
+		AddEmergencyLogFd(fd);
+		std::ofstream out(log_path);
+		SetLogStream(out);
+		StartAsyncLogging();
+		InstallCrashHandler();
+		for (int i = 0; i < 1000; ++i)
+		{
+			LOG_INFO << "Record " << i;
+		}
+		std::abort();
+	}
+	int status = 0;
+	ASSERT_EQ(child, waitpid(child, &status, 0));
+	EXPECT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(SIGABRT, WTERMSIG(status));
+
+	std::string expected;
+	for (int i = 0; i < 1000; ++i)
+	{
+		expected += "[I]$ Record " + std::to_string(i) + "\n";
+	}
+	EXPECT_EQ(expected, ReadFile(log_path));
+	EXPECT_EQ("[F]$ Fatal signal 6 (SIGABRT)\n", ReadFile(emergency_path));
+	std::remove(log_path.c_str());
+	std::remove(emergency_path.c_str());
+}
+
+TEST_F(EmergencyLogTestClass, TestCrashHandlerDumpsFlightRecorder)
+{
+	const auto emergency_path = "SimpleLoggerFlightCrash" + std::to_string(getpid()) + ".emergency";
+	const auto child = fork();
+	ASSERT_GE(child, 0);
+	if (child == 0)
+	{
+		const auto fd = open(emergency_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		RemoveEmergencyLogFds();
+		AddEmergencyLogFd(fd);
+		std::ostringstream dump;
+		EnableFlightRecorder(4 << 10, dump);
+		SetLogMessageTypes(static_cast<uint32_t>(LogMessageType::Error));
+		InstallCrashHandler();
+		LOG_INFO << "Text " << 1;
+		LOG_INFO_FMT("Deferred {} {}", 2, "two");
+		LOG_ERROR_FMT("Written {}", 3.5);
+		std::raise(SIGSEGV);
+		std::_Exit(0);
+	}
+	int status = 0;
+	ASSERT_EQ(child, waitpid(child, &status, 0));
+	EXPECT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(SIGSEGV, WTERMSIG(status));
+
+	EXPECT_EQ(
+		"[F]$ Fatal signal 11 (SIGSEGV)\n"
+		"[flight recorder: 3 records]\n"
+		"[I]$ Text 1\n"
+		"[I]$ Deferred 2 two\n"
+		"[E]$ Written 3.5\n"
+		"[flight recorder end]\n",
+		ReadFile(emergency_path));
+	std::remove(emergency_path.c_str());
+}
+
+} // SimpleLog
@@ -0,0 +1,179 @@
+#include <DeferredLog.h>
+#include <FlightRecorder.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class FlightRecorderTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		saved_log_type_ = GetLogType();
+		SetLogInfos(0);
+		SetLogType(LogType::Release);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		SetLogStream(os_);
+		SetELogStream(eos_);
+		EnableFlightRecorder(64 << 10, dump_);
+	}
+
+	void TearDown() override
+	{
+		DisableFlightRecorder();
+		SetLogType(saved_log_type_);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	bool FailCheck()
+	{
+		CHECK_FLOG_RETURN(false, "Check failed", false);
+		return true;
+	}
+
+	std::ostringstream os_;
+	std::ostringstream eos_;
+	std::ostringstream dump_;
+	LogType saved_log_type_ = LogType::Release;
+
+};
+
+} // namespace
+
+TEST_F(FlightRecorderTestClass, TestFilteredMessagesAreDumpedOnFatalError)
+{
+	LOG_INFO << "Filtered info " << 1;
+	DEBUG_LOG_WARNING << "Release debug";
+	LOG_ERROR << "Emitted error";
+	EXPECT_EQ("", os_.str());
+	EXPECT_EQ("", dump_.str());
+
+	LOG_FATAL_ERROR << "Fatal";
+	EXPECT_EQ("[E]$ Emitted error\n[F]$ Fatal\n", eos_.str());
+	EXPECT_EQ(
+		"[flight recorder: 4 records]\n"
+		"[I]$ Filtered info 1\n"
+		"[W]$ Release debug\n"
+		"[E]$ Emitted error\n"
+		"[F]$ Fatal\n"
+		"[flight recorder end]\n",
+		dump_.str());
+
+	// The dump empties the rings.
+	EXPECT_EQ(0u, DumpFlightRecorder());
+}
+
+TEST_F(FlightRecorderTestClass, TestCheckDumps)
+{
+	LOG_INFO << "Before check";
+	EXPECT_FALSE(FailCheck());
+	EXPECT_NE(std::string::npos, dump_.str().find("[I]$ Before check\n"));
+	EXPECT_NE(std::string::npos, dump_.str().find("Check failed"));
+	EXPECT_EQ(0u, dump_.str().find("[flight recorder: 2 records]\n"));
+}
+
+TEST_F(FlightRecorderTestClass, TestDeferredRecordsAreFormattedWhenDumped)
+{
+	const std::string text = "text";
+	LOG_INFO_FMT("Deferred {} {}", 42, text);
+	DEBUG_LOG_INFO_FMT("Debug {}", 1.5);
+	LOG_FATAL_ERROR_FMT("Fatal {}", 'x');
+	EXPECT_EQ(
+		"[flight recorder: 3 records]\n"
+		"[I]$ Deferred 42 text\n"
+		"[I]$ Debug 1.5\n"
+		"[F]$ Fatal x\n"
+		"[flight recorder end]\n",
+		dump_.str());
+}
+
+TEST_F(FlightRecorderTestClass, TestRingKeepsNewestRecords)
+{
+	EnableFlightRecorder(4 << 10, dump_);
+	constexpr int count = 1000;
+	for (int i = 0; i < count; ++i)
+	{
+		LOG_INFO << "Message " << i;
+	}
+	const auto dumped = DumpFlightRecorder();
+	EXPECT_LT(dumped, static_cast<size_t>(count));
+	EXPECT_GT(dumped, 0u);
+
+	const auto dump = dump_.str();
+	EXPECT_NE(std::string::npos, dump.find("[I]$ Message " + std::to_string(count - 1) + "\n"));
+	EXPECT_EQ(std::string::npos, dump.find("[I]$ Message 0\n"));
+	EXPECT_NE(std::string::npos, dump.find("[I]$ Message " + std::to_string(count - dumped) + "\n"));
+	EXPECT_EQ(std::string::npos, dump.find("[I]$ Message " + std::to_string(count - dumped - 1) + "\n"));
+}
+
+TEST_F(FlightRecorderTestClass, TestThreadsAreMergedByTimeStamp)
+{
+	// Two threads take turns, so their records alternate in time; both stay alive until
+	// the dump since a thread's ring goes away with it.
+	constexpr int steps = 10;
+	std::atomic<int> turn(0);
+	std::atomic<bool> dumped(false);
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < 2; ++thread)
+	{
+		threads.emplace_back([&turn, &dumped, thread]
+		{
+			for (int step = thread; step < steps; step += 2)
+			{
+				while (turn.load() != step)
+				{
+					std::this_thread::yield();
+				}
+				if (step % 4 < 2)
+				{
+					LOG_INFO << "Step " << step;
+				}
+				else
+				{
+					LOG_INFO_FMT("Step {}", step);
+				}
+				turn.store(step + 1);
+			}
+			while (!dumped.load())
+			{
+				std::this_thread::yield();
+			}
+		});
+	}
+	while (turn.load() != steps)
+	{
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(static_cast<size_t>(steps), DumpFlightRecorder());
+	dumped.store(true);
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::string expected = "[flight recorder: " + std::to_string(steps) + " records]\n";
+	for (int step = 0; step < steps; ++step)
+	{
+		expected += "[I]$ Step " + std::to_string(step) + "\n";
+	}
+	expected += "[flight recorder end]\n";
+	EXPECT_EQ(expected, dump_.str());
+}
+
+} // SimpleLog
@@ -0,0 +1,26 @@
+// Compiled into an object file, with a floor of Error and stripped debug logs, whose
+// disassembly is checked by CheckStrippedLogs.cmake.
+
+#include <DeferredLog.h>
+#include <Logger.h>
+
+extern "C" void SimpleLogProbeStripped(const int value)
+{
+	LOG_INFO << "Value " << value;
+	LOG_WARNING << "Value " << value;
+	LOG_INFO_FMT("Value {}", value);
+	DEBUG_LOG_ERROR << "Value " << value;
+	DEBUG_LOG_INFO << "Value " << value;
+}
+
+extern "C" int SimpleLogProbeStrippedCheck(const int value)
+{
+	CHECK_ILOG_RETURN(value != 0, "Zero value", 1);
+	CHECK_DELOG_RETURN(value != 1, "One value", 2);
+	return 0;
+}
+
+extern "C" void SimpleLogProbeKept(const int value)
+{
+	LOG_ERROR << "Value " << value;
+}
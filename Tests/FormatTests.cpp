@@ -0,0 +1,174 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+
+namespace FormatTestTypes
+{
+
+enum Plain
+{
+	First = 3,
+};
+
+enum class Scoped : uint8_t
+{
+	Value = 200,
+};
+
+enum class Named
+{
+	Value,
+};
+
+std::ostream& operator<<(std::ostream& os, const Named)
+{
+	return os << "Named::Value";
+}
+
+enum Streamed
+{
+	StreamedValue,
+};
+
+std::ostream& operator<<(std::ostream& os, Streamed)
+{
+	return os << "StreamedValue";
+}
+
+struct Point
+{
+	int x;
+	int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& point)
+{
+	return os << '(' << point.x << ", " << point.y << ')';
+}
+
+} // namespace FormatTestTypes
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class FormatTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		SetLogStream(os_);
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+	}
+
+	std::ostringstream os_;
+
+};
+
+template <typename T>
+std::string StreamText(const T& value)
+{
+	std::ostringstream os;
+	os << value;
+	return os.str();
+}
+
+} // namespace
+
+TEST_F(FormatTestClass, TestIntegers)
+{
+	const short s = -12;
+	const unsigned long long big = std::numeric_limits<unsigned long long>::max();
+	LOG_INFO << 0 << ' ' << s << ' ' << -2147483647 - 1 << ' ' << 42u << ' ' << big
+		<< ' ' << std::numeric_limits<int64_t>::min();
+
+	EXPECT_EQ("[I]$ 0 -12 -2147483648 42 18446744073709551615 -9223372036854775808\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestFloatingPointRoundTrips)
+{
+	LOG_INFO << 2.5 << ' ' << 0.1 << ' ' << 1.1f << ' ' << 1234567.0 << ' ' << 1e100 << ' ' << -0.0;
+
+	EXPECT_EQ("[I]$ 2.5 0.1 1.1 1234567 1e+100 -0\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestBoolAndCharacters)
+{
+	const signed char sc = 'b';
+	const unsigned char uc = 'c';
+	LOG_INFO << true << false << 'a' << sc << uc;
+
+	EXPECT_EQ("[I]$ 10abc\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestStrings)
+{
+	char text[] = "mutable";
+	char* pointer = text;
+	const std::string_view view("view text", 4);
+	LOG_INFO << "literal " << pointer << ' ' << view << ' ' << std::string("string");
+
+	EXPECT_EQ("[I]$ literal mutable view string\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestNullStrings)
+{
+	const char* null_text = nullptr;
+	char* null_pointer = nullptr;
+	LOG_INFO << null_text << ' ' << null_pointer << " after";
+
+	EXPECT_EQ("[I]$ (null) (null) after\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestPointersMatchStream)
+{
+	int value = 0;
+	const int* pointer = &value;
+	const void* null = nullptr;
+	LOG_INFO << pointer << ' ' << null;
+
+	EXPECT_EQ("[I]$ " + StreamText(pointer) + " " + StreamText(null) + "\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestEnums)
+{
+	LOG_INFO << FormatTestTypes::First << ' ' << FormatTestTypes::Scoped::Value << ' '
+		<< FormatTestTypes::Named::Value << ' ' << FormatTestTypes::StreamedValue;
+
+	EXPECT_EQ("[I]$ 3 200 Named::Value StreamedValue\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestUserTypeUsesStream)
+{
+	LOG_INFO << FormatTestTypes::Point{1, -2};
+
+	EXPECT_EQ("[I]$ (1, -2)\n", os_.str());
+}
+
+TEST_F(FormatTestClass, TestManipulatorsFallBackToStream)
+{
+	LOG_INFO << std::hex << 255 << ' ' << std::setprecision(3) << 2.0 / 3 << ' ' << std::boolalpha << true;
+	LOG_INFO << std::setw(4) << 7 << ' ' << 8;
+	LOG_INFO << 255 << ' ' << 2.0 / 3;
+
+	EXPECT_EQ("[I]$ ff 0.667 true\n[I]$    7 8\n[I]$ 255 0.6666666666666666\n", os_.str());
+}
+
+} // SimpleLog
@@ -0,0 +1,189 @@
+#include <BlockLogFile.h>
+#include <DeferredLog.h>
+#include <FlightRecorder.h>
+#include <LogContext.h>
+#include <LogSink.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+struct Point
+{
+	int x;
+	int y;
+};
+
+std::ostream& operator<<(std::ostream& stream, const Point& point)
+{
+	return stream << point.x << ", " << point.y;
+}
+
+class LogContextTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+	}
+
+	void TearDown() override
+	{
+		StopAsyncLogging();
+		DisableFlightRecorder();
+		for (const auto& sink : added_)
+		{
+			RemoveLogSink(sink);
+		}
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	std::shared_ptr<MemorySink> AddSink(std::shared_ptr<const LogFormatter> formatter)
+	{
+		auto sink = std::make_shared<MemorySink>(16, kAllLogMessageTypes, std::move(formatter));
+		AddLogSink(sink);
+		added_.push_back(sink);
+		return sink;
+	}
+
+	std::ostringstream os_;
+	std::vector<std::shared_ptr<LogSink>> added_;
+
+};
+
+} // namespace
+
+TEST_F(LogContextTestClass, TestNestedScopes)
+{
+	LOG_INFO << "Before";
+	{
+		ScopedContext request("req", 42);
+		LOG_INFO << "Request";
+		{
+			ScopedContext user("user", "bob smith");
+			ScopedContext point("at", Point{1, 2});
+			ScopedContext flag("retry", false);
+			EXPECT_EQ("req=42 user=\"bob smith\" at=\"1, 2\" retry=false", GetLogContext());
+			LOG_WARNING.kv("n", 1) << "Nested";
+		}
+		LOG_INFO << "Request again";
+	}
+	LOG_INFO << "After";
+	EXPECT_TRUE(GetLogContext().empty());
+
+	EXPECT_EQ(
+		"[I]$ Before\n"
+		"[I][req=42]$ Request\n"
+		"[W][req=42 user=\"bob smith\" at=\"1, 2\" retry=false]$ Nested n=1\n"
+		"[I][req=42]$ Request again\n"
+		"[I]$ After\n",
+		os_.str());
+}
+
+TEST_F(LogContextTestClass, TestPrefixFollowsThreadTag)
+{
+	SetLogInfos(static_cast<uint32_t>(LogInfos::ThreadId) | static_cast<uint32_t>(LogInfos::FileNameWithLine));
+	ScopedContext request("req", 7);
+	LOG_INFO << "Text";
+	LOG_INFO_FMT("Deferred {}", 1);
+
+	const auto prefix = "[I][" + std::to_string(GetThreadNumber()) + "][req=7][LogContextTests.cpp:";
+	const auto lines = os_.str();
+	EXPECT_EQ(0u, lines.find(prefix));
+	EXPECT_NE(std::string::npos, lines.find("\n" + prefix));
+}
+
+TEST_F(LogContextTestClass, TestCaptureAndRestoreOnAnotherThread)
+{
+	LogContext captured;
+	{
+		ScopedContext request("req", 42);
+		captured = CaptureLogContext();
+	}
+	EXPECT_EQ("req=42", captured.Get());
+
+	std::thread worker([&captured]()
+	{
+		ScopedContext own("worker", 1);
+		{
+			ScopedContext restore(captured);
+			ScopedContext step("step", 2);
+			LOG_INFO << "Restored";
+		}
+		LOG_INFO << "Own";
+	});
+	worker.join();
+
+	EXPECT_EQ("[I][req=42 step=2]$ Restored\n[I][worker=1]$ Own\n", os_.str());
+}
+
+TEST_F(LogContextTestClass, TestQueuedRecordsKeepProducerContext)
+{
+	auto json = AddSink(std::make_shared<JsonFormatter>(0));
+	auto logfmt = AddSink(std::make_shared<LogfmtFormatter>(0));
+	StartAsyncLogging();
+	{
+		ScopedContext request("req", 42);
+		LOG_INFO << "Text";
+		LOG_INFO_FMT("Deferred {}", 1);
+	}
+	LOG_INFO_FMT("Deferred {}", 2);
+	FlushAsyncLogging();
+
+	EXPECT_EQ(std::vector<std::string>({
+		"{\"level\":\"info\",\"ctx\":\"req=42\",\"msg\":\"Text\"}\n",
+		"{\"level\":\"info\",\"ctx\":\"req=42\",\"msg\":\"Deferred 1\"}\n",
+		"{\"level\":\"info\",\"msg\":\"Deferred 2\"}\n"}),
+		json->GetLines());
+	EXPECT_EQ(std::vector<std::string>({
+		"level=info req=42 msg=Text\n",
+		"level=info req=42 msg=\"Deferred 1\"\n",
+		"level=info msg=\"Deferred 2\"\n"}),
+		logfmt->GetLines());
+}
+
+TEST_F(LogContextTestClass, TestFlightRecorderAndBlockFile)
+{
+	const auto path = "SimpleLoggerContext" + std::to_string(getpid()) + ".slb";
+	std::remove(path.c_str());
+	std::ostringstream dump;
+	EnableFlightRecorder(64 << 10, dump);
+	auto sink = std::make_shared<BlockFileSink>(path);
+	AddLogSink(sink);
+	{
+		ScopedContext request("req", 42);
+		LOG_INFO_FMT("Deferred {}", 1);
+	}
+	RemoveLogSink(sink);
+	sink->Close();
+	DumpFlightRecorder();
+
+	EXPECT_NE(std::string::npos, dump.str().find("[I][req=42]$ Deferred 1\n"));
+	std::vector<std::string> contexts;
+	EXPECT_TRUE(QueryBlockLog(path, BlockLogQuery(), [&contexts](const LogRecord& record)
+	{
+		contexts.emplace_back(record.context);
+	}));
+	EXPECT_EQ(std::vector<std::string>({"req=42"}), contexts);
+	std::remove(path.c_str());
+}
+
+} // SimpleLog
@@ -0,0 +1,193 @@
+#include <DeferredLog.h>
+#include <LogSink.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class LogSinkTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		SetLogStream(os_);
+		SetELogStream(eos_);
+	}
+
+	void TearDown() override
+	{
+		for (const auto& sink : added_)
+		{
+			RemoveLogSink(sink);
+		}
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	template <typename Sink>
+	std::shared_ptr<Sink> Add(std::shared_ptr<Sink> sink)
+	{
+		AddLogSink(sink);
+		added_.push_back(sink);
+		return sink;
+	}
+
+	std::ostringstream os_;
+	std::ostringstream eos_;
+	std::vector<std::shared_ptr<LogSink>> added_;
+
+};
+
+} // namespace
+
+TEST_F(LogSinkTestClass, TestDefaultSinks)
+{
+	const auto sinks = GetLogSinks();
+	ASSERT_EQ(2u, sinks.size());
+	EXPECT_EQ(&os_, &GetLogStream());
+	EXPECT_EQ(&eos_, &GetELogStream());
+
+	LOG_INFO << "Info";
+	LOG_ERROR << "Error";
+
+	EXPECT_EQ("[I]$ Info\n", os_.str());
+	EXPECT_EQ("[E]$ Error\n", eos_.str());
+}
+
+TEST_F(LogSinkTestClass, TestFanOutWithMasksAndFormatters)
+{
+	const auto all = Add(std::make_shared<MemorySink>(16));
+	const auto errors = Add(std::make_shared<MemorySink>(
+		16,
+		static_cast<uint32_t>(LogMessageType::Error),
+		std::make_shared<LogInfosFormatter>(static_cast<uint32_t>(LogInfos::FileNameWithLine))));
+
+	const auto line = __LINE__ + 2;
+	LOG_INFO << "Info " << 1;
+	LOG_ERROR << "Error " << 2;
+
+	EXPECT_EQ(std::vector<std::string>({"[I]$ Info 1\n", "[E]$ Error 2\n"}), all->GetLines());
+	EXPECT_EQ(
+		std::vector<std::string>({"[E][LogSinkTests.cpp:" + std::to_string(line) + "]$ Error 2\n"}),
+		errors->GetLines());
+	EXPECT_EQ("[I]$ Info 1\n", os_.str());
+	EXPECT_EQ("[E]$ Error 2\n", eos_.str());
+}
+
+TEST_F(LogSinkTestClass, TestMemorySinkKeepsLastLines)
+{
+	const auto sink = Add(std::make_shared<MemorySink>(2));
+	for (int i = 0; i < 5; ++i)
+	{
+		LOG_WARNING << i;
+	}
+	sink->SetMessageTypes(static_cast<uint32_t>(LogMessageType::Error));
+	LOG_WARNING << "Filtered";
+
+	EXPECT_EQ(std::vector<std::string>({"[W]$ 3\n", "[W]$ 4\n"}), sink->GetLines());
+}
+
+TEST_F(LogSinkTestClass, TestRemoveSink)
+{
+	const auto sink = std::make_shared<MemorySink>(16);
+	AddLogSink(sink);
+	LOG_INFO << "First";
+	RemoveLogSink(sink);
+	LOG_INFO << "Second";
+
+	EXPECT_EQ(std::vector<std::string>({"[I]$ First\n"}), sink->GetLines());
+	EXPECT_EQ(1, sink.use_count());
+}
+
+TEST_F(LogSinkTestClass, TestFileSink)
+{
+	const auto path = "SimpleLoggerSink" + std::to_string(getpid()) + ".log";
+	std::remove(path.c_str());
+	{
+		const auto sink = Add(std::make_shared<FileSink>(path, static_cast<uint32_t>(LogMessageType::Warning)));
+		ASSERT_TRUE(sink->IsOpen());
+		LOG_INFO << "Skipped";
+		LOG_WARNING << "Written";
+		RemoveLogSink(sink);
+		added_.clear();
+	}
+	std::ifstream file(path);
+	EXPECT_EQ("[W]$ Written\n", std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+	std::remove(path.c_str());
+}
+
+TEST_F(LogSinkTestClass, TestDeferredAndAsyncRecordsReachSinks)
+{
+	const auto sink = Add(std::make_shared<MemorySink>(16));
+	LOG_INFO_FMT("Deferred {}", 1);
+	StartAsyncLogging(16);
+	LOG_INFO << "Async";
+	LOG_INFO_FMT("Deferred {}", 2);
+	FlushAsyncLogging();
+	StopAsyncLogging();
+
+	auto lines = sink->GetLines();
+	ASSERT_EQ(3u, lines.size());
+	EXPECT_EQ("[I]$ Deferred 1\n", lines[0]);
+	std::sort(lines.begin() + 1, lines.end());
+	EXPECT_EQ("[I]$ Async\n", lines[1]);
+	EXPECT_EQ("[I]$ Deferred 2\n", lines[2]);
+}
+
+TEST_F(LogSinkTestClass, TestReplaceStreamWhileLogging)
+{
+	size_t received = 0;
+	auto current = std::make_unique<std::ostringstream>();
+	SetLogStream(*current);
+
+	std::atomic<bool> stop{false};
+	std::atomic<size_t> logged{0};
+	std::thread producer([&stop, &logged]
+	{
+		while (!stop.load())
+		{
+			LOG_INFO << "Message";
+			logged.fetch_add(1);
+		}
+	});
+
+	// Every replaced stream is destroyed right away: no record may still be in flight.
+	for (int i = 0; i < 200; ++i)
+	{
+		auto next = std::make_unique<std::ostringstream>();
+		SetLogStream(*next);
+		const auto text = current->str();
+		received += static_cast<size_t>(std::count(text.cbegin(), text.cend(), '\n'));
+		current = std::move(next);
+	}
+	stop.store(true);
+	producer.join();
+	SetLogStream(os_);
+	const auto text = current->str();
+	received += static_cast<size_t>(std::count(text.cbegin(), text.cend(), '\n'));
+
+	EXPECT_EQ(logged.load(), received);
+}
+
+} // SimpleLog
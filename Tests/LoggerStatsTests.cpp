@@ -0,0 +1,227 @@
+#include <DeferredLog.h>
+#include <LogSink.h>
+#include <LoggerStats.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class LoggerStatsTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		saved_log_type_ = GetLogType();
+		// Off by default; these tests check the suppressed counters.
+		EXPECT_FALSE(IsSuppressedCountingEnabled());
+		SetSuppressedCountingEnabled(true);
+		SetLogInfos(0);
+		SetLogType(LogType::Debug);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+		ResetLoggerStats();
+	}
+
+	void TearDown() override
+	{
+		if (sink_ != nullptr)
+		{
+			RemoveLogSink(sink_);
+		}
+		SetLoggerTimingEnabled(false);
+		SetSuppressedCountingEnabled(false);
+		SetCallSiteEnabled("LoggerStatsTests.cpp", 0, true);
+		SetLogType(saved_log_type_);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	const LogSinkStats* FindSink(const LoggerStats& stats) const
+	{
+		const auto it = std::find_if(stats.sinks.cbegin(), stats.sinks.cend(), [this](const LogSinkStats& sink_stats)
+		{
+			return sink_stats.sink == sink_;
+		});
+		return it == stats.sinks.cend() ? nullptr : &*it;
+	}
+
+	std::ostringstream os_;
+	std::shared_ptr<MemorySink> sink_;
+	LogType saved_log_type_ = LogType::Release;
+
+};
+
+} // namespace
+
+TEST_F(LoggerStatsTestClass, TestEmittedAndSuppressed)
+{
+	SetLogMessageTypes(kAllLogMessageTypes & ~static_cast<uint32_t>(LogMessageType::Info));
+	LOG_INFO << "Filtered";
+	LOG_INFO_FMT("Filtered {}", 1);
+	LOG_ERROR << "Error";
+	LOG_WARNING_FMT("Warning {}", 2);
+	SetLogType(LogType::Release);
+	DEBUG_LOG_WARNING << "Release debug";
+
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Info).emitted);
+	EXPECT_EQ(2u, stats.Get(LogMessageType::Info).suppressed);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Error).emitted);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Error).suppressed);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).emitted);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).suppressed);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::FatalError).emitted);
+}
+
+TEST_F(LoggerStatsTestClass, TestRateLimitedAndDisabledSites)
+{
+	for (int i = 0; i < 7; ++i)
+	{
+		LOG_INFO_EVERY_N(3) << "Message " << i;
+	}
+	const auto log = []
+	{
+		LOG_WARNING << "Site";
+	};
+	const auto line = __LINE__ - 2;
+	log();
+	SetCallSiteEnabled("LoggerStatsTests.cpp", line, false);
+	log();
+
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(3u, stats.Get(LogMessageType::Info).emitted);
+	EXPECT_EQ(4u, stats.Get(LogMessageType::Info).suppressed);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).emitted);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).suppressed);
+}
+
+TEST_F(LoggerStatsTestClass, TestSuppressedCountingDisabled)
+{
+	EXPECT_TRUE(IsSuppressedCountingEnabled());
+	SetSuppressedCountingEnabled(false);
+	// The filter setters rewrite the config word but keep its flags.
+	SetLogType(LogType::Release);
+	SetLogMessageTypes(kAllLogMessageTypes & ~static_cast<uint32_t>(LogMessageType::Info));
+	EXPECT_FALSE(IsSuppressedCountingEnabled());
+	EXPECT_EQ(LogType::Release, GetLogType());
+	EXPECT_EQ(kAllLogMessageTypes & ~static_cast<uint32_t>(LogMessageType::Info), GetLogMessageTypes());
+
+	LOG_INFO << "Filtered";
+	LOG_INFO_FMT("Filtered {}", 1);
+	DEBUG_LOG_ERROR << "Release debug";
+	for (int i = 0; i < 3; ++i)
+	{
+		LOG_WARNING_FIRST_N(1) << "Message " << i;
+	}
+	auto stats = GetLoggerStats();
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Info).suppressed);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Error).suppressed);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Warning).suppressed);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).emitted);
+
+	SetSuppressedCountingEnabled(true);
+	LOG_INFO << "Filtered";
+	stats = GetLoggerStats();
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Info).suppressed);
+}
+
+TEST_F(LoggerStatsTestClass, TestBytesAndReset)
+{
+	LOG_INFO << "abc";
+	LOG_ERROR_FMT("{}", 12345);
+	EXPECT_EQ("[I]$ abc\n[E]$ 12345\n", os_.str());
+	EXPECT_EQ(os_.str().size(), GetLoggerStats().bytes);
+
+	ResetLoggerStats();
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(0u, stats.bytes);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Info).emitted);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Error).emitted);
+}
+
+TEST_F(LoggerStatsTestClass, TestSinkStats)
+{
+	sink_ = std::make_shared<MemorySink>(16, static_cast<uint32_t>(LogMessageType::Warning));
+	AddLogSink(sink_);
+	LOG_WARNING << "One";
+	LOG_WARNING << "Two";
+	LOG_INFO << "Not for the sink";
+
+	const auto stats = GetLoggerStats();
+	const auto* const sink_stats = FindSink(stats);
+	ASSERT_NE(nullptr, sink_stats);
+	EXPECT_EQ(2u, sink_stats->records);
+	EXPECT_EQ(2 * std::string("[W]$ One\n").size(), sink_stats->bytes);
+	EXPECT_EQ(0u, sink_stats->write_ns);
+
+	// Sink counters survive a reset.
+	ResetLoggerStats();
+	EXPECT_EQ(2u, FindSink(GetLoggerStats())->records);
+}
+
+TEST_F(LoggerStatsTestClass, TestTiming)
+{
+	sink_ = std::make_shared<MemorySink>(16);
+	AddLogSink(sink_);
+	EXPECT_FALSE(IsLoggerTimingEnabled());
+	LOG_INFO << "Untimed";
+	auto stats = GetLoggerStats();
+	EXPECT_EQ(0u, stats.infos_ns);
+	EXPECT_EQ(0u, stats.format_ns);
+
+	SetLoggerTimingEnabled(true);
+	for (int i = 0; i < 100; ++i)
+	{
+		LOG_INFO << "Timed " << i << ' ' << 1.5 * i;
+		LOG_INFO_FMT("Timed {} {}", i, 1.5 * i);
+	}
+	stats = GetLoggerStats();
+	EXPECT_GT(stats.infos_ns, 0u);
+	EXPECT_GT(stats.format_ns, 0u);
+	EXPECT_GT(FindSink(stats)->write_ns, 0u);
+}
+
+TEST_F(LoggerStatsTestClass, TestExitedThreadsAreCounted)
+{
+	std::thread thread([]
+	{
+		for (int i = 0; i < 5; ++i)
+		{
+			LOG_WARNING << "From thread " << i;
+		}
+	});
+	thread.join();
+	EXPECT_EQ(5u, GetLoggerStats().Get(LogMessageType::Warning).emitted);
+}
+
+TEST_F(LoggerStatsTestClass, TestQueueStats)
+{
+	EXPECT_EQ(0u, GetLoggerStats().queue.capacity);
+	StartAsyncLogging(64);
+	for (int i = 0; i < 1000; ++i)
+	{
+		LOG_INFO << "Queued " << i;
+	}
+	auto stats = GetLoggerStats();
+	EXPECT_EQ(64u, stats.queue.capacity);
+	EXPECT_LE(stats.queue.depth, stats.queue.capacity);
+	FlushAsyncLogging();
+	EXPECT_EQ(0u, GetLoggerStats().queue.depth);
+	StopAsyncLogging();
+
+	stats = GetLoggerStats();
+	EXPECT_EQ(0u, stats.queue.capacity);
+	EXPECT_EQ(1000u, stats.Get(LogMessageType::Info).emitted);
+}
+
+} // SimpleLog
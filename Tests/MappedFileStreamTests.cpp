@@ -0,0 +1,198 @@
+#include <Logger.h>
+#include <MappedFileStream.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class MappedFileStreamTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		path_ = "SimpleLoggerMapped" + std::to_string(getpid()) + ".log";
+		std::remove(path_.c_str());
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+		std::remove(path_.c_str());
+	}
+
+	std::string ReadFile() const
+	{
+		std::ifstream file(path_, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	std::string path_;
+
+};
+
+} // namespace
+
+TEST_F(MappedFileStreamTestClass, TestWriteAndClose)
+{
+	{
+		MappedFileStream stream(path_, 4096);
+		ASSERT_TRUE(stream.IsOpen());
+		SetLogStream(stream);
+		for (int i = 0; i < 500; ++i)
+		{
+			LOG_INFO << "Message " << i;
+		}
+		SetLogStream(std::cout);
+	}
+
+	std::string expected;
+	for (int i = 0; i < 500; ++i)
+	{
+		expected += "[I]$ Message " + std::to_string(i) + "\n";
+	}
+	EXPECT_EQ(expected, ReadFile());
+}
+
+TEST_F(MappedFileStreamTestClass, TestAppendsToExistingFile)
+{
+	{
+		MappedFileStream stream(path_);
+		stream.write("First\n", 6);
+	}
+	{
+		MappedFileStream stream(path_);
+		EXPECT_EQ(6u, stream.Size());
+		stream.write("Second\n", 7);
+	}
+
+	EXPECT_EQ("First\nSecond\n", ReadFile());
+}
+
+TEST_F(MappedFileStreamTestClass, TestManyThreads)
+{
+	MappedFileStream stream(path_, 4096);
+	SetLogStream(stream);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([t]
+		{
+			for (int i = 0; i < 1000; ++i)
+			{
+				LOG_INFO << "Thread " << t << " message " << i;
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	SetLogStream(std::cout);
+	stream.Close();
+
+	std::string recovered;
+	EXPECT_EQ(4000u, RecoverMappedLog(path_, recovered));
+	EXPECT_EQ(ReadFile(), recovered);
+}
+
+TEST_F(MappedFileStreamTestClass, TestCloseWhileWriting)
+{
+	MappedFileStream stream(path_, 4096);
+	std::atomic<size_t> written{0};
+	std::atomic<size_t> started{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		// Straight to the buffer: a failed ostream::write would set the shared stream
+		// state from every thread.
+		threads.emplace_back([&stream, &written, &started]
+		{
+			started.fetch_add(1);
+			while (stream.rdbuf()->sputn("Record\n", 7) == 7)
+			{
+				written.fetch_add(1);
+			}
+		});
+	}
+	while (started.load() != threads.size() || written.load() < 1000)
+	{
+		std::this_thread::yield();
+	}
+	stream.Close();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_FALSE(stream.IsOpen());
+	std::string expected;
+	for (size_t i = 0; i < written.load(); ++i)
+	{
+		expected += "Record\n";
+	}
+	EXPECT_EQ(expected, ReadFile());
+}
+
+TEST_F(MappedFileStreamTestClass, TestRecoverAfterCrash)
+{
+	const auto child = fork();
+	ASSERT_NE(-1, child);
+	if (child == 0)
+	{
+		// Leaves the pre-sized chunk behind without trimming it.
+		auto* const stream = new MappedFileStream(path_, 4096);
+		stream->write("Before crash\n", 13);
+		stream->write("Torn", 4);
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	EXPECT_EQ(4096u, ReadFile().size());
+
+	std::string recovered;
+	EXPECT_EQ(1u, RecoverMappedLog(path_, recovered));
+	EXPECT_EQ("Before crash\n", recovered);
+
+	{
+		MappedFileStream stream(path_);
+		stream.write("After crash\n", 12);
+	}
+	EXPECT_EQ("Before crash\nAfter crash\n", ReadFile());
+}
+
+TEST_F(MappedFileStreamTestClass, TestRecoverSkipsUnwrittenRecords)
+{
+	{
+		std::ofstream file(path_, std::ios::binary);
+		const char data[] = "First\nTo\0\0\0\0Second\n\0\0\0\0Third\nPartial\0\0";
+		file.write(data, sizeof(data) - 1);
+	}
+
+	std::string recovered;
+	EXPECT_EQ(3u, RecoverMappedLog(path_, recovered));
+	EXPECT_EQ("First\nSecond\nThird\n", recovered);
+	EXPECT_EQ(6u, FindMappedLogEnd("First\nPart", 10));
+}
+
+} // SimpleLog
@@ -0,0 +1,212 @@
+#include <DeferredLog.h>
+#include <LogSink.h>
+#include <LoggerStats.h>
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+constexpr size_t kQueueSize = 8;
+
+// Holds the backend in its first Write until Open(); later writes pass through.
+class GateSink : public LogSink
+{
+public:
+	void Write(const LogRecord&, const std::string_view) override
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (entered_)
+		{
+			return;
+		}
+		entered_ = true;
+		cv_.notify_all();
+		cv_.wait(lock, [this]() { return open_; });
+	}
+
+	void WaitEntered()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this]() { return entered_; });
+	}
+
+	void Open()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		open_ = true;
+		cv_.notify_all();
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool entered_ = false;
+	bool open_ = false;
+};
+
+class OverflowPolicyTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+		ResetLoggerStats();
+		gate_ = std::make_shared<GateSink>();
+		AddLogSink(gate_);
+		StartAsyncLogging(kQueueSize);
+	}
+
+	void TearDown() override
+	{
+		gate_->Open();
+		StopAsyncLogging();
+		RemoveLogSink(gate_);
+		for (const auto type : {LogMessageType::Error, LogMessageType::Warning, LogMessageType::Info})
+		{
+			SetLogOverflowPolicy(type, LogOverflowPolicy::Block);
+		}
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	// Leaves the backend stuck in the sink with an empty queue.
+	void HoldBackend()
+	{
+		LOG_INFO << "Held";
+		gate_->WaitEntered();
+	}
+
+	static std::string Lines(const char* const prefix, const size_t begin, const size_t end)
+	{
+		std::string lines;
+		for (auto i = begin; i < end; ++i)
+		{
+			lines += std::string(prefix) + std::to_string(i) + "\n";
+		}
+		return lines;
+	}
+
+	std::ostringstream os_;
+	std::shared_ptr<GateSink> gate_;
+
+};
+
+} // namespace
+
+TEST_F(OverflowPolicyTestClass, TestDropNewest)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropNewest);
+	EXPECT_EQ(LogOverflowPolicy::DropNewest, GetLogOverflowPolicy(LogMessageType::Info));
+	HoldBackend();
+	for (size_t i = 0; i < kQueueSize + 4; ++i)
+	{
+		LOG_INFO << "Message " << i;
+	}
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(4u, stats.Get(LogMessageType::Info).dropped);
+	EXPECT_EQ(kQueueSize, stats.queue.depth);
+	EXPECT_GE(stats.queue.full_waits, 4u);
+
+	gate_->Open();
+	StopAsyncLogging();
+	EXPECT_EQ(
+		"[I]$ Held\n" + Lines("[I]$ Message ", 0, kQueueSize) + "[W]$ 4 messages dropped (info 4)\n",
+		os_.str());
+}
+
+TEST_F(OverflowPolicyTestClass, TestDropOldest)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropOldest);
+	SetLogOverflowPolicy(LogMessageType::Warning, LogOverflowPolicy::DropOldest);
+	HoldBackend();
+	for (size_t i = 0; i < kQueueSize + 3; ++i)
+	{
+		LOG_INFO << "Message " << i;
+	}
+	LOG_WARNING << "Newest";
+	EXPECT_EQ(4u, GetLoggerStats().Get(LogMessageType::Info).dropped);
+
+	// Flush accounts for the records popped by producers.
+	gate_->Open();
+	FlushAsyncLogging();
+	EXPECT_EQ(
+		"[I]$ Held\n" + Lines("[I]$ Message ", 4, kQueueSize + 3) + "[W]$ Newest\n",
+		os_.str());
+}
+
+TEST_F(OverflowPolicyTestClass, TestOverflowToHeap)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::OverflowToHeap);
+	HoldBackend();
+	for (size_t i = 0; i < 3 * kQueueSize; ++i)
+	{
+		LOG_INFO << "Message " << i;
+	}
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(2 * kQueueSize, stats.queue.overflow);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Info).dropped);
+
+	gate_->Open();
+	FlushAsyncLogging();
+	EXPECT_EQ("[I]$ Held\n" + Lines("[I]$ Message ", 0, 3 * kQueueSize), os_.str());
+	EXPECT_EQ(0u, GetLoggerStats().queue.overflow);
+}
+
+TEST_F(OverflowPolicyTestClass, TestBlockTimesOutToSynchronousWrite)
+{
+	SetLogOverflowPolicy(LogMessageType::Error, LogOverflowPolicy::Block, std::chrono::milliseconds(1));
+	HoldBackend();
+	for (size_t i = 0; i < kQueueSize; ++i)
+	{
+		LOG_ERROR << "Queued " << i;
+	}
+	LOG_ERROR << "Synchronous";
+	EXPECT_EQ("[I]$ Held\n[E]$ Synchronous\n", os_.str());
+
+	gate_->Open();
+	StopAsyncLogging();
+	EXPECT_EQ("[I]$ Held\n[E]$ Synchronous\n" + Lines("[E]$ Queued ", 0, kQueueSize), os_.str());
+	const auto stats = GetLoggerStats();
+	EXPECT_EQ(kQueueSize + 1, stats.Get(LogMessageType::Error).emitted);
+	EXPECT_EQ(0u, stats.Get(LogMessageType::Error).dropped);
+}
+
+TEST_F(OverflowPolicyTestClass, TestDeferredRingDropsNewest)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropNewest);
+	HoldBackend();
+	// Far more than the thread's ring of deferred records holds.
+	constexpr size_t count = 50000;
+	for (size_t i = 0; i < count; ++i)
+	{
+		LOG_INFO_FMT("Deferred {}", i);
+	}
+	const auto dropped = GetLoggerStats().Get(LogMessageType::Info).dropped;
+	EXPECT_GT(dropped, 0u);
+	EXPECT_LT(dropped, count);
+
+	gate_->Open();
+	StopAsyncLogging();
+	const auto stats = GetLoggerStats();
+	// The held record, the written ones, and the drop report.
+	EXPECT_EQ(1 + count - dropped, stats.Get(LogMessageType::Info).emitted);
+	EXPECT_EQ(1u, stats.Get(LogMessageType::Warning).emitted);
+	EXPECT_NE(
+		std::string::npos,
+		os_.str().find("[W]$ " + std::to_string(dropped) + " messages dropped (info " + std::to_string(dropped) + ")\n"));
+}
+
+} // SimpleLog
@@ -0,0 +1,158 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class RateLimitedLogTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		saved_log_type_ = GetLogType();
+		SetLogInfos(0);
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		SetLogStream(os_);
+		SetELogStream(os_);
+	}
+
+	void TearDown() override
+	{
+		SetLogType(saved_log_type_);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	std::ostringstream os_;
+	LogType saved_log_type_ = LogType::Release;
+
+};
+
+size_t CountLines(const std::string& text)
+{
+	return static_cast<size_t>(std::count(text.cbegin(), text.cend(), '\n'));
+}
+
+} // namespace
+
+TEST_F(RateLimitedLogTestClass, TestEveryN)
+{
+	for (int i = 0; i < 7; ++i)
+	{
+		LOG_INFO_EVERY_N(3) << "Message " << i;
+	}
+
+	EXPECT_EQ("[I]$ Message 0\n[I]$ [suppressed 2] Message 3\n[I]$ [suppressed 2] Message 6\n", os_.str());
+}
+
+TEST_F(RateLimitedLogTestClass, TestFirstN)
+{
+	for (int i = 0; i < 5; ++i)
+	{
+		LOG_WARNING_FIRST_N(2) << "Message " << i;
+	}
+
+	EXPECT_EQ("[W]$ Message 0\n[W]$ Message 1\n", os_.str());
+}
+
+TEST_F(RateLimitedLogTestClass, TestEveryT)
+{
+	const auto log = [](const int i)
+	{
+		LOG_ERROR_EVERY_T(0.05) << "Message " << i;
+	};
+
+	log(0);
+	log(1);
+	log(2);
+	std::this_thread::sleep_for(std::chrono::milliseconds(60));
+	log(3);
+
+	EXPECT_EQ("[E]$ Message 0\n[E]$ [suppressed 2] Message 3\n", os_.str());
+}
+
+TEST_F(RateLimitedLogTestClass, TestSampled)
+{
+	for (int i = 0; i < 1000; ++i)
+	{
+		LOG_INFO_SAMPLED(1.0) << "Always";
+		LOG_INFO_SAMPLED(0.0) << "Never";
+	}
+	EXPECT_EQ(1000u, CountLines(os_.str()));
+	EXPECT_EQ(std::string::npos, os_.str().find("Never"));
+
+	os_.str("");
+	for (int i = 0; i < 10000; ++i)
+	{
+		LOG_INFO_SAMPLED(0.1) << "Sometimes";
+	}
+	const auto lines = CountLines(os_.str());
+	EXPECT_GT(lines, 700u);
+	EXPECT_LT(lines, 1300u);
+}
+
+TEST_F(RateLimitedLogTestClass, TestSuppressedArgumentsNotEvaluated)
+{
+	int evaluated = 0;
+	for (int i = 0; i < 10; ++i)
+	{
+		LOG_INFO_FIRST_N(1) << ++evaluated;
+	}
+
+	EXPECT_EQ(1, evaluated);
+}
+
+TEST_F(RateLimitedLogTestClass, TestDebugVariants)
+{
+	SetLogType(LogType::Release);
+	for (int i = 0; i < 4; ++i)
+	{
+		DEBUG_LOG_INFO_EVERY_N(2) << "Release " << i;
+	}
+	SetLogType(LogType::Debug);
+	for (int i = 0; i < 4; ++i)
+	{
+		DEBUG_LOG_INFO_EVERY_N(2) << "Debug " << i;
+	}
+
+	EXPECT_EQ("[I]$ Debug 0\n[I]$ [suppressed 1] Debug 2\n", os_.str());
+}
+
+TEST_F(RateLimitedLogTestClass, TestEveryNFromManyThreads)
+{
+	// The backend thread is the only writer of os_.
+	StartAsyncLogging(64);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([]
+		{
+			for (int i = 0; i < 1000; ++i)
+			{
+				LOG_INFO_EVERY_N(10) << "Message";
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	StopAsyncLogging();
+
+	EXPECT_EQ(400u, CountLines(os_.str()));
+}
+
+} // SimpleLog
@@ -0,0 +1,186 @@
+#include <LogSink.h>
+#include <Logger.h>
+#include <SharedMemoryLog.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class SharedMemoryLogTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+		prefix_ = "/simplelog-tests-" + std::to_string(getpid());
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+		// Unlinks whatever a failed test left behind.
+		SharedLogCollector collector(prefix_);
+		collector.Poll([](const SharedLogRecord&) {});
+	}
+
+	static void Write(SharedMemorySink& sink, const int64_t timestamp_ns, const std::string& text)
+	{
+		const LogRecord record{LogMessageType::Info, timestamp_ns, "[1]", "a.cpp", 1, text, text};
+		sink.Write(record, record.text);
+	}
+
+	std::vector<std::string> Collect(SharedLogCollector& collector)
+	{
+		std::vector<std::string> texts;
+		collector.Poll([&texts](const SharedLogRecord& record)
+		{
+			texts.emplace_back(record.text);
+		});
+		return texts;
+	}
+
+	std::ostringstream os_;
+	std::string prefix_;
+
+};
+
+} // namespace
+
+TEST_F(SharedMemoryLogTestClass, TestLoggedRecordsReachCollector)
+{
+	auto sink = std::make_shared<SharedMemorySink>(prefix_);
+	ASSERT_TRUE(sink->IsOpen());
+	EXPECT_EQ(prefix_ + "." + std::to_string(getpid()), sink->GetName());
+	AddLogSink(sink);
+	LOG_INFO << "First";
+	LOG_WARNING.kv("n", 2) << "Second";
+	RemoveLogSink(sink);
+
+	SharedLogCollector collector(prefix_);
+	int32_t pid = 0;
+	std::vector<std::string> texts;
+	EXPECT_EQ(2u, collector.Poll([&pid, &texts](const SharedLogRecord& record)
+	{
+		pid = record.pid;
+		texts.emplace_back(record.text);
+	}));
+	EXPECT_EQ(std::vector<std::string>({"[I]$ First\n", "[W]$ Second n=2\n"}), texts);
+	EXPECT_EQ(getpid(), pid);
+	EXPECT_EQ(1u, collector.GetStats().rings);
+
+	// A closed ring is unlinked once drained.
+	sink.reset();
+	EXPECT_TRUE(Collect(collector).empty());
+	EXPECT_EQ(0u, collector.GetStats().rings);
+}
+
+TEST_F(SharedMemoryLogTestClass, TestCrashedProcessRecordsAreCollected)
+{
+	const auto child = fork();
+	ASSERT_GE(child, 0);
+	if (child == 0)
+	{
+		// Never destroyed, as in a crash.
+		auto* const sink = new SharedMemorySink(prefix_);
+		for (int i = 0; i < 3; ++i)
+		{
+			Write(*sink, i, "Child " + std::to_string(i) + "\n");
+		}
+		_exit(0);
+	}
+	int status = 0;
+	ASSERT_EQ(child, waitpid(child, &status, 0));
+
+	SharedLogCollector collector(prefix_);
+	EXPECT_EQ(std::vector<std::string>({"Child 0\n", "Child 1\n", "Child 2\n"}), Collect(collector));
+	EXPECT_EQ(0u, collector.GetStats().rings);
+	EXPECT_EQ(0u, collector.GetStats().lost);
+}
+
+TEST_F(SharedMemoryLogTestClass, TestFullRingDropsAndRecovers)
+{
+	SharedMemorySink sink(prefix_, 64 << 10);
+	const std::string text(1000, 'x');
+	for (int i = 0; i < 100; ++i)
+	{
+		Write(sink, i, text);
+	}
+	const auto dropped = sink.GetDroppedRecords();
+	EXPECT_GT(dropped, 0u);
+
+	SharedLogCollector collector(prefix_);
+	EXPECT_EQ(100 - dropped, Collect(collector).size());
+	EXPECT_EQ(dropped, collector.GetStats().dropped);
+
+	// Padding at the end of the ring, then records from its start.
+	for (int i = 0; i < 50; ++i)
+	{
+		Write(sink, i, text);
+	}
+	EXPECT_EQ(dropped, sink.GetDroppedRecords());
+	EXPECT_EQ(50u, Collect(collector).size());
+}
+
+TEST_F(SharedMemoryLogTestClass, TestConcurrentProducers)
+{
+	SharedMemorySink sink(prefix_, 1 << 20);
+	SharedLogCollector collector(prefix_);
+	constexpr int threads_count = 4;
+	constexpr int records_count = 2000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threads_count; ++t)
+	{
+		threads.emplace_back([&sink, t]()
+		{
+			for (int i = 0; i < records_count; ++i)
+			{
+				Write(sink, i, std::to_string(t) + ":" + std::to_string(i) + "\n");
+			}
+		});
+	}
+
+	std::vector<int> next(threads_count, 0);
+	size_t received = 0;
+	bool ordered = true;
+	const auto check = [&next, &received, &ordered](const SharedLogRecord& record)
+	{
+		const auto colon = record.text.find(':');
+		const auto t = std::stoi(std::string(record.text.substr(0, colon)));
+		const auto i = std::stoi(std::string(record.text.substr(colon + 1)));
+		ordered = ordered && i == next[t];
+		next[t] = i + 1;
+		++received;
+	};
+	while (received + sink.GetDroppedRecords() < size_t{threads_count} * records_count)
+	{
+		collector.Poll(check);
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	collector.Poll(check);
+
+	EXPECT_EQ(0u, sink.GetDroppedRecords());
+	EXPECT_EQ(size_t{threads_count} * records_count, received);
+	EXPECT_TRUE(ordered);
+}
+
+} // SimpleLog
@@ -25,7 +25,7 @@ private:
 	const std::string what_;
 };
 
-const std::string g_file_name(__FILE__);
+const std::string g_file_name("SimpleLogTests.cpp");
 
 void GetTimeStamp(char buffer1[64], char buffer2[64])
 {
@@ -42,6 +42,20 @@ void GetTimeStamp(char buffer1[64], char buffer2[64])
 	}
 }
 
+// The message of a failed check is written in the function itself.
+void g(const int x)
+{
+	CHECK_ELOG_RETURN(x > 0, "in " << __func__);
+}
+
+int h(const std::pair<int, int>& pair)
+{
+	const auto [first, second] = pair;
+	CHECK_ELOG_RETURN(first <= second, "first = " << first << ", second = " << second, 0);
+	CHECK_THROW(first != second, std::string("in ") + __func__);
+	return second - first;
+}
+
 class LoggerTestClass : public ::testing::Test
 {
 
@@ -138,7 +152,7 @@ TEST(LoggerTest, TestILoggerWithThreadInfo)
 		logger << "Message Test";
 	}
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 	const std::string expected_string("[I][" + os_thread.str() + "]$ Message Test\n");
 	EXPECT_EQ(expected_string, os.str());
 }
@@ -178,7 +192,7 @@ TEST(LoggerTest, TestELoggerWithAllInfo)
 	GetTimeStamp(buffer1, buffer2);
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 
 	const std::string expected_string1("[W][(GMT)" + std::string(buffer1) + "][" + os_thread.str() +"][FileName:32]$ Message Test\n");
 	const std::string expected_string2("[W][(GMT)" + std::string(buffer2) + "][" + os_thread.str() +"][FileName:32]$ Message Test\n");
@@ -202,7 +216,7 @@ TEST_F(LoggerTestClass, TestEMacros)
 	DEBUG_LOG_ERROR << "Some message debug";
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 	std::string expected_string("[E][" + os_thread.str() +"][" + g_file_name + ":" + line + "]$ Some message\n");
 	expected_string += "[E][" + os_thread.str() +"][" + g_file_name + ":" + line_debug + "]$ Some message debug\n";
 
@@ -225,7 +239,7 @@ TEST_F(LoggerTestClass, TestWMacros)
 	DEBUG_LOG_WARNING << "Some message debug";
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 
 	std::string expected_string("[W][" + os_thread.str() +"][" + g_file_name + ":" + line + "]$ Some message\n");
 	expected_string += "[W][" + os_thread.str() +"][" + g_file_name + ":" + line_debug + "]$ Some message debug\n";
@@ -249,7 +263,7 @@ TEST_F(LoggerTestClass, TestIMacros)
 	DEBUG_LOG_INFO << "Some message debug";
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 
 	std::string expected_string("[I][" + os_thread.str() +"][" + g_file_name + ":" + line + "]$ Some message\n");
 	expected_string += "[I][" + os_thread.str() +"][" + g_file_name + ":" + line_debug + "]$ Some message debug\n";
@@ -270,7 +284,7 @@ TEST_F(LoggerTestClass, TestFMacros)
 	LOG_FATAL_ERROR << "Some message";
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 
 	const std::string expected_string("[F][" + os_thread.str() +"][" + g_file_name + ":" + line + "]$ Some message\n");
 
@@ -320,7 +334,7 @@ TEST_F(LoggerTestClass, TestIfIWMacrosDisable)
 	DEBUG_LOG_ERROR << "Some message debug";
 
 	std::ostringstream os_thread;
-	os_thread << std::this_thread::get_id();
+	os_thread << GetThreadNumber();
 
 	std::string expected_string("[E][" + os_thread.str() +"][" + g_file_name + ":" + line + "]$ Some message\n");
 	expected_string += "[E][" + os_thread.str() +"][" + g_file_name + ":" + line_debug + "]$ Some message debug\n";
@@ -511,6 +525,34 @@ TEST_F(LoggerTestClass, TestReturnCheckELogs)
 	EXPECT_EQ(os3.str(), "");
 }
 
+TEST_F(LoggerTestClass, TestCheckMessageIsBuiltInTheCaller)
+{
+	SetLogInfos(0);
+	std::ostringstream os;
+	SetELogStream(os);
+
+	g(1);
+	EXPECT_EQ(os.str(), "");
+	g(0);
+	EXPECT_EQ(os.str(), "[E]$ in g\n");
+
+	os.str("");
+	EXPECT_EQ(h({1, 3}), 2);
+	EXPECT_EQ(h({3, 1}), 0);
+	EXPECT_EQ(os.str(), "[E]$ first = 3, second = 1\n");
+
+	try
+	{
+		CHECK_THROW(true, "Error");
+		h({2, 2});
+		FAIL();
+	}
+	catch (const std::runtime_error& exc)
+	{
+		EXPECT_EQ("in h", std::string(exc.what()));
+	}
+}
+
 TEST_F(LoggerTestClass, TestReturnCheckFLogs)
 {
 	std::ostringstream os;
@@ -0,0 +1,215 @@
+#include <LogSink.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace StructuredLogTestTypes
+{
+
+enum class Color : uint8_t
+{
+	Red = 1,
+};
+
+enum class Mode
+{
+	Fast,
+};
+
+std::ostream& operator<<(std::ostream& stream, const Mode)
+{
+	return stream << "fast";
+}
+
+struct Size
+{
+	int width;
+	int height;
+};
+
+std::ostream& operator<<(std::ostream& stream, const Size& size)
+{
+	return stream << size.width << 'x' << size.height;
+}
+
+struct Label
+{
+	const char* text;
+};
+
+std::ostream& operator<<(std::ostream& stream, const Label& label)
+{
+	return stream << label.text;
+}
+
+} // namespace StructuredLogTestTypes
+
+namespace
+{
+
+class StructuredLogTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(eos_);
+	}
+
+	void TearDown() override
+	{
+		for (const auto& sink : added_)
+		{
+			RemoveLogSink(sink);
+		}
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+	}
+
+	std::shared_ptr<MemorySink> AddSink(std::shared_ptr<const LogFormatter> formatter)
+	{
+		auto sink = std::make_shared<MemorySink>(16, kAllLogMessageTypes, std::move(formatter));
+		AddLogSink(sink);
+		added_.push_back(sink);
+		return sink;
+	}
+
+	std::ostringstream os_;
+	std::ostringstream eos_;
+	std::vector<std::shared_ptr<LogSink>> added_;
+
+};
+
+int LogNested()
+{
+	LOG_WARNING.kv("inner", 1) << "Nested";
+	return 2;
+}
+
+} // namespace
+
+TEST_F(StructuredLogTestClass, TestTextFormatAppendsFields)
+{
+	LOG_INFO.kv("user", 42).kv("name", "bob smith").kv("ok", true) << "Login";
+	LOG_INFO << "No fields";
+	(Logger(os_, LogMessageType::Info, "a.cpp", 1) << "Mixed ").kv("a", 1) << "message " << 2;
+	LOG_INFO.kv("b", 3) << "text " << 4;
+	EXPECT_EQ(
+		"[I]$ Login user=42 name=\"bob smith\" ok=true\n[I]$ No fields\n"
+		"[I]$ Mixed message 2 a=1\n[I]$ text 4 b=3\n",
+		os_.str());
+}
+
+TEST_F(StructuredLogTestClass, TestJson)
+{
+	using namespace StructuredLogTestTypes;
+	const auto sink = AddSink(std::make_shared<JsonFormatter>(0));
+	const std::string text = "say \"hi\"\n\x01";
+	LOG_INFO
+		.kv("int", -3)
+		.kv("uint", 7u)
+		.kv("double", 0.5)
+		.kv("nan", std::numeric_limits<double>::quiet_NaN())
+		.kv("text", text)
+		.kv("color", Color::Red)
+		.kv("mode", Mode::Fast)
+		.kv("size", Size{3, 4})
+		.kv("char", 'c')
+		.kv(LogKey(std::string_view("odd \"key\"")), false)
+		<< "Message \\ \"quoted\"";
+	EXPECT_EQ(std::vector<std::string>({
+		"{\"level\":\"info\",\"msg\":\"Message \\\\ \\\"quoted\\\"\","
+		"\"int\":-3,\"uint\":7,\"double\":0.5,\"nan\":null,"
+		"\"text\":\"say \\\"hi\\\"\\n\\u0001\",\"color\":1,\"mode\":\"fast\",\"size\":\"3x4\","
+		"\"char\":\"c\",\"odd__key_\":false}\n"}),
+		sink->GetLines());
+}
+
+TEST_F(StructuredLogTestClass, TestJsonInfos)
+{
+	const auto sink = AddSink(std::make_shared<JsonFormatter>());
+	LOG_ERROR.kv("code", 5) << "Failed";
+	ASSERT_EQ(1u, sink->GetLines().size());
+	const auto line = sink->GetLines()[0];
+	EXPECT_EQ(0u, line.find("{\"level\":\"error\",\"ts\":"));
+	EXPECT_NE(std::string::npos, line.find(",\"thread\":\"" + std::to_string(GetThreadNumber()) + "\","));
+	EXPECT_NE(std::string::npos, line.find(",\"file\":\""));
+	EXPECT_NE(std::string::npos, line.find("StructuredLogTests.cpp\",\"line\":"));
+	EXPECT_NE(std::string::npos, line.find(",\"msg\":\"Failed\",\"code\":5}\n"));
+}
+
+TEST_F(StructuredLogTestClass, TestLogfmt)
+{
+	const auto sink = AddSink(std::make_shared<LogfmtFormatter>(0));
+	LOG_WARNING
+		.kv("plain", "value")
+		.kv("empty", "")
+		.kv("equals", "a=b")
+		.kv("ratio", 1.25)
+		.kv(LogKey(std::string_view("bad key=")), 1)
+		<< "Disk almost full";
+	LOG_INFO << "Single";
+	EXPECT_EQ(std::vector<std::string>({
+		"level=warning msg=\"Disk almost full\" plain=value empty=\"\" equals=\"a=b\" ratio=1.25 bad_key_=1\n",
+		"level=info msg=Single\n"}),
+		sink->GetLines());
+}
+
+TEST_F(StructuredLogTestClass, TestTextLikeALiteralStaysText)
+{
+	using namespace StructuredLogTestTypes;
+	const auto sink = AddSink(std::make_shared<JsonFormatter>(0));
+	LOG_INFO.kv("id", "42").kv("flag", std::string("true")).kv("neg", "-1").kv("n", 42).kv("b", true) << "Typed";
+	EXPECT_EQ(std::vector<std::string>({
+		"{\"level\":\"info\",\"msg\":\"Typed\",\"id\":\"42\",\"flag\":\"true\",\"neg\":\"-1\",\"n\":42,\"b\":true}\n"}),
+		sink->GetLines());
+	LOG_INFO << "Rendered" << Size{-3, 4} << Label{"a \"b\"\t"};
+	LOG_INFO.kv("size", Size{-3, 4}).kv("label", Label{"a \"b\"\t"}).kv("plain", Label{"c"}) << "Rendered";
+	EXPECT_EQ(
+		"[I]$ Typed id=\"42\" flag=\"true\" neg=\"-1\" n=42 b=true\n"
+		"[I]$ Rendered-3x4a \"b\"\t\n"
+		"[I]$ Rendered size=\"-3x4\" label=\"a \\\"b\\\"\\t\" plain=c\n",
+		os_.str());
+	EXPECT_EQ(
+		"{\"level\":\"info\",\"msg\":\"Rendered\",\"size\":\"-3x4\",\"label\":\"a \\\"b\\\"\\t\",\"plain\":\"c\"}\n",
+		sink->GetLines().back());
+}
+
+TEST_F(StructuredLogTestClass, TestNestedLoggersKeepTheirFields)
+{
+	const auto sink = AddSink(std::make_shared<LogfmtFormatter>(0));
+	LOG_INFO.kv("outer", "a").kv("nested", LogNested()).kv("last", "b") << "Outer";
+	EXPECT_EQ(std::vector<std::string>({
+		"level=warning msg=Nested inner=1\n",
+		"level=info msg=Outer outer=a nested=2 last=b\n"}),
+		sink->GetLines());
+}
+
+TEST_F(StructuredLogTestClass, TestFieldsSurviveAsyncBackend)
+{
+	const auto sink = AddSink(std::make_shared<JsonFormatter>(0));
+	StartAsyncLogging();
+	{
+		const std::string key = "dynamic";
+		const std::string value = "temporary";
+		LOG_INFO.kv(LogKey(key), value).kv("n", 1) << "Async";
+	}
+	StopAsyncLogging();
+	EXPECT_EQ(std::vector<std::string>({
+		"{\"level\":\"info\",\"msg\":\"Async\",\"dynamic\":\"temporary\",\"n\":1}\n"}),
+		sink->GetLines());
+	EXPECT_EQ("[I]$ Async dynamic=temporary n=1\n", os_.str());
+}
+
+} // SimpleLog
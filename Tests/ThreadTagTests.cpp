@@ -0,0 +1,89 @@
+#include <DeferredLog.h>
+#include <Logger.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class ThreadTagTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(static_cast<uint32_t>(LogInfos::ThreadId));
+		SetLogMessageTypes(
+			static_cast<uint32_t>(LogMessageType::Error) |
+			static_cast<uint32_t>(LogMessageType::Info) |
+			static_cast<uint32_t>(LogMessageType::Warning) |
+			static_cast<uint32_t>(LogMessageType::FatalError));
+		SetLogStream(os_);
+	}
+
+	void TearDown() override
+	{
+		SetLogStream(std::cout);
+	}
+
+	std::ostringstream os_;
+
+};
+
+} // namespace
+
+TEST_F(ThreadTagTestClass, TestNumbersAreDenseAndStable)
+{
+	const auto number = GetThreadNumber();
+	EXPECT_EQ(number, GetThreadNumber());
+
+	constexpr size_t threads_count = 8;
+	std::vector<uint32_t> numbers(threads_count);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < threads_count; ++i)
+	{
+		threads.emplace_back([&numbers, i] { numbers[i] = GetThreadNumber(); });
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const std::set<uint32_t> unique(numbers.cbegin(), numbers.cend());
+	EXPECT_EQ(threads_count, unique.size());
+	EXPECT_EQ(0u, unique.count(number));
+	EXPECT_EQ(threads_count - 1, *unique.rbegin() - *unique.begin());
+}
+
+TEST_F(ThreadTagTestClass, TestThreadName)
+{
+	std::thread([this]
+	{
+		const auto number = std::to_string(GetThreadNumber());
+		LOG_INFO << "Unnamed";
+		SetThreadName("worker");
+		LOG_INFO << "Named";
+		LOG_INFO_FMT("Deferred {}", 1);
+		SetThreadName(std::string(100, 'x'));
+		EXPECT_EQ(std::string(47, 'x'), GetThreadName());
+		SetThreadName("");
+		LOG_INFO << "Unnamed again";
+
+		EXPECT_EQ(
+			"[I][" + number + "]$ Unnamed\n" +
+			"[I][" + number + ":worker]$ Named\n" +
+			"[I][" + number + ":worker]$ Deferred 1\n" +
+			"[I][" + number + "]$ Unnamed again\n",
+			os_.str());
+	}).join();
+}
+
+} // SimpleLog
@@ -0,0 +1,96 @@
+#include <Logger.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <regex>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+int64_t GetNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+class TimeStampTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(static_cast<uint32_t>(LogInfos::TimeStamp));
+	}
+
+	void TearDown() override
+	{
+		SetTimeStampFormat(TimeStampFormat::Default);
+		SetTimeStampPrecision(TimeStampPrecision::Seconds);
+	}
+
+	std::string Log(const char* message)
+	{
+		std::ostringstream os;
+		{
+			Logger logger(os, LogMessageType::Info, "FileName", 32);
+			logger << message;
+		}
+		return os.str();
+	}
+
+};
+
+} // namespace
+
+TEST_F(TimeStampTestClass, TestDefaultFormatWithFraction)
+{
+	SetTimeStampPrecision(TimeStampPrecision::Milliseconds);
+	const std::regex expected(R"(\[I\]\[\(GMT\)\d{2}-\d{2}-\d{4}\(\d{2}:\d{2}:\d{2}\.\d{3}\)\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected));
+}
+
+TEST_F(TimeStampTestClass, TestIso8601)
+{
+	SetTimeStampFormat(TimeStampFormat::Iso8601);
+	const std::regex expected_seconds(R"(\[I\]\[\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}Z\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_seconds));
+
+	SetTimeStampPrecision(TimeStampPrecision::Microseconds);
+	const std::regex expected_micro(R"(\[I\]\[\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}\.\d{6}Z\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_micro));
+
+	SetTimeStampPrecision(TimeStampPrecision::Nanoseconds);
+	const std::regex expected_nano(R"(\[I\]\[\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}\.\d{9}Z\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_nano));
+}
+
+TEST_F(TimeStampTestClass, TestEpochNanoseconds)
+{
+	SetTimeStampFormat(TimeStampFormat::EpochNanoseconds);
+	const auto before = GetNow();
+	const auto result_string = Log("Message");
+	const auto after = GetNow();
+
+	const std::regex expected(R"(\[I\]\[(\d+)\]\$ Message\n)");
+	std::smatch match;
+	ASSERT_TRUE(std::regex_match(result_string, match, expected));
+	const auto timestamp = std::stoll(match[1].str());
+	EXPECT_LE(before, timestamp);
+	EXPECT_GE(after, timestamp);
+}
+
+TEST_F(TimeStampTestClass, TestFormatSwitchInvalidatesCache)
+{
+	const std::regex expected_default(R"(\[I\]\[\(GMT\)\d{2}-\d{2}-\d{4}\(\d{2}:\d{2}:\d{2}\)\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_default));
+	SetTimeStampFormat(TimeStampFormat::Iso8601);
+	const std::regex expected_iso(R"(\[I\]\[\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}Z\]\$ Message\n)");
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_iso));
+	SetTimeStampFormat(TimeStampFormat::Default);
+	EXPECT_TRUE(std::regex_match(Log("Message"), expected_default));
+}
+
+} // SimpleLog
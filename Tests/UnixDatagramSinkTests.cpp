@@ -0,0 +1,316 @@
+#include <LogSink.h>
+#include <Logger.h>
+#include <LoggerStats.h>
+#include <UnixDatagramSink.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace SimpleLog
+{
+
+namespace
+{
+
+class UnixDatagramSinkTestClass : public ::testing::Test
+{
+
+protected:
+
+	void SetUp() override
+	{
+		SetLogInfos(0);
+		SetLogMessageTypes(kAllLogMessageTypes);
+		SetLogStream(os_);
+		SetELogStream(os_);
+		path_ = "SimpleLoggerAgent" + std::to_string(getpid()) + ".sock";
+		std::remove(path_.c_str());
+		receiver_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		std::memcpy(address.sun_path, path_.data(), path_.size());
+		ASSERT_EQ(0, bind(receiver_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)));
+	}
+
+	void TearDown() override
+	{
+		StopAsyncLogging();
+		if (sink_ != nullptr)
+		{
+			RemoveLogSink(sink_);
+		}
+		SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::Block);
+		SetLogStream(std::cout);
+		SetELogStream(std::cerr);
+		close(receiver_);
+		std::remove(path_.c_str());
+	}
+
+	// Everything received so far: one entry per datagram.
+	std::vector<std::string> Receive()
+	{
+		std::vector<std::string> datagrams;
+		char data[1 << 16];
+		ssize_t size = 0;
+		while ((size = recv(receiver_, data, sizeof(data), MSG_DONTWAIT)) >= 0)
+		{
+			datagrams.emplace_back(data, static_cast<size_t>(size));
+		}
+		return datagrams;
+	}
+
+	static void Write(UnixDatagramSink& sink, const int index)
+	{
+		const auto text = "Record " + std::to_string(index) + "\n";
+		const LogRecord record{LogMessageType::Info, 0, "[1]", "a.cpp", 1, text, text};
+		sink.Write(record, record.text);
+	}
+
+	std::ostringstream os_;
+	std::string path_;
+	int receiver_ = -1;
+	std::shared_ptr<UnixDatagramSink> sink_;
+
+};
+
+std::string Join(const std::vector<std::string>& datagrams)
+{
+	std::string text;
+	for (const auto& datagram : datagrams)
+	{
+		text += datagram;
+	}
+	return text;
+}
+
+std::string Expected(const int begin, const int end)
+{
+	std::string text;
+	for (int i = begin; i < end; ++i)
+	{
+		text += "Record " + std::to_string(i) + "\n";
+	}
+	return text;
+}
+
+} // namespace
+
+TEST_F(UnixDatagramSinkTestClass, TestRecordsArePackedIntoDatagrams)
+{
+	UnixDatagramOptions options;
+	options.max_datagram_size = 1024;
+	options.batch_datagrams = 8;
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	ASSERT_TRUE(sink.IsOpen());
+	// Queued until Flush() while asynchronous logging runs.
+	StartAsyncLogging();
+	for (int i = 0; i < 500; ++i)
+	{
+		Write(sink, i);
+	}
+	sink.Flush();
+
+	const auto datagrams = Receive();
+	EXPECT_EQ(Expected(0, 500), Join(datagrams));
+	EXPECT_EQ(datagrams.size(), sink.GetSentDatagrams());
+	EXPECT_LT(datagrams.size(), 10u);
+	for (const auto& datagram : datagrams)
+	{
+		EXPECT_LE(datagram.size(), 1024u);
+		EXPECT_EQ('\n', datagram.back());
+	}
+	// One burst per batch of full datagrams, and one for the rest.
+	EXPECT_LT(sink.GetSendCalls(), datagrams.size());
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestSyncWritesAreBatched)
+{
+	UnixDatagramOptions options;
+	options.sync_batch_records = 10;
+	options.sync_batch_interval = std::chrono::hours(1);
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	for (int i = 0; i < 25; ++i)
+	{
+		Write(sink, i);
+	}
+	EXPECT_EQ(Expected(0, 20), Join(Receive()));
+	EXPECT_EQ(2u, sink.GetSendCalls());
+	sink.Flush();
+	EXPECT_EQ(Expected(20, 25), Join(Receive()));
+	EXPECT_EQ(3u, sink.GetSendCalls());
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestSyncBatchInterval)
+{
+	UnixDatagramOptions options;
+	options.sync_batch_records = 1000;
+	options.sync_batch_interval = std::chrono::milliseconds(20);
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	Write(sink, 0);
+	Write(sink, 1);
+	EXPECT_TRUE(Receive().empty());
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	Write(sink, 2);
+	EXPECT_EQ(Expected(0, 3), Join(Receive()));
+	EXPECT_EQ(1u, sink.GetSendCalls());
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestLoggedRecordsThroughBackend)
+{
+	sink_ = std::make_shared<UnixDatagramSink>(path_);
+	AddLogSink(sink_);
+	StartAsyncLogging();
+	for (int i = 0; i < 100; ++i)
+	{
+		LOG_INFO << "Record " << i;
+	}
+	LOG_ERROR.kv("code", 7) << "Failed";
+	FlushAsyncLogging();
+
+	std::string expected;
+	for (int i = 0; i < 100; ++i)
+	{
+		expected += "[I]$ Record " + std::to_string(i) + "\n";
+	}
+	expected += "[E]$ Failed code=7\n";
+	EXPECT_EQ(expected, Join(Receive()));
+	EXPECT_EQ(0u, sink_->GetDroppedRecords());
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestFullReceiverDropsNewest)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropNewest);
+	UnixDatagramOptions options;
+	options.max_datagram_size = 512;
+	options.max_pending_bytes = 4096;
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	const auto dropped_before = GetLoggerStats().message_types[GetLogMessageTypeIndex(LogMessageType::Info)].dropped;
+	constexpr int count = 50000;
+	for (int i = 0; i < count; ++i)
+	{
+		Write(sink, i);
+	}
+	const auto dropped = sink.GetDroppedRecords();
+	EXPECT_GT(dropped, 0u);
+	EXPECT_EQ(dropped_before + dropped,
+		GetLoggerStats().message_types[GetLogMessageTypeIndex(LogMessageType::Info)].dropped);
+
+	// What was kept arrives once the receiver reads, oldest first.
+	auto received = Join(Receive());
+	sink.Flush();
+	received += Join(Receive());
+	EXPECT_EQ(0u, received.find(Expected(0, 10)));
+	EXPECT_EQ(static_cast<size_t>(count) - dropped,
+		static_cast<size_t>(std::count(received.cbegin(), received.cend(), '\n')));
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestFullReceiverDropsOldest)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropOldest);
+	UnixDatagramOptions options;
+	options.max_datagram_size = 512;
+	options.max_pending_bytes = 4096;
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	constexpr int count = 50000;
+	for (int i = 0; i < count; ++i)
+	{
+		Write(sink, i);
+	}
+	EXPECT_GT(sink.GetDroppedRecords(), 0u);
+
+	auto received = Join(Receive());
+	sink.Flush();
+	received += Join(Receive());
+	const auto last = Expected(count - 1, count);
+	EXPECT_EQ(received.size() - last.size(), received.rfind(last));
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestBlockIsBoundedThenDrops)
+{
+	// No block timeout: the sink's max_block_time still bounds the wait.
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::Block);
+	UnixDatagramOptions options;
+	options.max_datagram_size = 512;
+	options.max_pending_bytes = 4096;
+	options.max_block_time = std::chrono::milliseconds(5);
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	const auto begin = std::chrono::steady_clock::now();
+	int written = 0;
+	for (; sink.GetDroppedRecords() < 3; ++written)
+	{
+		ASSERT_LT(written, 1000000);
+		Write(sink, written);
+	}
+	EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(5));
+	EXPECT_EQ(3u, sink.GetDroppedRecords());
+
+	auto received = Join(Receive());
+	sink.Flush();
+	received += Join(Receive());
+	EXPECT_EQ(0u, received.find(Expected(0, 10)));
+	EXPECT_EQ(static_cast<size_t>(written) - 3, static_cast<size_t>(std::count(received.cbegin(), received.cend(), '\n')));
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestBlockedWriterReleasesTheSink)
+{
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::Block);
+	UnixDatagramOptions options;
+	options.max_datagram_size = 512;
+	options.max_pending_bytes = 4096;
+	options.max_block_time = std::chrono::seconds(10);
+	UnixDatagramSink sink(path_, kAllLogMessageTypes, nullptr, options);
+	// Fills the socket and the sink's queue.
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::DropNewest);
+	int written = 0;
+	for (; sink.GetDroppedRecords() == 0; ++written)
+	{
+		ASSERT_LT(written, 1000000);
+		Write(sink, written);
+	}
+	SetLogOverflowPolicy(LogMessageType::Info, LogOverflowPolicy::Block);
+	std::thread blocked([&sink]() { Write(sink, -1); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	// The waiting writer does not hold the sink.
+	const auto begin = std::chrono::steady_clock::now();
+	EXPECT_EQ(1u, sink.GetDroppedRecords());
+	sink.Flush();
+	EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+
+	// Once the receiver reads, the writer queues its record.
+	auto received = Join(Receive());
+	blocked.join();
+	sink.Flush();
+	received += Join(Receive());
+	sink.Flush();
+	received += Join(Receive());
+	EXPECT_EQ(1u, sink.GetDroppedRecords());
+	EXPECT_NE(std::string::npos, received.find("Record -1\n"));
+}
+
+TEST_F(UnixDatagramSinkTestClass, TestMissingAgentDropsRecords)
+{
+	close(receiver_);
+	std::remove(path_.c_str());
+	receiver_ = -1;
+	UnixDatagramSink sink(path_);
+	ASSERT_TRUE(sink.IsOpen());
+	Write(sink, 1);
+	Write(sink, 2);
+	EXPECT_EQ(2u, sink.GetDroppedRecords());
+	EXPECT_EQ(0u, sink.GetSentDatagrams());
+}
+
+} // SimpleLog
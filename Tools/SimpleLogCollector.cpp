@@ -0,0 +1,170 @@
+// simplelog-collector: drains the shared memory rings of every process logging through
+// a SharedMemorySink with the same prefix, merges their records by timestamp and
+// appends them to one file.
+
+#include <BatchedFileStream.h>
+#include <SharedMemoryLog.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+using namespace SimpleLog;
+
+volatile std::sig_atomic_t stop_requested_ = 0;
+
+void RequestStop(int)
+{
+	stop_requested_ = 1;
+}
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: simplelog-collector [options] <output file>\n"
+		"  --prefix <name>  shared memory prefix of the sinks (default /simplelog)\n"
+		"  --delay <ms>     how long records are held to merge processes by time (default 100)\n"
+		"  --poll <ms>      wait between polls that found nothing (default 10)\n"
+		"  --once           write the records of the rings present and exit\n"
+		"Runs until SIGINT or SIGTERM, then writes every record still held.\n";
+}
+
+bool ParseMilliseconds(const std::string& text, std::chrono::milliseconds& value)
+{
+	if (text.empty())
+	{
+		return false;
+	}
+	char* end = nullptr;
+	const auto number = std::strtoll(text.c_str(), &end, 10);
+	value = std::chrono::milliseconds(number);
+	return *end == '\0' && number >= 0;
+}
+
+int64_t GetNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Records held until every process had time to write what came before them; records of
+// equal time keep their arrival order.
+using PendingRecords = std::multimap<int64_t, std::string>;
+
+void WriteUntil(PendingRecords& pending, const int64_t timestamp_ns, std::ostream& out)
+{
+	const auto end = pending.upper_bound(timestamp_ns);
+	for (auto it = pending.begin(); it != end; ++it)
+	{
+		out.write(it->second.data(), static_cast<std::streamsize>(it->second.size()));
+	}
+	pending.erase(pending.begin(), end);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string prefix = "/simplelog";
+	std::chrono::milliseconds delay(100);
+	std::chrono::milliseconds poll(10);
+	bool once = false;
+	std::string path;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string option = argv[i];
+		if (option == "--help" || option == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		if (option == "--once")
+		{
+			once = true;
+			continue;
+		}
+		if (option.rfind("--", 0) != 0)
+		{
+			if (!path.empty())
+			{
+				PrintUsage();
+				return 2;
+			}
+			path = option;
+			continue;
+		}
+
+		const std::string value = i + 1 < argc ? argv[i + 1] : "";
+		bool valid = false;
+		if (option == "--prefix")
+		{
+			prefix = value;
+			valid = !prefix.empty();
+		}
+		else if (option == "--delay")
+		{
+			valid = ParseMilliseconds(value, delay);
+		}
+		else if (option == "--poll")
+		{
+			valid = ParseMilliseconds(value, poll);
+		}
+		if (!valid)
+		{
+			std::cerr << "simplelog-collector: invalid option " << option << " " << value << "\n";
+			PrintUsage();
+			return 2;
+		}
+		++i;
+	}
+	if (path.empty())
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	BatchedFileStream out(path);
+	if (!out.IsOpen())
+	{
+		std::cerr << "simplelog-collector: cannot open " << path << "\n";
+		return 1;
+	}
+	std::signal(SIGINT, RequestStop);
+	std::signal(SIGTERM, RequestStop);
+
+	SharedLogCollector collector(prefix);
+	PendingRecords pending;
+	const auto hold = [&pending](const SharedLogRecord& record)
+	{
+		pending.emplace_hint(pending.end(), record.timestamp_ns, std::string(record.text));
+	};
+	const auto delay_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count();
+	while (!once && stop_requested_ == 0)
+	{
+		const auto count = collector.Poll(hold);
+		WriteUntil(pending, GetNow() - delay_ns, out);
+		if (count == 0)
+		{
+			out.flush();
+			std::this_thread::sleep_for(poll);
+		}
+	}
+	collector.Poll(hold);
+	WriteUntil(pending, INT64_MAX, out);
+	out.Close();
+
+	const auto stats = collector.GetStats();
+	if (stats.dropped != 0 || stats.lost != 0)
+	{
+		std::cerr << "simplelog-collector: " << stats.dropped << " records dropped by full rings, "
+			<< stats.lost << " lost by crashed processes\n";
+	}
+	return 0;
+}
@@ -0,0 +1,269 @@
+// simplelog-query: prints the records of a BlockFileSink file that match a time range,
+// message types, a file:line site and a thread, in the library's text layout.
+
+#include <BlockLogFile.h>
+#include <LogSink.h>
+#include <Logger.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using namespace SimpleLog;
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: simplelog-query [options] <file>\n"
+		"  --from <time>        records at or after time\n"
+		"  --to <time>          records at or before time\n"
+		"  --level <levels>     comma-separated: info, warning, error, fatal\n"
+		"  --site <file[:line]> records of a call site; directories are ignored\n"
+		"  --thread <number>    records of one thread\n"
+		"  --infos <mask>       LogInfos of the printed prefix (default 7: thread, time, file:line)\n"
+		"  --time <format>      default, iso8601 or epoch\n"
+		"  --stats              print the number of blocks read to stderr\n"
+		"<time> is nanoseconds since the epoch or UTC ISO-8601: 2026-10-16T12:00:00[.fraction][Z]\n";
+}
+
+bool ParseNumber(const std::string& text, long long& value)
+{
+	if (text.empty())
+	{
+		return false;
+	}
+	char* end = nullptr;
+	value = std::strtoll(text.c_str(), &end, 10);
+	return *end == '\0';
+}
+
+bool ParseTime(const std::string& text, int64_t& timestamp_ns)
+{
+	long long value = 0;
+	if (ParseNumber(text, value))
+	{
+		timestamp_ns = value;
+		return true;
+	}
+
+	std::tm time = {};
+	int consumed = 0;
+	if (std::sscanf(text.c_str(), "%d-%d-%dT%d:%d:%d%n",
+			&time.tm_year, &time.tm_mon, &time.tm_mday, &time.tm_hour, &time.tm_min, &time.tm_sec, &consumed) != 6)
+	{
+		return false;
+	}
+	time.tm_year -= 1900;
+	time.tm_mon -= 1;
+	int64_t fraction_ns = 0;
+	auto rest = std::string_view(text).substr(static_cast<size_t>(consumed));
+	if (!rest.empty() && rest[0] == '.')
+	{
+		int64_t scale = 100000000;
+		size_t i = 1;
+		for (; i < rest.size() && rest[i] >= '0' && rest[i] <= '9'; ++i, scale /= 10)
+		{
+			fraction_ns += (rest[i] - '0') * scale;
+		}
+		rest.remove_prefix(i);
+	}
+	if (rest != "" && rest != "Z")
+	{
+		return false;
+	}
+	timestamp_ns = static_cast<int64_t>(timegm(&time)) * 1000000000 + fraction_ns;
+	return true;
+}
+
+bool ParseLevels(const std::string& text, uint32_t& message_types)
+{
+	message_types = 0;
+	size_t begin = 0;
+	while (begin <= text.size())
+	{
+		const auto end = std::min(text.find(',', begin), text.size());
+		const auto level = std::string_view(text).substr(begin, end - begin);
+		if (level == "info" || level == "i")
+		{
+			message_types |= static_cast<uint32_t>(LogMessageType::Info);
+		}
+		else if (level == "warning" || level == "w")
+		{
+			message_types |= static_cast<uint32_t>(LogMessageType::Warning);
+		}
+		else if (level == "error" || level == "e")
+		{
+			message_types |= static_cast<uint32_t>(LogMessageType::Error);
+		}
+		else if (level == "fatal" || level == "f")
+		{
+			message_types |= static_cast<uint32_t>(LogMessageType::FatalError);
+		}
+		else
+		{
+			return false;
+		}
+		begin = end + 1;
+	}
+	return true;
+}
+
+bool ParseSite(const std::string& text, BlockLogQuery& query)
+{
+	auto file = text;
+	const auto colon = text.rfind(':');
+	if (colon != std::string::npos)
+	{
+		long long line = 0;
+		if (!ParseNumber(text.substr(colon + 1), line) || line <= 0)
+		{
+			return false;
+		}
+		query.line = static_cast<int>(line);
+		file = text.substr(0, colon);
+	}
+	const auto slash = file.find_last_of("/\\");
+	query.file = slash == std::string::npos ? file : file.substr(slash + 1);
+	return !query.file.empty();
+}
+
+bool ParseTimeFormat(const std::string& text)
+{
+	if (text == "default")
+	{
+		SetTimeStampFormat(TimeStampFormat::Default);
+	}
+	else if (text == "iso8601")
+	{
+		SetTimeStampFormat(TimeStampFormat::Iso8601);
+	}
+	else if (text == "epoch")
+	{
+		SetTimeStampFormat(TimeStampFormat::EpochNanoseconds);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	BlockLogQuery query;
+	uint32_t log_infos = kAllLogInfos;
+	bool print_stats = false;
+	std::string path;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string option = argv[i];
+		const auto has_value = i + 1 < argc;
+		const std::string value = has_value ? argv[i + 1] : "";
+		if (option == "--stats")
+		{
+			print_stats = true;
+			continue;
+		}
+		if (option == "--help" || option == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		if (option.rfind("--", 0) != 0)
+		{
+			if (!path.empty())
+			{
+				PrintUsage();
+				return 2;
+			}
+			path = option;
+			continue;
+		}
+
+		if (!has_value)
+		{
+			std::cerr << "simplelog-query: " << option << " needs a value\n";
+			PrintUsage();
+			return 2;
+		}
+		long long number = 0;
+		bool valid = false;
+		if (option == "--from")
+		{
+			valid = ParseTime(value, query.begin_ns);
+		}
+		else if (option == "--to")
+		{
+			valid = ParseTime(value, query.end_ns);
+		}
+		else if (option == "--level")
+		{
+			valid = ParseLevels(value, query.message_types);
+		}
+		else if (option == "--site")
+		{
+			valid = ParseSite(value, query);
+		}
+		else if (option == "--thread")
+		{
+			valid = ParseNumber(value, number) && number > 0;
+			query.thread = static_cast<uint32_t>(number);
+		}
+		else if (option == "--infos")
+		{
+			valid = ParseNumber(value, number) && number >= 0 && number <= kAllLogInfos;
+			log_infos = static_cast<uint32_t>(number);
+		}
+		else if (option == "--time")
+		{
+			valid = ParseTimeFormat(value);
+		}
+		if (!valid)
+		{
+			std::cerr << "simplelog-query: invalid option " << option << " " << value << "\n";
+			PrintUsage();
+			return 2;
+		}
+		++i;
+	}
+	if (path.empty())
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	const LogInfosFormatter formatter(log_infos);
+	LogBuffer buffer;
+	BlockLogQueryStats stats;
+	const auto read = QueryBlockLog(path, query, [&formatter, &buffer](const LogRecord& record)
+	{
+		formatter.Format(record, buffer);
+		if (buffer.Size() >= (64 << 10))
+		{
+			std::cout.write(buffer.Data(), static_cast<std::streamsize>(buffer.Size()));
+			buffer.Truncate(0);
+		}
+	}, &stats);
+	std::cout.write(buffer.Data(), static_cast<std::streamsize>(buffer.Size()));
+	std::cout.flush();
+	if (!read)
+	{
+		std::cerr << "simplelog-query: cannot read " << path << "\n";
+		return 1;
+	}
+	if (print_stats)
+	{
+		std::cerr << stats.records << " records from " << stats.blocks_read << " of " << stats.blocks << " blocks"
+			<< (stats.indexed ? "" : " (no index)") << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,70 @@
+# Usage: cmake -DBEFORE=<build dir> -DAFTER=<build dir> [-DSIZE=<size>] -P TextSizeReport.cmake
+# Compares the code size of the test binary of two builds (configure both with the same
+# CMAKE_BUILD_TYPE, e.g. Release): the .text of the linked SimpleLoggerTests, and the
+# .text of the test objects split into hot code and .text.unlikely, where the cold
+# logging and CHECK_* failure paths go.
+
+if (NOT BEFORE OR NOT AFTER)
+	message(FATAL_ERROR "BEFORE and AFTER build directories are required")
+endif ()
+if (NOT SIZE)
+	set(SIZE size)
+endif ()
+
+# Sums the .text sections of files (size -A output), split into hot and cold.
+function(get_text_sizes files total_var hot_var cold_var)
+	execute_process(
+		COMMAND ${SIZE} -A ${files}
+		OUTPUT_VARIABLE sections
+		RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${SIZE} failed")
+	endif ()
+	string(REGEX MATCHALL "\n\\.text[^ \n]* +[0-9]+" lines "${sections}")
+	set(hot 0)
+	set(cold 0)
+	foreach (line IN LISTS lines)
+		string(REGEX MATCH "[0-9]+$" bytes "${line}")
+		if (line MATCHES "unlikely")
+			math(EXPR cold "${cold} + ${bytes}")
+		else ()
+			math(EXPR hot "${hot} + ${bytes}")
+		endif ()
+	endforeach ()
+	math(EXPR total "${hot} + ${cold}")
+	set(${total_var} ${total} PARENT_SCOPE)
+	set(${hot_var} ${hot} PARENT_SCOPE)
+	set(${cold_var} ${cold} PARENT_SCOPE)
+endfunction()
+
+function(report label before after)
+	math(EXPR delta "${after} - ${before}")
+	set(percent "")
+	if (before GREATER 0)
+		# One decimal, rounded toward zero.
+		math(EXPR tenths "${delta} * 1000 / ${before}")
+		set(sign "")
+		if (tenths LESS 0)
+			set(sign "-")
+			math(EXPR tenths "-${tenths}")
+		endif ()
+		math(EXPR whole "${tenths} / 10")
+		math(EXPR fraction "${tenths} % 10")
+		set(percent ", ${sign}${whole}.${fraction}%")
+	endif ()
+	message("${label}: ${before} -> ${after} bytes (${delta}${percent})")
+endfunction()
+
+foreach (build BEFORE AFTER)
+	set(binary "${${build}}/Tests/SimpleLoggerTests")
+	if (NOT EXISTS "${binary}")
+		message(FATAL_ERROR "${binary} not found")
+	endif ()
+	get_text_sizes("${binary}" ${build}_binary unused unused)
+	file(GLOB_RECURSE objects "${${build}}/Tests/CMakeFiles/SimpleLoggerTests.dir/*.o")
+	get_text_sizes("${objects}" unused ${build}_hot ${build}_cold)
+endforeach ()
+
+report("SimpleLoggerTests .text" ${BEFORE_binary} ${AFTER_binary})
+report("Test objects hot .text" ${BEFORE_hot} ${AFTER_hot})
+report("Test objects .text.unlikely" ${BEFORE_cold} ${AFTER_cold})